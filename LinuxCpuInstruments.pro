@@ -22,14 +22,20 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+include(core.pri)
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-    logiccore.cpp
+    coreheatmapwidget.cpp \
+    frequencychartwidget.cpp \
+    samplepyramid.cpp
 
 HEADERS += \
         mainwindow.h \
-    logiccore.h
+    coreheatmapwidget.h \
+    frequencychartwidget.h \
+    samplepyramid.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Benchmark of sampling and apply paths against fake sysfs trees, QtCore only.
+#
+#-------------------------------------------------
+
+QT       = core
+
+TARGET = LinuxCpuInstrumentsBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(core.pri)
+
+SOURCES += \
+    benchmain.cpp \
+    fakesysfstree.cpp
+
+HEADERS += \
+    fakesysfstree.h
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Headless sampler, QtCore only.
+#
+#-------------------------------------------------
+
+QT       = core
+
+TARGET = LinuxCpuInstrumentsCli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(core.pri)
+
+SOURCES += \
+    climain.cpp \
+    streamwriter.cpp
+
+HEADERS += \
+    streamwriter.h
+
+# Default rules for deployment.
+unix:!android: target.path = /opt/LinuxCpuInstruments/bin
+!isEmpty(target.path): INSTALLS += target
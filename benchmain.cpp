@@ -0,0 +1,651 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/perf_event.h>
+
+#include "coresampler.h"
+#include "bulkapplier.h"
+#include "fakesysfstree.h"
+#include "sharedstatepublisher.h"
+#include "metricsexporter.h"
+
+// Benchmark of the sampling and apply paths against fake sysfs trees of different sizes.
+
+namespace
+{
+// Every malloc family call of the process, operator new included.
+std::atomic<quint64> allocationsTotal(0);
+}
+
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+    allocationsTotal.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocationsTotal.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    allocationsTotal.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+
+namespace
+{
+const qint64 NSEC_PER_USEC = 1000;
+
+// Syscalls of the calling thread. Exact with the raw_syscalls:sys_enter tracepoint,
+//otherwise only the read and write family from /proc/thread-self/io (io_uring_enter is not among them).
+class SyscallCounter
+{
+public:
+    SyscallCounter():
+        descriptor(-1),
+        exact(false)
+    {
+    }
+
+    ~SyscallCounter()
+    {
+        if(this->descriptor >= 0)
+            close(this->descriptor);
+    }
+
+    // Must be called on the measured thread.
+    void open()
+    {
+        const char *paths[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                               "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+        for(const char *path: paths)
+        {
+            QFile file(path);
+            if(!file.open(QIODevice::ReadOnly))
+                continue;
+            bool success = false;
+            quint64 id = QString::fromLatin1(file.readAll()).trimmed().toULongLong(&success);
+            if(!success)
+                continue;
+            perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_TRACEPOINT;
+            attributes.size = sizeof(attributes);
+            attributes.config = id;
+            this->descriptor = int(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+            if(this->descriptor >= 0)
+            {
+                this->exact = true;
+                return;
+            }
+        }
+        this->descriptor = ::open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+    }
+
+    bool isExact() const
+    {
+        return this->exact;
+    }
+
+    bool isOpen() const
+    {
+        return this->descriptor >= 0;
+    }
+
+    // Includes the syscall made by this call.
+    quint64 read() const
+    {
+        if(this->exact)
+        {
+            quint64 count = 0;
+            return ::read(this->descriptor, &count, sizeof(count)) == sizeof(count) ? count : 0;
+        }
+        char buffer[512];
+        ssize_t length = pread(this->descriptor, buffer, sizeof(buffer) - 1, 0);
+        if(length <= 0)
+            return 0;
+        buffer[length] = '\0';
+        return field(buffer, "syscr:") + field(buffer, "syscw:");
+    }
+
+private:
+    int descriptor;
+    bool exact;
+
+    static quint64 field(const char *buffer, const char *name)
+    {
+        const char *position = strstr(buffer, name);
+        return position == nullptr ? 0 : strtoull(position + strlen(name), nullptr, 10);
+    }
+};
+
+// Collects cost of every tick on the sampler thread into preallocated arrays.
+class TickSink : public SnapshotSink
+{
+public:
+    explicit TickSink(int ticksTotal):
+        durations(size_t(ticksTotal)),
+        allocations(size_t(ticksTotal)),
+        syscalls(size_t(ticksTotal)),
+        ticks(0),
+        previousAllocations(0),
+        previousSyscalls(0),
+        started(false)
+    {
+    }
+
+    void consume(const CoreStateStore &store) override
+    {
+        const int tick = this->ticks.load(std::memory_order_relaxed);
+        if(tick >= int(this->durations.size()))
+            return;
+        const quint64 allocationsNow = allocationsTotal.load(std::memory_order_relaxed);
+        if(!this->started)
+        {
+            // First call only sets the counters up, its tick has no previous one to compare with.
+            this->counter.open();
+            this->previousSyscalls = this->counter.read();
+            this->previousAllocations = allocationsTotal.load(std::memory_order_relaxed);
+            this->started = true;
+            return;
+        }
+        const quint64 syscallsNow = this->counter.read();
+        this->durations[size_t(tick)] = store.samplingDuration;
+        this->allocations[size_t(tick)] = qint64(allocationsNow - this->previousAllocations);
+        // The counter's own read is not part of the tick.
+        this->syscalls[size_t(tick)] = qint64(syscallsNow - this->previousSyscalls) - 1;
+        this->previousAllocations = allocationsNow;
+        this->previousSyscalls = syscallsNow;
+        this->ticks.store(tick + 1, std::memory_order_release);
+    }
+
+    bool isDone() const
+    {
+        return this->ticks.load(std::memory_order_acquire) >= int(this->durations.size());
+    }
+
+    std::vector<qint64> durations;
+    std::vector<qint64> allocations;
+    std::vector<qint64> syscalls;
+    SyscallCounter counter;
+
+private:
+    std::atomic<int> ticks;
+    quint64 previousAllocations;
+    quint64 previousSyscalls;
+    bool started;
+};
+
+void printDistribution(const char *name, std::vector<qint64> values, const char *unit, qint64 divisor)
+{
+    if(values.empty())
+    {
+        printf("  %-22s no samples\n", name);
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for(qint64 value: values)
+        sum += double(value);
+    const size_t last = values.size() - 1;
+    auto percentile = [&values, last](double fraction) { return values[size_t(double(last)*fraction + 0.5)]; };
+    printf("  %-22s n=%-5zu min %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f  mean %8.1f %s\n", name, values.size(),
+           double(values.front())/divisor, double(percentile(0.5))/divisor, double(percentile(0.9))/divisor,
+           double(percentile(0.99))/divisor, double(values.back())/divisor, sum/values.size()/divisor, unit);
+}
+
+std::vector<qint64> measureStartup(int coresTotal, int runs, const QString &cachePath)
+{
+    std::vector<qint64> durations;
+    for(int run = 0; run < runs; run++)
+    {
+        if(!cachePath.isEmpty())
+            QFile::remove(cachePath);
+        const qint64 start = CoreSampler::monotonicTime();
+        CoreSampler *sampler = new CoreSampler(uint(coresTotal), 0);
+        durations.push_back(CoreSampler::monotonicTime() - start);
+        delete sampler;
+    }
+    return durations;
+}
+
+std::vector<qint64> measureApply(CoreSampler &sampler, BulkApplier &applier, int coresApplied, int runs, QString &error)
+{
+    CoreStateStore current = *sampler.snapshots().acquireLatest();
+    QVector<const LogicCore*> cores;
+    for(int core = 0; core < coresApplied; core++)
+        cores.push_back(&sampler.logicCore(core));
+    QVector<LogicCore::ApplySettings> settings(coresApplied);
+    std::vector<qint64> durations;
+    for(int run = 0; run < runs; run++)
+    {
+        // Alternate the limit, so every run really writes.
+        const uint maxScaling = run % 2 ? FakeSysfsTree::maxFrequence : FakeSysfsTree::maxFrequence - 400000;
+        for(int core = 0; core < coresApplied; core++)
+        {
+            settings[core].online = true;
+            settings[core].minScalingFrequence = FakeSysfsTree::minFrequence;
+            settings[core].maxScalingFrequence = maxScaling;
+            settings[core].governor = GovernorTable::unknownGovernor;
+            settings[core].idleStatesMask = 0;
+        }
+        const qint64 start = CoreSampler::monotonicTime();
+        QVector<BulkApplier::Result> results = applier.apply(cores, settings, current);
+        durations.push_back(CoreSampler::monotonicTime() - start);
+        for(const BulkApplier::Result &result: results)
+        {
+            if(!result.error.isEmpty() && error.isEmpty())
+                error = result.error;
+        }
+        // Sampler is stopped, the snapshot follows what was written.
+        for(int core = 0; core < coresApplied; core++)
+            current.maxScalingFrequences[core] = maxScaling;
+    }
+    return durations;
+}
+
+struct SharedStateResult
+{
+    std::vector<qint64> publishDurations;
+    std::vector<qint64> readDurations;
+    quint64 reads;
+    quint64 busy;
+    // Snapshots whose cores came from different ticks, must stay 0.
+    quint64 torn;
+};
+
+// Publishes at `period` microseconds for `duration` milliseconds while `readersTotal` threads read in a loop.
+//Every publish writes its number to all current frequences, so a reader sees a torn copy as unequal values.
+SharedStateResult measureSharedState(const CoreStateStore &store, int readersTotal, int period, int duration, QString &error)
+{
+    SharedStateResult result;
+    result.reads = 0;
+    result.busy = 0;
+    result.torn = 0;
+    const QString name = "/LinuxCpuInstrumentsBench-" + QString::number(getpid());
+    SharedStatePublisher publisher;
+    if(!publisher.open(name, store))
+    {
+        error = publisher.errorString();
+        return result;
+    }
+    CoreStateStore published = store;
+    const int coresTotal = store.size();
+    // Every 64th read is timed, arrays are allocated before the readers start.
+    const size_t samplesCapacity = 1 << 16;
+    std::atomic<bool> running(true);
+    std::vector<std::vector<qint64>> readDurations(readersTotal);
+    std::vector<quint64> reads(size_t(readersTotal), 0);
+    std::vector<quint64> busy(size_t(readersTotal), 0);
+    std::vector<quint64> torn(size_t(readersTotal), 0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < readersTotal; i++)
+    {
+        readDurations[size_t(i)].reserve(samplesCapacity);
+        readers.push_back(std::thread([&, i]()
+        {
+            SharedStateReader reader;
+            if(sharedStateOpen(&reader, name.toLocal8Bit().constData()) != 0)
+                return;
+            std::vector<SharedStateCore> cores(coresTotal);
+            std::vector<qint64> &durations = readDurations[size_t(i)];
+            quint64 readsTotal = 0;
+            while(running.load(std::memory_order_relaxed))
+            {
+                const bool timed = (readsTotal & 63) == 0 && durations.size() < samplesCapacity;
+                const qint64 start = timed ? CoreSampler::monotonicTime() : 0;
+                const int coresRead = sharedStateRead(&reader, nullptr, cores.data(), uint32_t(coresTotal));
+                if(timed)
+                    durations.push_back(CoreSampler::monotonicTime() - start);
+                readsTotal++;
+                if(coresRead < 0)
+                {
+                    busy[size_t(i)]++;
+                    continue;
+                }
+                for(int core = 1; core < coresRead; core++)
+                {
+                    if(cores[size_t(core)].currentFrequence != cores[0].currentFrequence)
+                    {
+                        torn[size_t(i)]++;
+                        break;
+                    }
+                }
+            }
+            reads[size_t(i)] = readsTotal;
+            sharedStateClose(&reader);
+        }));
+    }
+
+    const qint64 start = CoreSampler::monotonicTime();
+    const qint64 end = start + qint64(duration)*1000000;
+    qint64 deadline = start;
+    uint publishes = 0;
+    while(CoreSampler::monotonicTime() < end)
+    {
+        publishes++;
+        for(int core = 0; core < coresTotal; core++)
+            published.currentFrequences[core] = publishes;
+        const qint64 publishStart = CoreSampler::monotonicTime();
+        publisher.consume(published);
+        result.publishDurations.push_back(CoreSampler::monotonicTime() - publishStart);
+        deadline += qint64(period)*1000;
+        const qint64 now = CoreSampler::monotonicTime();
+        if(deadline > now)
+            QThread::usleep(static_cast<unsigned long>((deadline - now)/1000));
+    }
+    running.store(false, std::memory_order_relaxed);
+    for(std::thread &reader: readers)
+        reader.join();
+    publisher.close();
+    for(int i = 0; i < readersTotal; i++)
+    {
+        result.readDurations.insert(result.readDurations.end(), readDurations[size_t(i)].begin(), readDurations[size_t(i)].end());
+        result.reads += reads[size_t(i)];
+        result.busy += busy[size_t(i)];
+        result.torn += torn[size_t(i)];
+    }
+    return result;
+}
+
+struct ScrapeResult
+{
+    std::vector<qint64> renderDurations;
+    std::vector<qint64> scrapeDurations;
+    quint64 scrapes;
+    // Responses that were cut short or not 200, must stay 0.
+    quint64 failed;
+    quint64 skipped;
+};
+
+// Renders at `period` microseconds for `duration` milliseconds while `scrapersTotal` threads scrape
+//a Unix socket exporter in a loop, every scrape is a new connection like a collector's.
+ScrapeResult measureScrapes(const CoreStateStore &store, int scrapersTotal, int period, int duration, QString &error)
+{
+    ScrapeResult result;
+    result.scrapes = 0;
+    result.failed = 0;
+    result.skipped = 0;
+    const QByteArray path = (QDir::tempPath() + "/LinuxCpuInstrumentsBench-" + QString::number(getpid()) + ".sock").toLocal8Bit();
+    MetricsExporter exporter;
+    if(!exporter.listenUnix(QString::fromLocal8Bit(path)))
+    {
+        error = exporter.errorString();
+        return result;
+    }
+    exporter.consume(store);
+    exporter.start();
+    // Every 16th scrape is timed, arrays are allocated before the scrapers start.
+    const size_t samplesCapacity = 1 << 16;
+    std::atomic<bool> running(true);
+    std::vector<std::vector<qint64>> scrapeDurations(scrapersTotal);
+    std::vector<quint64> scrapes(size_t(scrapersTotal), 0);
+    std::vector<quint64> failed(size_t(scrapersTotal), 0);
+    std::vector<std::thread> scrapers;
+    for(int i = 0; i < scrapersTotal; i++)
+    {
+        scrapeDurations[size_t(i)].reserve(samplesCapacity);
+        scrapers.push_back(std::thread([&, i]()
+        {
+            sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, path.constData(), sizeof(address.sun_path) - 1);
+            static const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            std::vector<char> response(1 << 20);
+            std::vector<qint64> &durations = scrapeDurations[size_t(i)];
+            quint64 scrapesTotal = 0;
+            while(running.load(std::memory_order_relaxed))
+            {
+                const bool timed = (scrapesTotal & 15) == 0 && durations.size() < samplesCapacity;
+                const qint64 start = timed ? CoreSampler::monotonicTime() : 0;
+                scrapesTotal++;
+                const int descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if(descriptor < 0 || connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+                        || write(descriptor, request, sizeof(request) - 1) != ssize_t(sizeof(request) - 1))
+                {
+                    if(descriptor >= 0)
+                        close(descriptor);
+                    failed[size_t(i)]++;
+                    continue;
+                }
+                size_t received = 0;
+                ssize_t length;
+                while(received < response.size() && (length = read(descriptor, response.data() + received, response.size() - received)) > 0)
+                    received += size_t(length);
+                close(descriptor);
+                if(timed)
+                    durations.push_back(CoreSampler::monotonicTime() - start);
+                // Body must be as long as the header says.
+                response[std::min(received, response.size() - 1)] = '\0';
+                const char *contentLength = strstr(response.data(), "Content-Length: ");
+                const char *body = strstr(response.data(), "\r\n\r\n");
+                if(strncmp(response.data(), "HTTP/1.1 200", 12) != 0 || contentLength == nullptr || body == nullptr
+                        || size_t(atol(contentLength + 16)) != received - size_t(body + 4 - response.data()))
+                    failed[size_t(i)]++;
+            }
+            scrapes[size_t(i)] = scrapesTotal;
+        }));
+    }
+
+    CoreStateStore rendered = store;
+    const qint64 start = CoreSampler::monotonicTime();
+    const qint64 end = start + qint64(duration)*1000000;
+    qint64 deadline = start;
+    while(CoreSampler::monotonicTime() < end)
+    {
+        rendered.sequence++;
+        const qint64 renderStart = CoreSampler::monotonicTime();
+        exporter.consume(rendered);
+        result.renderDurations.push_back(CoreSampler::monotonicTime() - renderStart);
+        deadline += qint64(period)*1000;
+        const qint64 now = CoreSampler::monotonicTime();
+        if(deadline > now)
+            QThread::usleep(static_cast<unsigned long>((deadline - now)/1000));
+    }
+    running.store(false, std::memory_order_relaxed);
+    for(std::thread &scraper: scrapers)
+        scraper.join();
+    exporter.stop();
+    result.skipped = exporter.skippedTotal();
+    for(int i = 0; i < scrapersTotal; i++)
+    {
+        result.scrapeDurations.insert(result.scrapeDurations.end(), scrapeDurations[size_t(i)].begin(), scrapeDurations[size_t(i)].end());
+        result.scrapes += scrapes[size_t(i)];
+        result.failed += failed[size_t(i)];
+    }
+    return result;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("LinuxCpuInstrumentsBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures sampling and apply costs against fake sysfs trees.");
+    parser.addHelpOption();
+    QCommandLineOption coresOption(QStringList() << "c" << "cores", "Comma separated core counts, 1 to 1024 (default 1,16,256,1024).",
+                                   "counts", "1,16,256,1024");
+    QCommandLineOption policyOption("policy-size", "Cores per cpufreq policy (default 1).", "cores", "1");
+    QCommandLineOption ticksOption(QStringList() << "t" << "ticks", "Sampled ticks per tree (default 500).", "ticks", "500");
+    QCommandLineOption intervalOption(QStringList() << "i" << "interval", "Sampling interval in milliseconds (default 2).", "ms", "2");
+    QCommandLineOption startupsOption("startups", "Sampler constructions per tree, cold and warm (default 10).", "runs", "10");
+    QCommandLineOption appliesOption("applies", "Apply runs per tree, single core and all cores (default 50).", "runs", "50");
+    QCommandLineOption readersOption("readers", "Comma separated reader thread counts for shared memory (default 1,2,4,8).",
+                                     "counts", "1,2,4,8");
+    QCommandLineOption publishPeriodOption("publish-period", "Shared memory publish period in microseconds (default 1000).", "us", "1000");
+    QCommandLineOption publishDurationOption("publish-duration", "Shared memory run per reader count in milliseconds (default 500).",
+                                             "ms", "500");
+    parser.addOption(coresOption);
+    parser.addOption(policyOption);
+    parser.addOption(ticksOption);
+    parser.addOption(intervalOption);
+    parser.addOption(startupsOption);
+    parser.addOption(appliesOption);
+    parser.addOption(readersOption);
+    parser.addOption(publishPeriodOption);
+    QCommandLineOption scrapersOption("scrapers", "Comma separated scraper thread counts for the metrics exporter (default 1,4,16).",
+                                      "counts", "1,4,16");
+    QCommandLineOption scrapeDurationOption("scrape-duration", "Metrics exporter run per scraper count in milliseconds (default 500),"
+                                            " rendered every publish period.", "ms", "500");
+    parser.addOption(publishDurationOption);
+    parser.addOption(scrapersOption);
+    parser.addOption(scrapeDurationOption);
+    parser.process(application);
+
+    bool success = true;
+    QVector<int> coreCounts;
+    for(const QString &count: parser.value(coresOption).split(','))
+    {
+        int cores = count.trimmed().toInt(&success);
+        if(!success || cores < 1 || cores > 1024)
+        {
+            fprintf(stderr, "Core counts must be between 1 and 1024.\n");
+            return 1;
+        }
+        coreCounts.push_back(cores);
+    }
+    const int policySize = parser.value(policyOption).toInt(&success);
+    const int ticks = parser.value(ticksOption).toInt(&success);
+    const int interval = parser.value(intervalOption).toInt(&success);
+    const int startups = parser.value(startupsOption).toInt(&success);
+    const int applies = parser.value(appliesOption).toInt(&success);
+    if(policySize < 1 || ticks < 1 || interval < 1 || startups < 1 || applies < 1)
+    {
+        fprintf(stderr, "Policy size, ticks, interval, startups and applies must be positive.\n");
+        return 1;
+    }
+    QVector<int> readerCounts;
+    for(const QString &count: parser.value(readersOption).split(','))
+    {
+        int readers = count.trimmed().toInt(&success);
+        if(!success || readers < 0 || readers > 256)
+        {
+            fprintf(stderr, "Reader counts must be between 0 and 256.\n");
+            return 1;
+        }
+        readerCounts.push_back(readers);
+    }
+    const int publishPeriod = parser.value(publishPeriodOption).toInt(&success);
+    const int publishDuration = parser.value(publishDurationOption).toInt(&success);
+    if(publishPeriod < 1 || publishDuration < 1)
+    {
+        fprintf(stderr, "Publish period and duration must be positive.\n");
+        return 1;
+    }
+    QVector<int> scraperCounts;
+    for(const QString &count: parser.value(scrapersOption).split(','))
+    {
+        int scrapers = count.trimmed().toInt(&success);
+        if(!success || scrapers < 0 || scrapers > 256)
+        {
+            fprintf(stderr, "Scraper counts must be between 0 and 256.\n");
+            return 1;
+        }
+        scraperCounts.push_back(scrapers);
+    }
+    const int scrapeDuration = parser.value(scrapeDurationOption).toInt(&success);
+    if(!success || scrapeDuration < 1)
+    {
+        fprintf(stderr, "Scrape duration must be positive.\n");
+        return 1;
+    }
+
+    BulkApplier applier;
+    for(int coresTotal: coreCounts)
+    {
+        FakeSysfsTree tree(coresTotal, policySize);
+        if(tree.rootPath().isEmpty())
+        {
+            fprintf(stderr, "Cannot create a fake sysfs tree.\n");
+            return 1;
+        }
+        SysfsAttribute::setRootPath(tree.rootPath());
+        printf("%d cores, %d per policy, tree in %s\n", coresTotal, policySize, tree.rootPath().toLocal8Bit().constData());
+
+        const QString cachePath = TopologyCache::defaultPath();
+        printDistribution("startup cold", measureStartup(coresTotal, startups, cachePath), "us", NSEC_PER_USEC);
+        printDistribution("startup warm", measureStartup(coresTotal, startups, QString()), "us", NSEC_PER_USEC);
+
+        CoreSampler sampler(uint(coresTotal), interval);
+        TickSink sink(ticks);
+        sampler.addSink(&sink);
+        sampler.start(QThread::HighPriority);
+        while(!sink.isDone())
+            QThread::msleep(10);
+        sampler.stop();
+        sampler.removeSink(&sink);
+        printf("  tick reads through %s\n", sampler.isBatched() ? "io_uring" : "pread");
+        printDistribution("tick", sink.durations, "us", NSEC_PER_USEC);
+        printDistribution("allocations per tick", sink.allocations, "", 1);
+        if(sink.counter.isOpen())
+            printDistribution(sink.counter.isExact() ? "syscalls per tick" : "read/write syscalls", sink.syscalls, "", 1);
+
+        QString error;
+        printDistribution("apply single core", measureApply(sampler, applier, 1, applies, error), "us", NSEC_PER_USEC);
+        printDistribution("apply all cores", measureApply(sampler, applier, coresTotal, applies, error), "us", NSEC_PER_USEC);
+        if(!error.isEmpty())
+            printf("  apply failed: %s\n", error.toLocal8Bit().constData());
+
+        const CoreStateStore store = *sampler.snapshots().acquireLatest();
+        for(int readersTotal: readerCounts)
+        {
+            error.clear();
+            SharedStateResult result = measureSharedState(store, readersTotal, publishPeriod, publishDuration, error);
+            if(!error.isEmpty())
+            {
+                printf("  shared memory failed: %s\n", error.toLocal8Bit().constData());
+                break;
+            }
+            printf("  shared memory, %d readers: %.0f reads/s, %llu busy, %llu torn\n", readersTotal,
+                   double(result.reads)*1000/publishDuration, (unsigned long long)result.busy, (unsigned long long)result.torn);
+            printDistribution("publish", result.publishDurations, "ns", 1);
+            if(readersTotal > 0)
+                printDistribution("read", result.readDurations, "ns", 1);
+        }
+        for(int scrapersTotal: scraperCounts)
+        {
+            error.clear();
+            ScrapeResult result = measureScrapes(store, scrapersTotal, publishPeriod, scrapeDuration, error);
+            if(!error.isEmpty())
+            {
+                printf("  metrics failed: %s\n", error.toLocal8Bit().constData());
+                break;
+            }
+            printf("  metrics, %d scrapers: %.0f scrapes/s, %llu failed, %llu renders skipped\n", scrapersTotal,
+                   double(result.scrapes)*1000/scrapeDuration, (unsigned long long)result.failed, (unsigned long long)result.skipped);
+            printDistribution("render", result.renderDurations, "us", NSEC_PER_USEC);
+            if(scrapersTotal > 0)
+                printDistribution("scrape", result.scrapeDurations, "us", NSEC_PER_USEC);
+        }
+        fflush(stdout);
+    }
+    SysfsAttribute::setRootPath(QString());
+    return 0;
+}
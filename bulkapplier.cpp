@@ -0,0 +1,115 @@
+#include "bulkapplier.h"
+
+#include <QHash>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <stdexcept>
+
+#include "trace.h"
+
+namespace
+{
+// Cores per task, big enough to amortize the queue, small enough to balance slow governor switches.
+const int coresPerTask = 8;
+
+class ApplyTask : public QRunnable
+{
+public:
+    ApplyTask(const QVector<const LogicCore*> &cores, int first, int last, const QVector<LogicCore::ApplySettings> &settings,
+              const CoreStateStore &current, const QVector<bool> &writesPolicy, BulkApplier::Result *results):
+        cores(cores),
+        first(first),
+        last(last),
+        settings(settings),
+        current(current),
+        writesPolicy(writesPolicy),
+        results(results)
+    {
+    }
+
+    void run() override
+    {
+        // Every task writes only its own range of results.
+        for(int i = this->first; i < this->last; i++)
+        {
+            try
+            {
+                this->cores[i]->apply(this->settings[i], this->current, this->writesPolicy[i]);
+            }
+            catch(const std::logic_error &error)
+            {
+                this->results[i].error = error.what();
+            }
+        }
+    }
+
+private:
+    const QVector<const LogicCore*> &cores;
+    const int first;
+    const int last;
+    const QVector<LogicCore::ApplySettings> &settings;
+    const CoreStateStore &current;
+    const QVector<bool> &writesPolicy;
+    BulkApplier::Result *results;
+};
+
+bool changesPolicy(const LogicCore::ApplySettings &settings, const CoreStateStore &current, int core)
+{
+    return (settings.governor != GovernorTable::unknownGovernor && settings.governor != current.governors[core])
+            || settings.minScalingFrequence != current.minScalingFrequences[core]
+            || settings.maxScalingFrequence != current.maxScalingFrequences[core];
+}
+}
+
+BulkApplier::BulkApplier(int threadsTotal)
+{
+    this->pool.setMaxThreadCount(threadsTotal > 0 ? threadsTotal : QThread::idealThreadCount());
+}
+
+BulkApplier::~BulkApplier()
+{
+    this->pool.waitForDone();
+}
+
+QVector<BulkApplier::Result> BulkApplier::apply(const QVector<const LogicCore*> &cores, const QVector<LogicCore::ApplySettings> &settings,
+                                                const CoreStateStore &current)
+{
+    TRACE_SCOPE("BulkApplier::apply");
+    QVector<Result> results(cores.size());
+    QVector<bool> writesPolicy(cores.size());
+    // Policy leader number to the index of the core that writes the policy.
+    QHash<uint, int> writers;
+    for(int i = 0; i < cores.size(); i++)
+    {
+        const uint core = cores[i]->getNumber();
+        results[i].coreNumber = core;
+        const bool online = core == 0 || settings[i].online || current.online[int(core)];
+        const uint policy = cores[i]->getPolicyLeaderNumber();
+        if(online && !writers.contains(policy))
+            writers.insert(policy, i);
+    }
+    QSet<uint> reported;
+    for(int i = 0; i < cores.size(); i++)
+    {
+        const uint policy = cores[i]->getPolicyLeaderNumber();
+        writesPolicy[i] = writers.value(policy, -1) == i;
+        if(writers.contains(policy) || reported.contains(policy))
+            continue;
+        reported.insert(policy);
+        if(changesPolicy(settings[i], current, int(results[i].coreNumber)))
+            results[i].error = "Policy of core " + QString::number(results[i].coreNumber)
+                    + " has no online core to write scaling limits and governor through.";
+    }
+    // Tasks write through a raw pointer, so the vector is never detached from worker threads.
+    Result *resultsData = results.data();
+    for(int first = 0; first < cores.size(); first += coresPerTask)
+    {
+        int last = first + coresPerTask;
+        if(last > cores.size())
+            last = cores.size();
+        this->pool.start(new ApplyTask(cores, first, last, settings, current, writesPolicy, resultsData));
+    }
+    this->pool.waitForDone();
+    return results;
+}
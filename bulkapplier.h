@@ -0,0 +1,41 @@
+#ifndef BULKAPPLIER_H
+#define BULKAPPLIER_H
+
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include "logiccore.h"
+#include "corestatestore.h"
+
+// Applies settings to many cores at once on a pool of worker threads.
+// Policy attributes are written through the first listed core of every cpufreq policy that is online
+//before or after the apply, cpufreq files of an offline core can't be written. A policy without such a core
+//fails on its first listed core when its attributes would change.
+// Every core is applied independently, a failure on one core doesn't stop the others.
+class BulkApplier
+{
+public:
+    struct Result
+    {
+        uint coreNumber;
+        // Empty on success.
+        QString error;
+    };
+
+    // threadsTotal 0 means QThread::idealThreadCount().
+    explicit BulkApplier(int threadsTotal = 0);
+    ~BulkApplier();
+    BulkApplier(const BulkApplier &) = delete;
+    BulkApplier &operator=(const BulkApplier &) = delete;
+
+    // Blocks until every core is done. settings[i] is applied to cores[i], `current` is the latest snapshot,
+    //results are in the order of `cores`.
+    QVector<Result> apply(const QVector<const LogicCore*> &cores, const QVector<LogicCore::ApplySettings> &settings,
+                          const CoreStateStore &current);
+
+private:
+    QThreadPool pool;
+};
+
+#endif // BULKAPPLIER_H
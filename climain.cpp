@@ -0,0 +1,780 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSocketNotifier>
+#include <QMetaObject>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+
+#include "coresampler.h"
+#include "streamwriter.h"
+#include "historyrecorder.h"
+#include "sharedstatepublisher.h"
+#include "metricsexporter.h"
+#include "profilefile.h"
+#include "profilereconciler.h"
+#include "frequencecontroller.h"
+#include "transitionprofiler.h"
+#include "loadgenerator.h"
+
+namespace
+{
+// Termination signals are blocked and read from this signalfd, modes without an event loop poll it.
+int signalDescriptor = -1;
+
+// Waits up to `timeout` milliseconds for a termination signal, true when one arrived.
+//The signal is consumed, so the restore path after it can wait again.
+bool waitForSignal(int timeout)
+{
+    pollfd descriptor;
+    descriptor.fd = signalDescriptor;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+    if(poll(&descriptor, 1, timeout) <= 0)
+        return false;
+    signalfd_siginfo information;
+    return read(signalDescriptor, &information, sizeof(information)) == ssize_t(sizeof(information));
+}
+
+// Value at `fraction` of already sorted values.
+qint64 percentile(const std::vector<qint64> &values, double fraction)
+{
+    return values[size_t(fraction*double(values.size() - 1) + 0.5)];
+}
+
+// Distributions over trials for every measured core and for all of them together.
+void printTransitions(FILE *output, const TransitionProfiler &profiler)
+{
+    const char *directionNames[TransitionProfiler::DirectionCount] = {"change", "restore"};
+    const int coresTotal = profiler.cores().size();
+    fprintf(output, "%d trials, %llu samples, %.1f us between rounds\n", profiler.trialsDone(),
+            (unsigned long long)profiler.samplesTotal(), double(profiler.meanSamplePeriod())/1000);
+    for(int direction = 0; direction < TransitionProfiler::DirectionCount; direction++)
+    {
+        for(int core = -1; core < coresTotal; core++)
+        {
+            std::vector<qint64> settleTimes;
+            std::vector<qint64> overshoots;
+            std::vector<qint64> frequences;
+            int measured = 0;
+            int unchanged = 0;
+            for(int trial = 0; trial < profiler.trialsDone(); trial++)
+            {
+                for(int i = 0; i < coresTotal; i++)
+                {
+                    if(core >= 0 && i != core)
+                        continue;
+                    const TransitionProfiler::Measurement &measurement =
+                            profiler.measurement(TransitionProfiler::Direction(direction), trial, i);
+                    measured++;
+                    if(measurement.outcome == TransitionProfiler::UnchangedOutcome)
+                        unchanged++;
+                    if(measurement.outcome != TransitionProfiler::SettledOutcome)
+                        continue;
+                    settleTimes.push_back(measurement.settleTime);
+                    overshoots.push_back(measurement.overshoot);
+                    frequences.push_back(measurement.settledFrequence);
+                }
+            }
+            const QString name = core < 0 ? QString("all cores") : "core " + QString::number(profiler.cores()[core]);
+            const int timedOut = measured - int(settleTimes.size()) - unchanged;
+            if(settleTimes.empty())
+            {
+                fprintf(output, "%s %s: %d of %d timed out, %d no change observed\n", directionNames[direction],
+                        name.toLocal8Bit().constData(), timedOut, measured, unchanged);
+                continue;
+            }
+            std::sort(settleTimes.begin(), settleTimes.end());
+            std::sort(overshoots.begin(), overshoots.end());
+            std::sort(frequences.begin(), frequences.end());
+            fprintf(output, "%s %s: settle min %.3f median %.3f p90 %.3f p99 %.3f max %.3f ms, %d of %d timed out, "
+                    "%d no change observed, overshoot median %lld max %lld kHz, settled at median %lld kHz\n",
+                    directionNames[direction], name.toLocal8Bit().constData(),
+                    double(settleTimes.front())/1000000, double(percentile(settleTimes, 0.5))/1000000,
+                    double(percentile(settleTimes, 0.9))/1000000, double(percentile(settleTimes, 0.99))/1000000,
+                    double(settleTimes.back())/1000000, timedOut, measured, unchanged, (long long)percentile(overshoots, 0.5),
+                    (long long)overshoots.back(), (long long)percentile(frequences, 0.5));
+        }
+    }
+}
+
+// "all", a core number or a range like 0-3, all leaves `cores` empty.
+bool parseCores(const QString &text, QVector<int> &cores)
+{
+    if(text == "all")
+        return true;
+    bool firstParsed = true;
+    bool lastParsed = true;
+    const int first = text.section('-', 0, 0).toInt(&firstParsed);
+    const int last = text.contains('-') ? text.section('-', 1, 1).toInt(&lastParsed) : first;
+    if(!firstParsed || !lastParsed || first > last)
+        return false;
+    for(int core = first; core <= last; core++)
+        cores.push_back(core);
+    return true;
+}
+
+void printDriftLog(const ProfileReconciler &reconciler, quint64 &printedEntries)
+{
+    quint64 index = qMax(printedEntries, reconciler.oldestLogEntry());
+    for(; index < reconciler.logTotal(); index++)
+    {
+        const ProfileReconciler::DriftEntry &entry = reconciler.logEntry(index);
+        fprintf(stderr, "%s logic core %u %s was %s, expected %s%s%s\n",
+                entry.drifted ? "drift:" : "apply:", entry.coreNumber, entry.attribute,
+                entry.found.toLocal8Bit().constData(), entry.expected.toLocal8Bit().constData(),
+                entry.error.isEmpty() ? "" : ", not corrected: ", entry.error.toLocal8Bit().constData());
+    }
+    printedEntries = index;
+}
+
+// Drains the ring until a snapshot taken after `timestamp` shows up, the sampler thread must run.
+//Nullptr when a termination signal arrived first.
+const CoreStateStore *waitForSnapshot(CoreSampler &sampler, qint64 timestamp)
+{
+    const CoreStateStore *current = nullptr;
+    for(;;)
+    {
+        const CoreStateStore *next;
+        while((next = sampler.snapshots().acquireNext()) != nullptr)
+            current = next;
+        if(current != nullptr && current->timestamp > timestamp)
+            return current;
+        if(waitForSignal(10))
+            return nullptr;
+    }
+}
+
+// Writes the profile through the reconciler and waits for a snapshot showing it. False when
+//some attribute couldn't be written or a termination signal arrived, the log is printed either way.
+bool applyLoadProfile(CoreSampler &sampler, ProfileReconciler &reconciler, const Profile &profile, int interval)
+{
+    reconciler.setProfile(profile, interval);
+    // Ticks starting after subscribe() read the profile's attributes.
+    const int subscription = sampler.subscribe(reconciler.cores(), reconciler.attributes(), interval);
+    quint64 printedEntries = reconciler.logTotal();
+    const quint64 firstEntry = printedEntries;
+    const CoreStateStore *current = waitForSnapshot(sampler, CoreSampler::monotonicTime());
+    if(current == nullptr)
+    {
+        sampler.unsubscribe(subscription);
+        return false;
+    }
+    reconciler.reconcile(*current);
+    printDriftLog(reconciler, printedEntries);
+    bool applied = true;
+    for(quint64 index = qMax(firstEntry, reconciler.oldestLogEntry()); index < reconciler.logTotal(); index++)
+        applied = applied && reconciler.logEntry(index).error.isEmpty();
+    if(waitForSnapshot(sampler, CoreSampler::monotonicTime()) == nullptr)
+        applied = false;
+    sampler.unsubscribe(subscription);
+    return applied;
+}
+
+struct LoadRun
+{
+    QString profileName;
+    QVector<LoadGenerator::CoreResult> results;
+    qint64 duration;
+};
+
+// One summary line per profile, then every core with a column pair per profile.
+void printLoadRuns(FILE *output, const LoadGenerator::Settings &settings, const QVector<LoadRun> &runs)
+{
+    fprintf(output, "%s work, %d %% of %d ms periods\n", LoadGenerator::workTypeName(settings.work),
+            settings.dutyCycle, settings.period);
+    fprintf(output, "%-16s %8s %14s %14s %10s %14s\n", "profile", "seconds", "ops/s", "ops/s per core", "mean MHz",
+            "ops/s per MHz");
+    for(const LoadRun &run: runs)
+    {
+        double operations = 0;
+        double frequences = 0;
+        int sampledCores = 0;
+        for(const LoadGenerator::CoreResult &result: run.results)
+        {
+            operations += result.operationsPerSecond;
+            if(result.frequence > 0)
+            {
+                frequences += result.frequence/1000;
+                sampledCores++;
+            }
+        }
+        const double perCore = run.results.isEmpty() ? 0 : operations/run.results.size();
+        const double meanFrequence = sampledCores > 0 ? frequences/sampledCores : 0;
+        fprintf(output, "%-16s %8.3f %14.4g %14.4g %10.0f %14.4g\n", run.profileName.toLocal8Bit().constData(),
+                double(run.duration)/1000000000, operations, perCore, meanFrequence,
+                meanFrequence > 0 ? perCore/meanFrequence : 0.0);
+    }
+    if(runs.isEmpty())
+        return;
+    fprintf(output, "%-6s", "core");
+    for(const LoadRun &run: runs)
+        fprintf(output, " %14s %7s", run.profileName.left(14).toLocal8Bit().constData(), "MHz");
+    fprintf(output, "\n");
+    for(int i = 0; i < runs.front().results.size(); i++)
+    {
+        fprintf(output, "%-6d", runs.front().results[i].core);
+        for(const LoadRun &run: runs)
+        {
+            if(i < run.results.size())
+                fprintf(output, " %14.4g %7.0f", run.results[i].operationsPerSecond, run.results[i].frequence/1000);
+        }
+        fprintf(output, "\n");
+    }
+}
+}
+
+// Headless sampler: streams per-core state to stdout or a file, no widgets involved.
+int main(int argc, char *argv[])
+{
+    // Block termination signals before the sampler thread starts,
+    //they are read from a signalfd in the event loop instead.
+    sigset_t terminationSignals;
+    sigemptyset(&terminationSignals);
+    sigaddset(&terminationSignals, SIGINT);
+    sigaddset(&terminationSignals, SIGTERM);
+    sigaddset(&terminationSignals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &terminationSignals, nullptr);
+    signalDescriptor = signalfd(-1, &terminationSignals, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("LinuxCpuInstrumentsCli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Streams logic core frequences, governors, online state and load.");
+    parser.addHelpOption();
+    QCommandLineOption intervalOption(QStringList() << "i" << "interval", "Sampling interval in milliseconds (default 1000).", "ms", "1000");
+    QCommandLineOption formatOption(QStringList() << "f" << "format", "Output format: csv or binary (default csv).", "format", "csv");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output file (default standard output).", "file");
+    QCommandLineOption countOption(QStringList() << "n" << "count", "Stop after this many samples (default 0, run until interrupted).", "samples", "0");
+    QCommandLineOption recordOption("record", "Also keep the latest samples in a memory-mapped history file.", "file");
+    QCommandLineOption recordCapacityOption("record-capacity", "Samples kept in the history file (default 360000).", "samples", "360000");
+    QCommandLineOption rootOption("sysfs-root", "Read /sys and /proc below this directory, e.g. a tree made by the benchmark.", "dir");
+    QCommandLineOption coresOption("cores", "Number of logic cores (default all configured cores).", "count");
+    QCommandLineOption sharedMemoryOption("shared-memory", QString("Also publish every sample for other processes in this POSIX shared memory "
+                                          "segment, e.g. %1 (see sharedstate.h).").arg(SHARED_STATE_DEFAULT_NAME), "name");
+    QCommandLineOption profileOption("profile", "Keep logic cores on a profile from this file, drift is logged to standard error.", "file");
+    QCommandLineOption profileNameOption("profile-name", "Profile to enforce (default the first one in the file).", "name");
+    parser.addOption(intervalOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(countOption);
+    parser.addOption(recordOption);
+    parser.addOption(recordCapacityOption);
+    parser.addOption(rootOption);
+    parser.addOption(coresOption);
+    parser.addOption(sharedMemoryOption);
+    QCommandLineOption metricsPortOption("metrics-port", "Also serve the latest sample in the Prometheus text format over HTTP "
+                                         "on this localhost port.", "port");
+    QCommandLineOption metricsSocketOption("metrics-socket", "Serve the metrics on this Unix socket instead of a port.", "path");
+    const FrequenceController::Settings controllerDefaults = FrequenceController::defaultSettings();
+    QCommandLineOption controllerOption("controller", "Control frequences from core loads: limit moves scaling_max_freq under the current "
+                                        "governor, setspeed drives the userspace governor. Decisions are logged to standard error.", "mode");
+    QCommandLineOption controllerIntervalOption("controller-interval", QString("Milliseconds between control steps (default %1).")
+                                                .arg(controllerDefaults.interval), "ms", QString::number(controllerDefaults.interval));
+    QCommandLineOption controllerUpLoadOption("controller-up-load", QString("Load in percents above which frequence goes up (default %1).")
+                                              .arg(double(controllerDefaults.upLoad)), "percents", QString::number(double(controllerDefaults.upLoad)));
+    QCommandLineOption controllerDownLoadOption("controller-down-load", QString("Load in percents below which frequence goes down "
+                                                "(default %1).").arg(double(controllerDefaults.downLoad)), "percents",
+                                                QString::number(double(controllerDefaults.downLoad)));
+    QCommandLineOption controllerRampUpOption("controller-ramp-up", QString("Fastest rise in kHz per second (default %1).")
+                                              .arg(controllerDefaults.rampUp), "kHz/s", QString::number(controllerDefaults.rampUp));
+    QCommandLineOption controllerRampDownOption("controller-ramp-down", QString("Fastest fall in kHz per second (default %1).")
+                                                .arg(controllerDefaults.rampDown), "kHz/s", QString::number(controllerDefaults.rampDown));
+    QCommandLineOption controllerUpLatencyOption("controller-up-latency", QString("Milliseconds from the lowest to the highest frequence "
+                                                 "under load, raises the up ramp (default %1, 0 off).").arg(controllerDefaults.upLatency),
+                                                 "ms", QString::number(controllerDefaults.upLatency));
+    QCommandLineOption controllerDownDelayOption("controller-down-delay", QString("Milliseconds of low load before frequence goes down "
+                                                 "(default %1).").arg(controllerDefaults.downDelay), "ms",
+                                                 QString::number(controllerDefaults.downDelay));
+    const TransitionProfiler::Settings transitionDefaults = TransitionProfiler::defaultSettings();
+    QCommandLineOption transitionGovernorOption("transition-governor", "Instead of streaming, measure how long cores take to settle "
+                                                "after switching to this governor and back, report to the output.", "governor");
+    QCommandLineOption transitionMaxOption("transition-max", "Same for a change of scaling max frequence to this value.", "kHz");
+    QCommandLineOption transitionCoresOption("transition-cores", "Cores measured, all, a number or a range like 0-3 (default all).",
+                                             "cores", "all");
+    QCommandLineOption transitionTrialsOption("transition-trials", QString("Changes measured per direction (default %1).")
+                                              .arg(transitionDefaults.trials), "trials", QString::number(transitionDefaults.trials));
+    QCommandLineOption transitionPeriodOption("transition-period", QString("Microseconds between reads of scaling_cur_freq (default %1).")
+                                              .arg(transitionDefaults.samplePeriod), "us", QString::number(transitionDefaults.samplePeriod));
+    QCommandLineOption transitionWindowOption("transition-window", QString("Milliseconds within tolerance that count as settled "
+                                              "(default %1).").arg(transitionDefaults.settleWindow), "ms",
+                                              QString::number(transitionDefaults.settleWindow));
+    QCommandLineOption transitionTimeoutOption("transition-timeout", QString("Milliseconds a trial waits for a core (default %1).")
+                                               .arg(transitionDefaults.timeout), "ms", QString::number(transitionDefaults.timeout));
+    QCommandLineOption transitionToleranceOption("transition-tolerance", QString("Frequence noise ignored while settling in kHz "
+                                                 "(default %1).").arg(transitionDefaults.tolerance), "kHz",
+                                                 QString::number(transitionDefaults.tolerance));
+    parser.addOption(profileOption);
+    parser.addOption(profileNameOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(metricsSocketOption);
+    parser.addOption(controllerOption);
+    parser.addOption(controllerIntervalOption);
+    parser.addOption(controllerUpLoadOption);
+    parser.addOption(controllerDownLoadOption);
+    parser.addOption(controllerRampUpOption);
+    parser.addOption(controllerRampDownOption);
+    parser.addOption(controllerUpLatencyOption);
+    parser.addOption(controllerDownDelayOption);
+    parser.addOption(transitionGovernorOption);
+    parser.addOption(transitionMaxOption);
+    parser.addOption(transitionCoresOption);
+    parser.addOption(transitionTrialsOption);
+    parser.addOption(transitionPeriodOption);
+    parser.addOption(transitionWindowOption);
+    parser.addOption(transitionTimeoutOption);
+    parser.addOption(transitionToleranceOption);
+    const LoadGenerator::Settings loadDefaults = LoadGenerator::defaultSettings();
+    QCommandLineOption loadDurationOption("load-duration", "Instead of streaming, load cores with pinned workers this many milliseconds "
+                                          "and report throughput and frequences (default 5000 with --load-profiles).", "ms", "5000");
+    QCommandLineOption loadProfilesOption("load-profiles", "Repeat the load under every profile of this file after the current settings, "
+                                          "which are restored at the end.", "file");
+    QCommandLineOption loadCoresOption("load-cores", "Cores loaded, all, a number or a range like 0-3 (default all online).",
+                                       "cores", "all");
+    QCommandLineOption loadWorkOption("load-work", QString("Work of every worker: integer, memory or branchy (default %1).")
+                                      .arg(LoadGenerator::workTypeName(loadDefaults.work)), "work",
+                                      LoadGenerator::workTypeName(loadDefaults.work));
+    QCommandLineOption loadDutyOption("load-duty", QString("Percents of every period spent working (default %1).")
+                                      .arg(loadDefaults.dutyCycle), "percents", QString::number(loadDefaults.dutyCycle));
+    QCommandLineOption loadPeriodOption("load-period", QString("Milliseconds of a work and sleep period (default %1).")
+                                        .arg(loadDefaults.period), "ms", QString::number(loadDefaults.period));
+    QCommandLineOption loadWarmupOption("load-warmup", QString("Milliseconds of load not counted before every measurement (default %1).")
+                                        .arg(loadDefaults.warmup), "ms", QString::number(loadDefaults.warmup));
+    parser.addOption(loadDurationOption);
+    parser.addOption(loadProfilesOption);
+    parser.addOption(loadCoresOption);
+    parser.addOption(loadWorkOption);
+    parser.addOption(loadDutyOption);
+    parser.addOption(loadPeriodOption);
+    parser.addOption(loadWarmupOption);
+    parser.process(application);
+
+    bool success = true;
+    int interval = parser.value(intervalOption).toInt(&success);
+    if(!success || interval < 1)
+    {
+        fprintf(stderr, "Interval must be a positive number of milliseconds.\n");
+        return 1;
+    }
+    quint64 count = parser.value(countOption).toULongLong(&success);
+    if(!success)
+    {
+        fprintf(stderr, "Count must be a non-negative number.\n");
+        return 1;
+    }
+    quint64 recordCapacity = parser.value(recordCapacityOption).toULongLong(&success);
+    if(!success || recordCapacity == 0)
+    {
+        fprintf(stderr, "Record capacity must be a positive number.\n");
+        return 1;
+    }
+    uint coresTotal = uint(sysconf(_SC_NPROCESSORS_CONF));
+    if(parser.isSet(coresOption))
+    {
+        coresTotal = parser.value(coresOption).toUInt(&success);
+        if(!success || coresTotal == 0)
+        {
+            fprintf(stderr, "Number of cores must be a positive number.\n");
+            return 1;
+        }
+    }
+    quint16 metricsPort = 0;
+    if(parser.isSet(metricsPortOption))
+    {
+        metricsPort = parser.value(metricsPortOption).toUShort(&success);
+        if(!success || metricsPort == 0)
+        {
+            fprintf(stderr, "Metrics port must be a number from 1 to 65535.\n");
+            return 1;
+        }
+    }
+    if(parser.isSet(rootOption))
+        SysfsAttribute::setRootPath(parser.value(rootOption));
+    ProfileFile profileFile;
+    const Profile *profile = nullptr;
+    if(parser.isSet(profileOption))
+    {
+        if(!profileFile.load(parser.value(profileOption)))
+        {
+            fprintf(stderr, "%s\n", profileFile.errorString().toLocal8Bit().constData());
+            return 1;
+        }
+        if(parser.isSet(profileNameOption))
+            profile = profileFile.find(parser.value(profileNameOption));
+        else if(!profileFile.getProfiles().isEmpty())
+            profile = &profileFile.getProfiles().first();
+        if(profile == nullptr)
+        {
+            fprintf(stderr, "Profile not found.\n");
+            return 1;
+        }
+    }
+    FrequenceController::Settings controllerSettings = controllerDefaults;
+    if(parser.isSet(controllerOption))
+    {
+        if(parser.value(controllerOption) == "limit")
+            controllerSettings.mode = FrequenceController::LimitMode;
+        else if(parser.value(controllerOption) == "setspeed")
+            controllerSettings.mode = FrequenceController::SetspeedMode;
+        else
+        {
+            fprintf(stderr, "Unknown controller mode, use limit or setspeed.\n");
+            return 1;
+        }
+        // Both would write scaling limits and undo each other.
+        if(profile != nullptr)
+        {
+            fprintf(stderr, "Controller and profile can't be used together.\n");
+            return 1;
+        }
+        bool parsed[7];
+        controllerSettings.interval = parser.value(controllerIntervalOption).toInt(&parsed[0]);
+        controllerSettings.upLoad = parser.value(controllerUpLoadOption).toFloat(&parsed[1]);
+        controllerSettings.downLoad = parser.value(controllerDownLoadOption).toFloat(&parsed[2]);
+        controllerSettings.rampUp = parser.value(controllerRampUpOption).toUInt(&parsed[3]);
+        controllerSettings.rampDown = parser.value(controllerRampDownOption).toUInt(&parsed[4]);
+        controllerSettings.upLatency = parser.value(controllerUpLatencyOption).toInt(&parsed[5]);
+        controllerSettings.downDelay = parser.value(controllerDownDelayOption).toInt(&parsed[6]);
+        for(bool valid: parsed)
+        {
+            if(!valid)
+            {
+                fprintf(stderr, "Controller options must be numbers.\n");
+                return 1;
+            }
+        }
+    }
+    TransitionProfiler::Settings transitionSettings = transitionDefaults;
+    const bool profileTransitions = parser.isSet(transitionGovernorOption) || parser.isSet(transitionMaxOption);
+    if(profileTransitions)
+    {
+        bool parsed[7];
+        parsed[0] = true;
+        if(parser.isSet(transitionMaxOption))
+            transitionSettings.maxScalingFrequence = parser.value(transitionMaxOption).toUInt(&parsed[0]);
+        transitionSettings.trials = parser.value(transitionTrialsOption).toInt(&parsed[1]);
+        transitionSettings.samplePeriod = parser.value(transitionPeriodOption).toInt(&parsed[2]);
+        transitionSettings.settleWindow = parser.value(transitionWindowOption).toInt(&parsed[3]);
+        transitionSettings.timeout = parser.value(transitionTimeoutOption).toInt(&parsed[4]);
+        transitionSettings.tolerance = parser.value(transitionToleranceOption).toUInt(&parsed[5]);
+        parsed[6] = parseCores(parser.value(transitionCoresOption), transitionSettings.cores);
+        for(bool valid: parsed)
+        {
+            if(!valid)
+            {
+                fprintf(stderr, "Transition options must be numbers, cores all, a number or a range like 0-3.\n");
+                return 1;
+            }
+        }
+    }
+    LoadGenerator::Settings loadSettings = loadDefaults;
+    int loadDuration = 0;
+    ProfileFile loadProfiles;
+    const bool generateLoad = parser.isSet(loadDurationOption) || parser.isSet(loadProfilesOption);
+    if(generateLoad)
+    {
+        if(profile != nullptr || parser.isSet(controllerOption) || profileTransitions)
+        {
+            fprintf(stderr, "Load generator can't be used with a profile, the controller or transition profiling.\n");
+            return 1;
+        }
+        if(!LoadGenerator::findWorkType(parser.value(loadWorkOption), loadSettings.work))
+        {
+            fprintf(stderr, "Unknown work, use integer, memory or branchy.\n");
+            return 1;
+        }
+        bool parsed[5];
+        loadDuration = parser.value(loadDurationOption).toInt(&parsed[0]);
+        loadSettings.dutyCycle = parser.value(loadDutyOption).toInt(&parsed[1]);
+        loadSettings.period = parser.value(loadPeriodOption).toInt(&parsed[2]);
+        loadSettings.warmup = parser.value(loadWarmupOption).toInt(&parsed[3]);
+        parsed[4] = parseCores(parser.value(loadCoresOption), loadSettings.cores);
+        for(bool valid: parsed)
+        {
+            if(!valid || loadDuration < 1)
+            {
+                fprintf(stderr, "Load options must be numbers, a positive duration, cores all, a number or a range like 0-3.\n");
+                return 1;
+            }
+        }
+        if(parser.isSet(loadProfilesOption) && !loadProfiles.load(parser.value(loadProfilesOption)))
+        {
+            fprintf(stderr, "%s\n", loadProfiles.errorString().toLocal8Bit().constData());
+            return 1;
+        }
+    }
+    StreamWriter::Format format;
+    if(parser.value(formatOption) == "csv")
+        format = StreamWriter::CsvFormat;
+    else if(parser.value(formatOption) == "binary")
+        format = StreamWriter::BinaryFormat;
+    else
+    {
+        fprintf(stderr, "Unknown format, use csv or binary.\n");
+        return 1;
+    }
+
+    FILE *output = stdout;
+    if(parser.isSet(outputOption))
+    {
+        output = fopen(parser.value(outputOption).toLocal8Bit().constData(), "wb");
+        if(output == nullptr)
+        {
+            perror("Cannot open output file");
+            return 1;
+        }
+    }
+    // Large stdio buffer so fast sampling rates cost few write() calls.
+    setvbuf(output, nullptr, _IOFBF, 1 << 20);
+
+    int result = 0;
+    try
+    {
+        CoreSampler sampler(coresTotal, interval);
+        if(profileTransitions)
+        {
+            // Sampler thread isn't started, the profiler is the only one touching cpufreq files.
+            TransitionProfiler profiler(sampler);
+            // Governor names are interned while the cores read them, the table is empty before the sampler exists.
+            if(parser.isSet(transitionGovernorOption))
+            {
+                transitionSettings.governor = GovernorTable::instance().find(parser.value(transitionGovernorOption));
+                if(transitionSettings.governor == GovernorTable::unknownGovernor)
+                {
+                    fprintf(stderr, "Unknown governor.\n");
+                    return 1;
+                }
+            }
+            if(!profiler.prepare(transitionSettings, *sampler.snapshots().acquireLatest()))
+            {
+                fprintf(stderr, "%s\n", profiler.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            profiler.start(QThread::TimeCriticalPriority);
+            // Interrupted trials are dropped, the profiler writes the state from before back and finishes.
+            bool interrupted = false;
+            while(!profiler.wait(50))
+            {
+                if(!interrupted && waitForSignal(0))
+                {
+                    interrupted = true;
+                    profiler.requestInterruption();
+                }
+            }
+            printTransitions(output, profiler);
+            fflush(output);
+            if(interrupted)
+            {
+                fprintf(stderr, "Interrupted after %d trials.\n", profiler.trialsDone());
+                return 1;
+            }
+            if(!profiler.errorString().isEmpty())
+            {
+                fprintf(stderr, "%s\n", profiler.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            return 0;
+        }
+        if(generateLoad)
+        {
+            // Frequences are averaged from the sampled snapshots, often enough to follow governors.
+            const int loadSampleInterval = 100;
+            LoadGenerator generator;
+            sampler.addSink(&generator);
+            sampler.subscribe(loadSettings.cores, SamplingPlan::attribute(LogicCore::CurrentFrequenceAttribute), loadSampleInterval);
+            // Snapshot published by the constructor, taken before anything is written.
+            QVector<Profile> profiles;
+            profiles.push_back(ProfileFile::capture("current", *sampler.snapshots().acquireLatest()));
+            profiles += loadProfiles.getProfiles();
+            BulkApplier bulkApplier;
+            ProfileReconciler reconciler(sampler, bulkApplier);
+            QVector<LoadRun> runs;
+            sampler.start(QThread::HighPriority);
+            // A termination signal stops the run in progress, settings from before are restored below.
+            for(const Profile &profile: profiles)
+            {
+                if(!applyLoadProfile(sampler, reconciler, profile, loadSampleInterval))
+                {
+                    fprintf(stderr, "Profile %s couldn't be applied.\n", profile.name.toLocal8Bit().constData());
+                    result = 1;
+                    break;
+                }
+                const CoreStateStore *current = waitForSnapshot(sampler, CoreSampler::monotonicTime());
+                if(current == nullptr)
+                {
+                    fprintf(stderr, "Interrupted.\n");
+                    result = 1;
+                    break;
+                }
+                if(!generator.start(loadSettings, *current))
+                {
+                    fprintf(stderr, "%s\n", generator.errorString().toLocal8Bit().constData());
+                    result = 1;
+                    break;
+                }
+                const bool interrupted = waitForSignal(loadSettings.warmup + loadDuration);
+                generator.stop();
+                if(interrupted)
+                {
+                    fprintf(stderr, "Interrupted during profile %s.\n", profile.name.toLocal8Bit().constData());
+                    result = 1;
+                    break;
+                }
+                if(!generator.errorString().isEmpty())
+                    fprintf(stderr, "%s\n", generator.errorString().toLocal8Bit().constData());
+                LoadRun run;
+                run.profileName = profile.name;
+                run.results = generator.results();
+                run.duration = generator.measuredDuration();
+                runs.push_back(run);
+            }
+            if(profiles.size() > 1 && !applyLoadProfile(sampler, reconciler, profiles.front(), loadSampleInterval))
+            {
+                fprintf(stderr, "Settings from before the load couldn't be restored.\n");
+                result = 1;
+            }
+            sampler.stop();
+            printLoadRuns(output, loadSettings, runs);
+            fflush(output);
+            return result;
+        }
+        StreamWriter writer(output, format, sampler.coresTotal(), count);
+        writer.setFinishedCallback([&application]()
+        {
+            QMetaObject::invokeMethod(&application, "quit", Qt::QueuedConnection);
+        });
+        sampler.addSink(&writer);
+        // Snapshot published by the constructor, the thread isn't running yet.
+        const CoreStateStore &initialStore = *sampler.snapshots().acquireLatest();
+        HistoryRecorder recorder;
+        if(parser.isSet(recordOption))
+        {
+            if(!recorder.open(parser.value(recordOption), recordCapacity, initialStore, interval))
+            {
+                fprintf(stderr, "%s\n", recorder.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            sampler.addSink(&recorder);
+        }
+        SharedStatePublisher publisher;
+        if(parser.isSet(sharedMemoryOption))
+        {
+            if(!publisher.open(parser.value(sharedMemoryOption), initialStore))
+            {
+                fprintf(stderr, "%s\n", publisher.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            sampler.addSink(&publisher);
+        }
+        MetricsExporter exporter;
+        if(parser.isSet(metricsSocketOption) || parser.isSet(metricsPortOption))
+        {
+            const bool listening = parser.isSet(metricsSocketOption) ? exporter.listenUnix(parser.value(metricsSocketOption))
+                                                                     : exporter.listenTcp(metricsPort);
+            if(!listening)
+            {
+                fprintf(stderr, "%s\n", exporter.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            // First scrape is answered before the first tick too.
+            exporter.consume(initialStore);
+            sampler.addSink(&exporter);
+            exporter.start();
+        }
+
+        // Checks run on the main thread once per profile interval, against the newest snapshot.
+        BulkApplier bulkApplier;
+        ProfileReconciler reconciler(sampler, bulkApplier);
+        qint64 nextReconcileTimestamp = 0;
+        quint64 printedEntries = 0;
+        if(profile != nullptr)
+        {
+            const int profileInterval = profileFile.getInterval();
+            reconciler.setProfile(*profile, profileInterval);
+            sampler.subscribe(reconciler.cores(), reconciler.attributes(), profileInterval);
+            QObject::connect(&sampler, &CoreSampler::snapshotPublished, &application,
+                             [&sampler, &reconciler, &nextReconcileTimestamp, &printedEntries, profileInterval]()
+            {
+                // Ring is drained on every tick, otherwise it fills up and keeps only old snapshots.
+                const CoreStateStore *current = nullptr;
+                const CoreStateStore *next;
+                while((next = sampler.snapshots().acquireNext()) != nullptr)
+                    current = next;
+                if(current == nullptr || current->timestamp < nextReconcileTimestamp)
+                    return;
+                const qint64 interval = qint64(profileInterval)*1000000;
+                nextReconcileTimestamp = (current->timestamp/interval + 1)*interval;
+                if(reconciler.reconcile(*current) != 0)
+                    printDriftLog(reconciler, printedEntries);
+            });
+        }
+
+        FrequenceController controller(sampler);
+        const CoreStateStore *controlledStore = &initialStore;
+        quint64 printedDecisions = 0;
+        if(parser.isSet(controllerOption))
+        {
+            if(!controller.start(controllerSettings, initialStore))
+            {
+                fprintf(stderr, "%s\n", controller.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+            sampler.subscribe(QVector<int>(), controller.attributes(), controllerSettings.interval);
+            QObject::connect(&sampler, &CoreSampler::snapshotPublished, &application,
+                             [&sampler, &controller, &controlledStore, &printedDecisions]()
+            {
+                // Every step works on the newest snapshot, the ring is drained like for profiles.
+                const CoreStateStore *current = nullptr;
+                const CoreStateStore *next;
+                while((next = sampler.snapshots().acquireNext()) != nullptr)
+                    current = next;
+                if(current == nullptr)
+                    return;
+                controlledStore = current;
+                if(controller.control(*current) == 0 && controller.logTotal() == printedDecisions)
+                    return;
+                quint64 index = qMax(printedDecisions, controller.oldestLogEntry());
+                for(; index < controller.logTotal(); index++)
+                {
+                    const FrequenceController::Decision &decision = controller.logEntry(index);
+                    fprintf(stderr, "control: policy %u load %.1f%% %u -> %u kHz%s%s\n", decision.policyLeader,
+                            double(decision.load), decision.from, decision.to,
+                            decision.error.isEmpty() ? "" : ", not written: ", decision.error.toLocal8Bit().constData());
+                }
+                printedDecisions = index;
+            });
+        }
+
+        QSocketNotifier signalNotifier(signalDescriptor, QSocketNotifier::Read);
+        QObject::connect(&signalNotifier, &QSocketNotifier::activated, &application, &QCoreApplication::quit);
+
+        sampler.start(QThread::HighPriority);
+        result = application.exec();
+        sampler.stop();
+        exporter.stop();
+        if(controller.isActive())
+        {
+            controller.stop(*controlledStore);
+            if(!controller.errorString().isEmpty())
+                fprintf(stderr, "%s\n", controller.errorString().toLocal8Bit().constData());
+            fprintf(stderr, "control: %llu steps, %llu changes, %.1f us per step\n",
+                    (unsigned long long)controller.stepsTotal(), (unsigned long long)controller.changesTotal(),
+                    controller.stepsTotal() > 0 ? double(controller.controlTime())/1000/controller.stepsTotal() : 0.0);
+        }
+    }
+    catch(const std::logic_error &error)
+    {
+        fprintf(stderr, "%s\n", error.what());
+        result = 1;
+    }
+    close(signalDescriptor);
+    fflush(output);
+    if(output != stdout)
+        fclose(output);
+    return result;
+}
@@ -0,0 +1,69 @@
+# Sampling core shared by the GUI and the headless targets, depends on QtCore only.
+
+CONFIG += c++11
+
+# Batched sampling through io_uring needs the uapi header (IORING_OP_READ, Linux 5.6+),
+# without it IoUringSampler always uses the plain LogicCore::update() path.
+exists(/usr/include/linux/io_uring.h): DEFINES += HAVE_IO_URING
+
+# shm_open() of SharedStatePublisher lives in librt before glibc 2.34.
+LIBS += -lrt
+
+SOURCES += \
+    $$PWD/logiccore.cpp \
+    $$PWD/sysfsattribute.cpp \
+    $$PWD/iouringsampler.cpp \
+    $$PWD/coresampler.cpp \
+    $$PWD/samplingplan.cpp \
+    $$PWD/frequenceresidency.cpp \
+    $$PWD/powersensors.cpp \
+    $$PWD/taskscanner.cpp \
+    $$PWD/idlestates.cpp \
+    $$PWD/procstatreader.cpp \
+    $$PWD/corestatestore.cpp \
+    $$PWD/governortable.cpp \
+    $$PWD/historyrecorder.cpp \
+    $$PWD/sharedstatepublisher.cpp \
+    $$PWD/metricsexporter.cpp \
+    $$PWD/historyplayer.cpp \
+    $$PWD/bulkapplier.cpp \
+    $$PWD/profilefile.cpp \
+    $$PWD/profilereconciler.cpp \
+    $$PWD/frequencecontroller.cpp \
+    $$PWD/transitionprofiler.cpp \
+    $$PWD/loadgenerator.cpp \
+    $$PWD/topologycache.cpp \
+    $$PWD/hotplugmonitor.cpp \
+    $$PWD/trace.cpp
+
+HEADERS += \
+    $$PWD/logiccore.h \
+    $$PWD/sysfsattribute.h \
+    $$PWD/iouringsampler.h \
+    $$PWD/coresampler.h \
+    $$PWD/samplingplan.h \
+    $$PWD/frequenceresidency.h \
+    $$PWD/powersensors.h \
+    $$PWD/taskscanner.h \
+    $$PWD/idlestates.h \
+    $$PWD/corestatestore.h \
+    $$PWD/governortable.h \
+    $$PWD/snapshotring.h \
+    $$PWD/snapshotsink.h \
+    $$PWD/procstatreader.h \
+    $$PWD/streamformat.h \
+    $$PWD/historyformat.h \
+    $$PWD/historyrecorder.h \
+    $$PWD/sharedstate.h \
+    $$PWD/sharedstatepublisher.h \
+    $$PWD/metricsexporter.h \
+    $$PWD/historyplayer.h \
+    $$PWD/bulkapplier.h \
+    $$PWD/profilefile.h \
+    $$PWD/profilereconciler.h \
+    $$PWD/frequencecontroller.h \
+    $$PWD/transitionprofiler.h \
+    $$PWD/loadgenerator.h \
+    $$PWD/topologycache.h \
+    $$PWD/hotplugmonitor.h \
+    $$PWD/trace.h
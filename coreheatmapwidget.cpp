@@ -0,0 +1,125 @@
+#include "coreheatmapwidget.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+
+#include "trace.h"
+
+const qint8 CoreHeatmapWidget::unknownValue;
+
+CoreHeatmapWidget::CoreHeatmapWidget(QWidget *parent):
+    QWidget(parent),
+    columns(1)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void CoreHeatmapWidget::setCoresTotal(int coresTotal)
+{
+    this->cellValues.fill(unknownValue, coresTotal);
+    updateColumns();
+    update();
+}
+
+void CoreHeatmapWidget::setValues(const float *values, int count)
+{
+    if(count > this->cellValues.size())
+        count = this->cellValues.size();
+    qint8 *cells = this->cellValues.data();
+    for(int i = 0; i < count; i++)
+    {
+        qint8 value = values[i] < 0 ? unknownValue : qint8(values[i] + 0.5f);
+        if(value == cells[i])
+            continue;
+        cells[i] = value;
+        update(cellRect(i));
+    }
+}
+
+QRect CoreHeatmapWidget::cellRect(int index) const
+{
+    return QRect((index % this->columns)*cellWidth, (index / this->columns)*cellHeight, cellWidth, cellHeight);
+}
+
+int CoreHeatmapWidget::cellAt(const QPoint &position) const
+{
+    int column = position.x()/cellWidth;
+    if(column >= this->columns)
+        return -1;
+    int index = (position.y()/cellHeight)*this->columns + column;
+    return index < this->cellValues.size() ? index : -1;
+}
+
+void CoreHeatmapWidget::updateColumns()
+{
+    int newColumns = width()/cellWidth;
+    if(newColumns < 1)
+        newColumns = 1;
+    this->columns = newColumns;
+    // Height follows the width, so the scroll area knows how much to scroll.
+    int rows = (this->cellValues.size() + this->columns - 1)/this->columns;
+    setMinimumHeight(rows*cellHeight);
+}
+
+void CoreHeatmapWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    updateColumns();
+}
+
+void CoreHeatmapWidget::paintEvent(QPaintEvent *event)
+{
+    TRACE_SCOPE("CoreHeatmapWidget::paintEvent");
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    painter.fillRect(dirty, palette().color(QPalette::Window));
+
+    // Walk only the rows touched by the dirty rectangle.
+    int firstRow = dirty.top()/cellHeight;
+    int lastRow = dirty.bottom()/cellHeight;
+    const qint8 *cells = this->cellValues.constData();
+    for(int row = firstRow; row <= lastRow; row++)
+    {
+        for(int column = 0; column < this->columns; column++)
+        {
+            int index = row*this->columns + column;
+            if(index >= this->cellValues.size())
+                return;
+            QRect cell = cellRect(index);
+            if(!cell.intersects(dirty))
+                continue;
+            QRect inner = cell.adjusted(1, 1, -1, -1);
+            qint8 value = cells[index];
+            if(value == unknownValue)
+                painter.fillRect(inner, QColor(Qt::lightGray));
+            else
+                // Green at idle, red at full load.
+                painter.fillRect(inner, QColor::fromHsv(120 - value*120/100, 170, 230));
+            painter.setPen(QColor(Qt::black));
+            QString text = QString::number(index) + "\n" + (value == unknownValue ? QString("--") : QString::number(value) + "%");
+            painter.drawText(inner, Qt::AlignCenter, text);
+        }
+    }
+}
+
+bool CoreHeatmapWidget::event(QEvent *event)
+{
+    if(event->type() == QEvent::ToolTip)
+    {
+        QHelpEvent *helpEvent = static_cast<QHelpEvent*>(event);
+        int index = cellAt(helpEvent->pos());
+        if(index < 0)
+        {
+            QToolTip::hideText();
+            event->ignore();
+            return true;
+        }
+        qint8 value = this->cellValues[index];
+        QToolTip::showText(helpEvent->globalPos(), "Logic core " + QString::number(index) + ": "
+                           + (value == unknownValue ? QString("unknown load") : QString::number(value) + "% load"), this);
+        return true;
+    }
+    return QWidget::event(event);
+}
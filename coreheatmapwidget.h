@@ -0,0 +1,39 @@
+#ifndef COREHEATMAPWIDGET_H
+#define COREHEATMAPWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+
+// Draws every core as one cell of a grid in a single paintEvent().
+// setValues() repaints only the cells whose shown value changed.
+class CoreHeatmapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit CoreHeatmapWidget(QWidget *parent = nullptr);
+
+    void setCoresTotal(int coresTotal);
+    // Values are percents, negative value means unknown.
+    void setValues(const float *values, int count);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    bool event(QEvent *event) override;
+
+private:
+    static const int cellWidth = 64;
+    static const int cellHeight = 40;
+    static const qint8 unknownValue = -1;
+
+    // Shown value of every cell, rounded to whole percents.
+    QVector<qint8> cellValues;
+    int columns;
+
+    QRect cellRect(int index) const;
+    int cellAt(const QPoint &position) const;
+    void updateColumns();
+};
+
+#endif // COREHEATMAPWIDGET_H
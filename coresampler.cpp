@@ -0,0 +1,433 @@
+#include "coresampler.h"
+
+#include <algorithm>
+#include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <stdexcept>
+#include <QDebug>
+
+#include "trace.h"
+
+namespace
+{
+const qint64 NSEC_PER_MSEC = 1000000;
+const qint64 NSEC_PER_SEC = 1000000000;
+
+timespec toTimespec(qint64 time)
+{
+    timespec result;
+    result.tv_sec = time_t(time/NSEC_PER_SEC);
+    result.tv_nsec = long(time%NSEC_PER_SEC);
+    return result;
+}
+}
+
+CoreSampler::CoreSampler(uint coresTotal, int interval, QObject *parent):
+    QThread(parent),
+    topologyCache(int(coresTotal)),
+    logicCores(createLogicCores(coresTotal, topologyCache)),
+    batchSampler(logicCores),
+    procStat(logicCores.size()),
+    residency(logicCores, monotonicTime()),
+    tasks(logicCores.size()),
+    idle(logicCores, monotonicTime()),
+    nextSubscription(0),
+    planChanged(false),
+    timerDescriptor(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)),
+    wakeDescriptor(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    sequence(0)
+{
+    for(size_t i = 0; i < Ring::capacity(); i++)
+    {
+        this->ring.slotAt(i).resize(this->logicCores.size());
+        this->ring.slotAt(i).resizeSensors(this->sensors.zonesTotal(), this->sensors.domainsTotal());
+        this->ring.slotAt(i).resizeIdleStates(this->idle.statesTotal());
+    }
+    this->overflowStore.resize(this->logicCores.size());
+    this->overflowStore.resizeSensors(this->sensors.zonesTotal(), this->sensors.domainsTotal());
+    this->overflowStore.resizeIdleStates(this->idle.statesTotal());
+    // Cores were already read by their constructors,
+    //so the first snapshot is available before the thread starts.
+    this->procStat.update();
+    // Powers need two readings, the first snapshot has temperatures only.
+    this->sensors.update(monotonicTime());
+    publish(monotonicTime(), 0, 0, 0);
+    if(interval > 0)
+        subscribe(QVector<int>(), SamplingPlan::allAttributes, interval);
+}
+
+CoreSampler::~CoreSampler()
+{
+    stop();
+    for(auto *logicCore: this->logicCores)
+        delete logicCore;
+    if(this->timerDescriptor >= 0)
+        close(this->timerDescriptor);
+    if(this->wakeDescriptor >= 0)
+        close(this->wakeDescriptor);
+}
+
+QVector<LogicCore*> CoreSampler::createLogicCores(uint coresTotal, TopologyCache &topologyCache)
+{
+    // Warm start takes static attributes from the cache and reads no static files at all.
+    topologyCache.load();
+    QVector<LogicCore*> logicCores;
+    for(uint i = 0; i < coresTotal; i++)
+    {
+        LogicCore *logicCore = new LogicCore(i, topologyCache.find(int(i)));
+        topologyCache.store(int(i), logicCore->topology());
+        logicCores.push_back(logicCore);
+    }
+    if(topologyCache.isModified())
+        topologyCache.save();
+    linkPolicies(logicCores);
+    return logicCores;
+}
+
+void CoreSampler::linkPolicies(const QVector<LogicCore*> &logicCores)
+{
+    // Scaling limits and governor are read once per cpufreq policy and fanned out to its cores.
+    //The lowest online core of the policy reads them, the lowest core when the whole policy is offline.
+    QVector<int> leaders(logicCores.size(), -1);
+    for(auto *logicCore: logicCores)
+    {
+        const uint policy = logicCore->getPolicyLeaderNumber();
+        if(policy >= uint(logicCores.size()))
+            continue;
+        int &leader = leaders[int(policy)];
+        if(leader < 0 || (!logicCores[leader]->getOnline() && logicCore->getOnline()))
+            leader = int(logicCore->getNumber());
+    }
+    for(auto *logicCore: logicCores)
+    {
+        const uint policy = logicCore->getPolicyLeaderNumber();
+        logicCore->setPolicyLeader(policy < uint(logicCores.size()) ? logicCores[leaders[int(policy)]] : nullptr);
+    }
+}
+
+void CoreSampler::handleHotplug()
+{
+    TRACE_SCOPE("CoreSampler::handleHotplug");
+    int coreNumber;
+    bool changed = false;
+    while(this->hotplugMonitor.next(coreNumber))
+    {
+        if(coreNumber >= this->logicCores.size())
+            continue;
+        // Negative number means events were lost, refresh every core.
+        const int first = coreNumber < 0 ? 0 : coreNumber;
+        const int last = coreNumber < 0 ? this->logicCores.size() : coreNumber + 1;
+        for(int i = first; i < last; i++)
+        {
+            this->logicCores[i]->refresh();
+            this->topologyCache.store(i, this->logicCores[i]->topology());
+            this->idle.refresh(i);
+        }
+        changed = true;
+    }
+    if(!changed)
+        return;
+    // Policy of a core seen for the first time is known only now,
+    //a policy whose leader went offline is read through its next online core.
+    linkPolicies(this->logicCores);
+    // Residency of a new leader is initialized from its own stats files.
+    const qint64 now = monotonicTime();
+    for(int i = 0; i < this->logicCores.size(); i++)
+        this->residency.refresh(i, now);
+    this->batchSampler.rebuild();
+    // Policy attributes of followers are planned through their leaders.
+    this->planChanged = true;
+    if(this->topologyCache.isModified())
+        this->topologyCache.save();
+}
+
+void CoreSampler::addSink(SnapshotSink *sink)
+{
+    QMutexLocker locker(&this->sinksMutex);
+    this->sinks.push_back(sink);
+}
+
+void CoreSampler::removeSink(SnapshotSink *sink)
+{
+    QMutexLocker locker(&this->sinksMutex);
+    this->sinks.removeAll(sink);
+}
+
+int CoreSampler::subscribe(const QVector<int> &cores, quint32 attributes, int interval)
+{
+    SamplingPlan::Subscription subscription;
+    subscription.cores = cores;
+    subscription.attributes = attributes;
+    subscription.interval = qint64(interval)*NSEC_PER_MSEC;
+    {
+        QMutexLocker locker(&this->subscriptionsMutex);
+        subscription.id = this->nextSubscription++;
+        this->subscriptions.push_back(subscription);
+    }
+    this->planChanged = true;
+    wake();
+    return subscription.id;
+}
+
+void CoreSampler::unsubscribe(int subscription)
+{
+    {
+        QMutexLocker locker(&this->subscriptionsMutex);
+        for(int i = 0; i < this->subscriptions.size(); i++)
+        {
+            if(this->subscriptions[i].id == subscription)
+            {
+                this->subscriptions.remove(i);
+                break;
+            }
+        }
+    }
+    this->planChanged = true;
+    wake();
+}
+
+void CoreSampler::wake()
+{
+    if(this->wakeDescriptor < 0)
+        return;
+    const quint64 value = 1;
+    ssize_t written = write(this->wakeDescriptor, &value, sizeof(value));
+    // Counter is only full when the sampler hasn't drained it, it's awake anyway.
+    (void)written;
+}
+
+LogicCore &CoreSampler::logicCore(int coreNumber)
+{
+    return *this->logicCores[coreNumber];
+}
+
+int CoreSampler::coresTotal() const
+{
+    return this->logicCores.size();
+}
+
+bool CoreSampler::isBatched() const
+{
+    return this->batchSampler.isAvailable();
+}
+
+const FrequenceResidency &CoreSampler::frequenceResidency() const
+{
+    return this->residency;
+}
+
+const PowerSensors &CoreSampler::powerSensors() const
+{
+    return this->sensors;
+}
+
+const TaskScanner &CoreSampler::taskScanner() const
+{
+    return this->tasks;
+}
+
+const IdleStates &CoreSampler::idleStates() const
+{
+    return this->idle;
+}
+
+CoreSampler::Ring &CoreSampler::snapshots()
+{
+    return this->ring;
+}
+
+void CoreSampler::stop()
+{
+    requestInterruption();
+    wake();
+    wait();
+}
+
+qint64 CoreSampler::monotonicTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec)*NSEC_PER_SEC + now.tv_nsec;
+}
+
+qint64 CoreSampler::threadCpuTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return qint64(now.tv_sec)*NSEC_PER_SEC + now.tv_nsec;
+}
+
+void CoreSampler::publish(qint64 timestamp, qint64 samplingDuration, qint64 samplingCpuTime, qint64 jitter)
+{
+    TRACE_SCOPE("CoreSampler::publish");
+    CoreStateStore *store = this->ring.beginWrite();
+    const bool toRing = store != nullptr;
+    if(!toRing)
+        store = &this->overflowStore;
+    store->sequence = this->sequence++;
+    store->timestamp = timestamp;
+    store->samplingDuration = samplingDuration;
+    store->samplingCpuTime = samplingCpuTime;
+    store->jitter = jitter;
+    uint *currentFrequences = store->currentFrequences.data();
+    uint *minScalingFrequences = store->minScalingFrequences.data();
+    uint *maxScalingFrequences = store->maxScalingFrequences.data();
+    quint8 *online = store->online.data();
+    quint8 *governors = store->governors.data();
+    uint *minCoreFrequences = store->minCoreFrequences.data();
+    uint *maxCoreFrequences = store->maxCoreFrequences.data();
+    quint32 *availableGovernors = store->availableGovernors.data();
+    float *loads = store->loads.data();
+    const float *procStatLoads = this->procStat.loadData();
+    for(int i = 0; i < this->logicCores.size(); i++)
+    {
+        const LogicCore *logicCore = this->logicCores[i];
+        online[i] = logicCore->getOnline();
+        currentFrequences[i] = logicCore->getCurrentCoreFrequence();
+        maxScalingFrequences[i] = logicCore->getScalingMaxFrequence();
+        minScalingFrequences[i] = logicCore->getScalingMinFrequence();
+        governors[i] = logicCore->getGovernorId();
+        // Static attributes are cached, but a hotplugged core may learn them later.
+        minCoreFrequences[i] = logicCore->getMinCoreFrequence();
+        maxCoreFrequences[i] = logicCore->getMaxCoreFrequence();
+        availableGovernors[i] = logicCore->getAvailableGovernorMask();
+        loads[i] = procStatLoads[i];
+    }
+    // Sensors keep their last values between power ticks like cores do.
+    std::copy(this->sensors.temperatureData(), this->sensors.temperatureData() + this->sensors.zonesTotal(),
+              store->temperatures.data());
+    std::copy(this->sensors.powerData(), this->sensors.powerData() + this->sensors.domainsTotal(), store->powers.data());
+    std::copy(this->idle.residencyData(), this->idle.residencyData() + store->idleResidencies.size(), store->idleResidencies.data());
+    std::copy(this->idle.wakeupData(), this->idle.wakeupData() + store->idleWakeups.size(), store->idleWakeups.data());
+    std::copy(this->idle.disabledData(), this->idle.disabledData() + store->disabledIdleStates.size(),
+              store->disabledIdleStates.data());
+    std::copy(this->idle.unknownData(), this->idle.unknownData() + store->unknownIdleStates.size(),
+              store->unknownIdleStates.data());
+    {
+        QMutexLocker locker(&this->sinksMutex);
+        for(auto *sink: this->sinks)
+            sink->consume(*store);
+    }
+    if(toRing)
+        this->ring.publish();
+}
+
+bool CoreSampler::waitUntil(qint64 deadline)
+{
+    pollfd descriptors[3];
+    nfds_t descriptorsTotal = 0;
+    int timerIndex = -1, wakeIndex = -1, hotplugIndex = -1;
+    timespec timeout;
+    timespec *timeoutPointer = nullptr;
+    if(this->timerDescriptor >= 0)
+    {
+        itimerspec timer;
+        memset(&timer, 0, sizeof(timer));
+        // Zero value disarms the timer, sampler then sleeps until subscribe() wakes it.
+        if(deadline >= 0)
+            timer.it_value = toTimespec(deadline);
+        timerfd_settime(this->timerDescriptor, TFD_TIMER_ABSTIME, &timer, nullptr);
+        timerIndex = int(descriptorsTotal++);
+        descriptors[timerIndex].fd = this->timerDescriptor;
+    }
+    else if(deadline >= 0)
+    {
+        const qint64 now = monotonicTime();
+        if(now >= deadline)
+            return true;
+        timeout = toTimespec(deadline - now);
+        timeoutPointer = &timeout;
+    }
+    if(this->wakeDescriptor >= 0)
+    {
+        wakeIndex = int(descriptorsTotal++);
+        descriptors[wakeIndex].fd = this->wakeDescriptor;
+    }
+    else if(timeoutPointer == nullptr || timeout.tv_sec > 0)
+    {
+        // Without eventfd subscription changes and stop() are noticed within a second.
+        timeout = toTimespec(NSEC_PER_SEC);
+        timeoutPointer = &timeout;
+    }
+    if(this->hotplugMonitor.isOpen())
+    {
+        // Hotplug uevents are handled as soon as they arrive, between ticks.
+        hotplugIndex = int(descriptorsTotal++);
+        descriptors[hotplugIndex].fd = this->hotplugMonitor.descriptor();
+    }
+    for(nfds_t i = 0; i < descriptorsTotal; i++)
+    {
+        descriptors[i].events = POLLIN;
+        descriptors[i].revents = 0;
+    }
+
+    int ready = ppoll(descriptors, descriptorsTotal, timeoutPointer, nullptr);
+    if(ready < 0)
+        return false;
+    if(ready == 0)
+        return this->timerDescriptor < 0 && deadline >= 0 && monotonicTime() >= deadline;
+    quint64 counter;
+    if(wakeIndex >= 0 && descriptors[wakeIndex].revents)
+    {
+        ssize_t length = read(this->wakeDescriptor, &counter, sizeof(counter));
+        (void)length;
+    }
+    if(hotplugIndex >= 0 && descriptors[hotplugIndex].revents)
+        handleHotplug();
+    if(timerIndex >= 0 && descriptors[timerIndex].revents)
+        return read(this->timerDescriptor, &counter, sizeof(counter)) == sizeof(counter);
+    return false;
+}
+
+void CoreSampler::run()
+{
+    bool dueLoad, duePower, dueTasks;
+    this->planChanged = true;
+    while(!isInterruptionRequested())
+    {
+        if(this->planChanged.exchange(false))
+        {
+            QVector<SamplingPlan::Subscription> current;
+            {
+                QMutexLocker locker(&this->subscriptionsMutex);
+                current = this->subscriptions;
+            }
+            this->plan.build(current, this->logicCores, monotonicTime());
+        }
+        const qint64 deadline = this->plan.isEmpty() ? -1 : this->plan.nextDeadline();
+        if(!waitUntil(deadline) || this->planChanged)
+            continue;
+        const qint64 tickStart = monotonicTime();
+        const qint64 tickCpuStart = threadCpuTime();
+        // Don't try to catch up after a long stall, missed ticks are skipped by the plan.
+        this->plan.collectDue(tickStart, this->dueSlots, this->dueCores, dueLoad, this->dueResidencyCores, duePower,
+                              dueTasks, this->dueIdleCores);
+        try
+        {
+            TRACE_SCOPE("CoreSampler::tick");
+            this->batchSampler.update(this->dueSlots, this->dueCores);
+            this->residency.sample(this->dueCores, tickStart);
+            if(!this->dueResidencyCores.empty())
+                this->residency.update(this->dueResidencyCores, tickStart);
+            if(dueLoad)
+                this->procStat.update();
+            if(duePower)
+                this->sensors.update(tickStart);
+            if(dueTasks)
+                this->tasks.update(tickStart);
+            if(!this->dueIdleCores.empty())
+                this->idle.update(this->dueIdleCores, tickStart);
+            publish(tickStart, monotonicTime() - tickStart, threadCpuTime() - tickCpuStart, tickStart - deadline);
+            emit snapshotPublished();
+        }
+        catch(const std::logic_error &error)
+        {
+            qWarning() << "Sampling failed:" << error.what();
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef CORESAMPLER_H
+#define CORESAMPLER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+
+#include "logiccore.h"
+#include "iouringsampler.h"
+#include "procstatreader.h"
+#include "corestatestore.h"
+#include "snapshotring.h"
+#include "snapshotsink.h"
+#include "topologycache.h"
+#include "hotplugmonitor.h"
+#include "samplingplan.h"
+#include "frequenceresidency.h"
+#include "powersensors.h"
+#include "taskscanner.h"
+#include "idlestates.h"
+
+// Owns logic cores, samples them on its own thread and publishes one CoreStateStore per tick.
+// GUI thread only reads published stores, it never touches sysfs for sampling.
+// Only subscribed attributes are read, each at the shortest interval asked for it,
+//a tick happens whenever some group of the sampling plan is due.
+class CoreSampler : public QThread
+{
+    Q_OBJECT
+
+public:
+    typedef SnapshotRing<CoreStateStore, 8> Ring;
+
+    // Interval is in milliseconds, every attribute of every core is subscribed at it.
+    //With 0 nothing is sampled until views subscribe.
+    CoreSampler(uint coresTotal, int interval, QObject *parent = nullptr);
+    ~CoreSampler();
+
+    Ring &snapshots();
+    // Cores for the apply path. apply() and setScalingSpeed() validate against static attributes and open
+    //their own files, static getters are safe from any thread even while hotplug fills them in.
+    //Sampled getters and policy links belong to the sampler thread, other threads read published stores.
+    LogicCore &logicCore(int coreNumber);
+    int coresTotal() const;
+    // True when ticks are read with io_uring batches.
+    bool isBatched() const;
+    // Updated for cores subscribed with SamplingPlan::residencyAttribute, query from any thread.
+    const FrequenceResidency &frequenceResidency() const;
+    // Names of the temperatures and powers in published stores.
+    const PowerSensors &powerSensors() const;
+    // Scanned while someone subscribes SamplingPlan::taskAttribute, query from any thread.
+    const TaskScanner &taskScanner() const;
+    // Names and latencies of the idle states in published stores.
+    const IdleStates &idleStates() const;
+    // Sinks see every tick, even when the ring is full. They are called on the sampler thread,
+    //adding and removing is allowed while it runs; removeSink() returns after the last call.
+    void addSink(SnapshotSink *sink);
+    void removeSink(SnapshotSink *sink);
+    // Attributes are SamplingPlan bits, empty `cores` means all of them, interval is in milliseconds.
+    //Returns an id for unsubscribe(). Safe to call from any thread, the plan is rebuilt before the next tick.
+    int subscribe(const QVector<int> &cores, quint32 attributes, int interval);
+    void unsubscribe(int subscription);
+    void stop();
+
+    // Current time of CLOCK_MONOTONIC in nanoseconds.
+    static qint64 monotonicTime();
+    // CPU time of the calling thread in nanoseconds.
+    static qint64 threadCpuTime();
+
+signals:
+    // Emitted from the sampler thread after each published snapshot.
+    void snapshotPublished();
+
+protected:
+    void run() override;
+
+private:
+    // Loaded before the cores are created, saved when hotplug brings new static attributes.
+    TopologyCache topologyCache;
+    QVector<LogicCore*> logicCores;
+    IoUringSampler batchSampler;
+    ProcStatReader procStat;
+    FrequenceResidency residency;
+    PowerSensors sensors;
+    TaskScanner tasks;
+    IdleStates idle;
+    Ring ring;
+    // Filled instead of a ring slot when the consumer is behind, so sinks never miss a tick.
+    CoreStateStore overflowStore;
+    QVector<SnapshotSink*> sinks;
+    QMutex sinksMutex;
+    // Wakes the sampler between ticks when a core goes online or offline.
+    HotplugMonitor hotplugMonitor;
+    QVector<SamplingPlan::Subscription> subscriptions;
+    QMutex subscriptionsMutex;
+    int nextSubscription;
+    std::atomic<bool> planChanged;
+    // Used only by the sampler thread.
+    SamplingPlan plan;
+    std::vector<uint> dueSlots;
+    std::vector<int> dueCores;
+    std::vector<int> dueResidencyCores;
+    std::vector<int> dueIdleCores;
+    // Armed to the next deadline of the plan.
+    int timerDescriptor;
+    // Written by subscribe(), unsubscribe() and stop() to wake the sampler.
+    int wakeDescriptor;
+    quint64 sequence;
+
+    static QVector<LogicCore*> createLogicCores(uint coresTotal, TopologyCache &topologyCache);
+    static void linkPolicies(const QVector<LogicCore*> &logicCores);
+    void handleHotplug();
+    void publish(qint64 timestamp, qint64 samplingDuration, qint64 samplingCpuTime, qint64 jitter);
+    void wake();
+    // Returns true when `deadline` was reached, false when woken early. Negative deadline waits for a wake up.
+    bool waitUntil(qint64 deadline);
+};
+
+#endif // CORESAMPLER_H
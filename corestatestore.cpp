@@ -0,0 +1,44 @@
+#include "corestatestore.h"
+
+void CoreStateStore::resize(int coresTotal)
+{
+    this->sequence = 0;
+    this->timestamp = 0;
+    this->samplingDuration = 0;
+    this->samplingCpuTime = 0;
+    this->jitter = 0;
+    this->currentFrequences.resize(coresTotal);
+    this->minScalingFrequences.resize(coresTotal);
+    this->maxScalingFrequences.resize(coresTotal);
+    this->minCoreFrequences.resize(coresTotal);
+    this->maxCoreFrequences.resize(coresTotal);
+    this->online.resize(coresTotal);
+    this->governors.resize(coresTotal);
+    this->availableGovernors.resize(coresTotal);
+    this->loads.resize(coresTotal);
+    this->idleStatesTotal = 0;
+    this->idleResidencies.clear();
+    this->idleWakeups.clear();
+    this->disabledIdleStates.clear();
+    this->unknownIdleStates.clear();
+}
+
+void CoreStateStore::resizeSensors(int zonesTotal, int domainsTotal)
+{
+    this->temperatures.resize(zonesTotal);
+    this->powers.resize(domainsTotal);
+}
+
+void CoreStateStore::resizeIdleStates(int statesTotal)
+{
+    this->idleStatesTotal = statesTotal;
+    this->idleResidencies.resize(size()*statesTotal);
+    this->idleWakeups.resize(size());
+    this->disabledIdleStates.resize(size());
+    this->unknownIdleStates.resize(size());
+}
+
+int CoreStateStore::size() const
+{
+    return this->currentFrequences.size();
+}
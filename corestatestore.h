@@ -0,0 +1,55 @@
+#ifndef CORESTATESTORE_H
+#define CORESTATESTORE_H
+
+#include <QVector>
+
+// State of all cores from one sampling tick as parallel arrays indexed by core number,
+//so a full refresh walks a few dense arrays. Immutable once published by CoreSampler.
+struct CoreStateStore
+{
+    quint64 sequence;
+    // CLOCK_MONOTONIC time of the tick start, nanoseconds.
+    qint64 timestamp;
+    // Time spent reading and parsing sysfs, nanoseconds.
+    qint64 samplingDuration;
+    // CPU time of the sampler thread spent on the same work, nanoseconds.
+    qint64 samplingCpuTime;
+    // How late the sampler woke up relative to its schedule, nanoseconds.
+    qint64 jitter;
+
+    QVector<uint> currentFrequences;
+    QVector<uint> minScalingFrequences;
+    QVector<uint> maxScalingFrequences;
+    // Hardware limits, never change after start.
+    QVector<uint> minCoreFrequences;
+    QVector<uint> maxCoreFrequences;
+    QVector<quint8> online;
+    // GovernorTable ids.
+    QVector<quint8> governors;
+    // Bit N is set when GovernorTable id N is available on the core.
+    QVector<quint32> availableGovernors;
+    // Busy time since the previous tick in percents, negative when unknown.
+    QVector<float> loads;
+    // Thermal zones and RAPL domains in PowerSensors order, empty in stores that don't carry them.
+    //Degrees Celsius, NaN when unknown.
+    QVector<float> temperatures;
+    // Watts, negative when unknown.
+    QVector<float> powers;
+    // cpuidle states, empty in stores that don't carry them. idleStatesTotal values per core,
+    //percents of the core's last idle update interval, negative when unknown.
+    int idleStatesTotal;
+    QVector<float> idleResidencies;
+    // Entries into any idle state in the same interval.
+    QVector<quint32> idleWakeups;
+    // Bit N is set when idle stateN is disabled.
+    QVector<quint32> disabledIdleStates;
+    // Bit N is set when stateN's disable was never read, its bit in disabledIdleStates means nothing.
+    QVector<quint32> unknownIdleStates;
+
+    void resize(int coresTotal);
+    void resizeSensors(int zonesTotal, int domainsTotal);
+    void resizeIdleStates(int statesTotal);
+    int size() const;
+};
+
+#endif // CORESTATESTORE_H
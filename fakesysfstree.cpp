@@ -0,0 +1,93 @@
+#include "fakesysfstree.h"
+
+#include <cstdlib>
+#include <QDir>
+#include <QFile>
+
+const uint FakeSysfsTree::maxFrequence;
+const uint FakeSysfsTree::minFrequence;
+
+FakeSysfsTree::FakeSysfsTree(int coresTotal, int policySize):
+    cores(coresTotal)
+{
+    QByteArray pattern = (QDir::tempPath() + "/LinuxCpuInstruments-XXXXXX").toLocal8Bit();
+    if(mkdtemp(pattern.data()) == nullptr)
+        return;
+    this->root = QString::fromLocal8Bit(pattern.constData());
+    if(!create(policySize < 1 ? 1 : policySize))
+    {
+        QDir(this->root).removeRecursively();
+        this->root.clear();
+    }
+}
+
+FakeSysfsTree::~FakeSysfsTree()
+{
+    if(!this->root.isEmpty())
+        QDir(this->root).removeRecursively();
+}
+
+QString FakeSysfsTree::rootPath() const
+{
+    return this->root;
+}
+
+int FakeSysfsTree::coresTotal() const
+{
+    return this->cores;
+}
+
+bool FakeSysfsTree::writeFile(const QString &path, const QString &content) const
+{
+    QFile file(this->root + path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(content.toLatin1()) == content.size();
+}
+
+bool FakeSysfsTree::create(int policySize)
+{
+    QString stat = "cpu  0 0 0 0 0 0 0 0 0 0\n";
+    for(int core = 0; core < this->cores; core++)
+    {
+        const QString corePath = "/sys/devices/system/cpu/cpu" + QString::number(core);
+        if(!QDir().mkpath(this->root + corePath + "/cpufreq") || !QDir().mkpath(this->root + corePath + "/topology"))
+            return false;
+        const int policyLeader = core/policySize*policySize;
+        QString relatedCores;
+        for(int related = policyLeader; related < policyLeader + policySize && related < this->cores; related++)
+            relatedCores += QString::number(related) + " ";
+        const int physicalCore = core/2;
+        const QString siblings = core/2*2 + 1 < this->cores
+                ? QString::number(core/2*2) + "-" + QString::number(core/2*2 + 1) : QString::number(core);
+        // Core 0 can't be hotplugged and has no online file.
+        if(core != 0 && !writeFile(corePath + "/online", "1\n"))
+            return false;
+        if(!writeFile(corePath + "/cpufreq/cpuinfo_max_freq", QString::number(maxFrequence) + "\n")
+                || !writeFile(corePath + "/cpufreq/cpuinfo_min_freq", QString::number(minFrequence) + "\n")
+                || !writeFile(corePath + "/cpufreq/scaling_max_freq", QString::number(maxFrequence) + "\n")
+                || !writeFile(corePath + "/cpufreq/scaling_min_freq", QString::number(minFrequence) + "\n")
+                || !writeFile(corePath + "/cpufreq/scaling_cur_freq", QString::number(2000000 + core*1000) + "\n")
+                || !writeFile(corePath + "/cpufreq/scaling_governor", "powersave\n")
+                || !writeFile(corePath + "/cpufreq/scaling_available_governors", "performance powersave\n")
+                || !writeFile(corePath + "/cpufreq/related_cpus", relatedCores.trimmed() + "\n")
+                || !writeFile(corePath + "/topology/physical_package_id", "0\n")
+                || !writeFile(corePath + "/topology/core_id", QString::number(physicalCore) + "\n")
+                || !writeFile(corePath + "/topology/thread_siblings_list", siblings + "\n"))
+            return false;
+        stat += "cpu" + QString::number(core) + " 1000 0 500 8000 10 0 5 0 0 0\n";
+    }
+    stat += "intr 0\nctxt 0\nbtime 0\nprocesses 1\nprocs_running 1\nprocs_blocked 0\n";
+    // One package thermal zone and RAPL package with a dram subdomain, like a single socket machine.
+    const QString zonePath = "/sys/class/thermal/thermal_zone0";
+    const QString packagePath = "/sys/class/powercap/intel-rapl:0";
+    const QString dramPath = "/sys/class/powercap/intel-rapl:0:0";
+    if(!QDir().mkpath(this->root + zonePath) || !QDir().mkpath(this->root + packagePath) || !QDir().mkpath(this->root + dramPath)
+            || !writeFile(zonePath + "/type", "x86_pkg_temp\n") || !writeFile(zonePath + "/temp", "45000\n")
+            || !writeFile(packagePath + "/name", "package-0\n") || !writeFile(packagePath + "/energy_uj", "1000000\n")
+            || !writeFile(packagePath + "/max_energy_range_uj", "262143328850\n")
+            || !writeFile(dramPath + "/name", "dram\n") || !writeFile(dramPath + "/energy_uj", "500000\n")
+            || !writeFile(dramPath + "/max_energy_range_uj", "65712999613\n"))
+        return false;
+    return QDir().mkpath(this->root + "/proc") && writeFile("/proc/stat", stat);
+}
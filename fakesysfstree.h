@@ -0,0 +1,32 @@
+#ifndef FAKESYSFSTREE_H
+#define FAKESYSFSTREE_H
+
+#include <QString>
+
+// cpufreq, topology and /proc/stat files of a made-up machine in a temporary directory,
+//for SysfsAttribute::setRootPath(). Files are plain files, so writes don't truncate them
+//and nothing changes between reads, only the cost of the calls is realistic.
+class FakeSysfsTree
+{
+public:
+    // Cores of one cpufreq policy are consecutive, two hardware threads per physical core.
+    FakeSysfsTree(int coresTotal, int policySize);
+    ~FakeSysfsTree();
+    FakeSysfsTree(const FakeSysfsTree &) = delete;
+    FakeSysfsTree &operator=(const FakeSysfsTree &) = delete;
+
+    // Empty when the tree could not be created.
+    QString rootPath() const;
+    int coresTotal() const;
+    static const uint maxFrequence = 3600000;
+    static const uint minFrequence = 800000;
+
+private:
+    QString root;
+    const int cores;
+
+    bool create(int policySize);
+    bool writeFile(const QString &path, const QString &content) const;
+};
+
+#endif // FAKESYSFSTREE_H
@@ -0,0 +1,369 @@
+#include "frequencecontroller.h"
+
+#include <stdexcept>
+
+#include "governortable.h"
+#include "samplingplan.h"
+#include "trace.h"
+
+const int FrequenceController::decisionLogCapacity;
+
+namespace
+{
+const qint64 NSEC_PER_MSEC = 1000000;
+const qint64 NSEC_PER_SEC = 1000000000;
+
+// Policy files of an offline core can't be written, the policy is written through its first online core.
+int onlineCore(const QVector<int> &cores, const CoreStateStore &current)
+{
+    for(int core: cores)
+    {
+        if(core == 0 || current.online[core])
+            return core;
+    }
+    return -1;
+}
+}
+
+FrequenceController::Settings FrequenceController::defaultSettings()
+{
+    Settings settings;
+    settings.mode = LimitMode;
+    settings.interval = 100;
+    settings.upLoad = 70;
+    settings.downLoad = 30;
+    settings.rampUp = 2000000;
+    settings.rampDown = 500000;
+    settings.upLatency = 300;
+    settings.downDelay = 1000;
+    return settings;
+}
+
+FrequenceController::FrequenceController(CoreSampler &coreSampler):
+    coreSampler(coreSampler),
+    current(defaultSettings()),
+    active(false),
+    steps(0),
+    changes(0),
+    cpuTime(0),
+    log(decisionLogCapacity),
+    logged(0)
+{
+}
+
+bool FrequenceController::start(const Settings &settings, const CoreStateStore &current)
+{
+    if(settings.interval < 1 || settings.downLoad < 0 || settings.upLoad > 100 || settings.downLoad >= settings.upLoad)
+    {
+        this->error = "Controller needs a positive interval and 0 <= down load < up load <= 100.";
+        return false;
+    }
+    if((settings.rampUp == 0 && settings.upLatency <= 0) || settings.rampDown == 0)
+    {
+        this->error = "Controller ramp rates must be positive.";
+        return false;
+    }
+    const quint8 userspace = GovernorTable::instance().find("userspace");
+    this->current = settings;
+    this->policies.clear();
+    this->written = current;
+    const int coresTotal = qMin(this->coreSampler.coresTotal(), current.size());
+    for(int i = 0; i < coresTotal; i++)
+    {
+        const LogicCore &logicCore = this->coreSampler.logicCore(i);
+        const int leader = int(logicCore.getPolicyLeaderNumber());
+        if(leader != i)
+        {
+            // Leaders are the lowest cores of their policies, so theirs is already there.
+            for(Policy &policy: this->policies)
+            {
+                if(int(policy.leader) == leader)
+                    policy.cores.push_back(i);
+            }
+            continue;
+        }
+        // Offline since start, nothing is known about its frequences.
+        if(logicCore.getMaxCoreFrequence() <= logicCore.getMinCoreFrequence())
+            continue;
+        Policy policy;
+        policy.leader = uint(i);
+        policy.cores.push_back(i);
+        policy.minFrequence = logicCore.getMinCoreFrequence();
+        policy.maxFrequence = logicCore.getMaxCoreFrequence();
+        policy.frequence = settings.mode == LimitMode ? current.maxScalingFrequences[i] : current.currentFrequences[i];
+        policy.frequence = qBound(policy.minFrequence, policy.frequence, policy.maxFrequence);
+        policy.lowSince = 0;
+        policy.lastTimestamp = 0;
+        policy.originalMaxScaling = current.maxScalingFrequences[i];
+        policy.originalGovernor = current.governors[i];
+        if(settings.mode == SetspeedMode && (userspace == GovernorTable::unknownGovernor
+                                             || !(logicCore.getAvailableGovernorMask() & (quint32(1) << userspace))))
+        {
+            this->error = "Governor userspace is not available on core " + QString::number(i) + ".";
+            this->policies.clear();
+            return false;
+        }
+        this->policies.push_back(policy);
+    }
+    if(settings.mode == SetspeedMode)
+    {
+        for(const Policy &policy: this->policies)
+        {
+            const int leader = int(policy.leader);
+            const int core = onlineCore(policy.cores, current);
+            try
+            {
+                if(core >= 0)
+                {
+                    LogicCore::ApplySettings applySettings;
+                    applySettings.online = true;
+                    applySettings.minScalingFrequence = current.minScalingFrequences[core];
+                    applySettings.maxScalingFrequence = current.maxScalingFrequences[core];
+                    applySettings.governor = userspace;
+                    applySettings.idleStatesMask = 0;
+                    this->coreSampler.logicCore(core).apply(applySettings, current);
+                }
+                this->written.governors[leader] = userspace;
+            }
+            catch(const std::logic_error &error)
+            {
+                // Policies switched so far go back to their governors.
+                this->active = true;
+                stop(current);
+                this->error = QString("Cannot switch to governor userspace: ") + error.what();
+                return false;
+            }
+        }
+    }
+    this->error.clear();
+    this->active = true;
+    return true;
+}
+
+void FrequenceController::stop(const CoreStateStore &current)
+{
+    if(!this->active)
+        return;
+    QString failure;
+    for(const Policy &policy: this->policies)
+    {
+        const int leader = int(policy.leader);
+        const int core = onlineCore(policy.cores, current);
+        if(core < 0)
+            continue;
+        syncWritten(policy, core, current);
+        LogicCore::ApplySettings settings;
+        settings.online = current.online[core] != 0;
+        settings.minScalingFrequence = current.minScalingFrequences[core];
+        settings.maxScalingFrequence = this->current.mode == LimitMode ? policy.originalMaxScaling
+                                                                       : this->written.maxScalingFrequences[leader];
+        settings.governor = this->current.mode == SetspeedMode ? policy.originalGovernor : GovernorTable::unknownGovernor;
+        settings.idleStatesMask = 0;
+        try
+        {
+            this->coreSampler.logicCore(core).apply(settings, this->written);
+        }
+        catch(const std::logic_error &error)
+        {
+            failure = error.what();
+        }
+    }
+    this->policies.clear();
+    this->active = false;
+    if(!failure.isEmpty())
+        this->error = "Cannot restore scaling state: " + failure;
+}
+
+bool FrequenceController::isActive() const
+{
+    return this->active;
+}
+
+const FrequenceController::Settings &FrequenceController::settings() const
+{
+    return this->current;
+}
+
+QString FrequenceController::errorString() const
+{
+    return this->error;
+}
+
+quint32 FrequenceController::attributes() const
+{
+    // Scaling min bounds the ceiling of LimitMode.
+    return SamplingPlan::loadAttribute | SamplingPlan::attribute(LogicCore::OnlineAttribute)
+            | SamplingPlan::attribute(LogicCore::ScalingMinAttribute);
+}
+
+void FrequenceController::syncWritten(const Policy &policy, int core, const CoreStateStore &current)
+{
+    // apply() compares against the writing core, it takes the policy state the controller left
+    //and the online state the snapshot shows, so it never brings a core up or down.
+    const int leader = int(policy.leader);
+    this->written.online[core] = current.online[core];
+    this->written.minScalingFrequences[core] = this->written.minScalingFrequences[leader];
+    this->written.maxScalingFrequences[core] = this->written.maxScalingFrequences[leader];
+    this->written.governors[core] = this->written.governors[leader];
+}
+
+bool FrequenceController::write(const Policy &policy, uint frequence, const CoreStateStore &current, QString &error)
+{
+    const int leader = int(policy.leader);
+    const int core = onlineCore(policy.cores, current);
+    if(core < 0)
+    {
+        error = "Policy of core " + QString::number(leader) + " has no online core.";
+        return false;
+    }
+    const LogicCore &logicCore = this->coreSampler.logicCore(core);
+    try
+    {
+        if(this->current.mode == SetspeedMode)
+        {
+            logicCore.setScalingSpeed(frequence);
+        }
+        else
+        {
+            syncWritten(policy, core, current);
+            LogicCore::ApplySettings settings;
+            settings.online = current.online[core] != 0;
+            settings.minScalingFrequence = this->written.minScalingFrequences[leader];
+            settings.maxScalingFrequence = frequence;
+            settings.governor = GovernorTable::unknownGovernor;
+            settings.idleStatesMask = 0;
+            logicCore.apply(settings, this->written);
+            this->written.maxScalingFrequences[leader] = frequence;
+            this->written.maxScalingFrequences[core] = frequence;
+        }
+    }
+    catch(const std::logic_error &exception)
+    {
+        error = exception.what();
+        return false;
+    }
+    return true;
+}
+
+int FrequenceController::control(const CoreStateStore &current)
+{
+    TRACE_SCOPE("FrequenceController::control");
+    if(!this->active)
+        return 0;
+    const qint64 cpuStart = CoreSampler::threadCpuTime();
+    this->steps++;
+    int changed = 0;
+    for(Policy &policy: this->policies)
+    {
+        const int leader = int(policy.leader);
+        // Latency follows the busiest core, its work doesn't move to idle siblings.
+        float load = -1;
+        for(int core: policy.cores)
+        {
+            if((core == 0 || current.online[core]) && current.loads[core] > load)
+                load = current.loads[core];
+        }
+        const qint64 elapsed = policy.lastTimestamp != 0 ? current.timestamp - policy.lastTimestamp : 0;
+        policy.lastTimestamp = current.timestamp;
+        if(load < 0 || elapsed <= 0)
+        {
+            // Policy is offline or this is its first step, ramps need an interval.
+            policy.lowSince = 0;
+            continue;
+        }
+        uint target = policy.frequence;
+        if(load > this->current.upLoad)
+        {
+            policy.lowSince = 0;
+            qint64 rate = qint64(this->current.rampUp);
+            if(this->current.upLatency > 0)
+                rate = qMax(rate, qint64(policy.maxFrequence - policy.minFrequence)*1000/this->current.upLatency);
+            const qint64 step = qMax(rate*elapsed/NSEC_PER_SEC, qint64(1));
+            target = uint(qMin(qint64(policy.frequence) + step, qint64(policy.maxFrequence)));
+        }
+        else if(load < this->current.downLoad)
+        {
+            if(policy.lowSince == 0)
+                policy.lowSince = current.timestamp;
+            // Ramp starts counting once the delay is over, a short dip moves nothing.
+            if(current.timestamp - policy.lowSince >= qint64(this->current.downDelay)*NSEC_PER_MSEC)
+            {
+                const qint64 step = qMax(qint64(this->current.rampDown)*elapsed/NSEC_PER_SEC, qint64(1));
+                target = uint(qMax(qint64(policy.frequence) - step, qint64(policy.minFrequence)));
+            }
+        }
+        else
+        {
+            policy.lowSince = 0;
+        }
+        if(this->current.mode == LimitMode)
+        {
+            // Ceiling under scaling_min_freq would be rejected. An offline leader's values are stale,
+            //the policy's are read from the core that writes it.
+            const int core = onlineCore(policy.cores, current);
+            this->written.minScalingFrequences[leader] = current.minScalingFrequences[core];
+            target = qMax(target, current.minScalingFrequences[core]);
+        }
+        if(target == policy.frequence)
+            continue;
+
+        Decision decision;
+        decision.timestamp = current.timestamp;
+        decision.policyLeader = policy.leader;
+        decision.load = load;
+        decision.from = policy.frequence;
+        decision.to = target;
+        if(write(policy, target, current, decision.error))
+        {
+            policy.frequence = target;
+            policy.error.clear();
+            this->changes++;
+            changed++;
+            appendLog(decision);
+        }
+        else if(decision.error != policy.error)
+        {
+            // Failing policy is retried every step, the same error is logged once.
+            policy.error = decision.error;
+            appendLog(decision);
+        }
+    }
+    this->cpuTime += CoreSampler::threadCpuTime() - cpuStart;
+    return changed;
+}
+
+void FrequenceController::appendLog(const Decision &decision)
+{
+    this->log[int(this->logged % decisionLogCapacity)] = decision;
+    this->logged++;
+}
+
+quint64 FrequenceController::stepsTotal() const
+{
+    return this->steps;
+}
+
+quint64 FrequenceController::changesTotal() const
+{
+    return this->changes;
+}
+
+qint64 FrequenceController::controlTime() const
+{
+    return this->cpuTime;
+}
+
+quint64 FrequenceController::logTotal() const
+{
+    return this->logged;
+}
+
+quint64 FrequenceController::oldestLogEntry() const
+{
+    return this->logged > quint64(decisionLogCapacity) ? this->logged - decisionLogCapacity : 0;
+}
+
+const FrequenceController::Decision &FrequenceController::logEntry(quint64 index) const
+{
+    return this->log[int(index % decisionLogCapacity)];
+}
@@ -0,0 +1,129 @@
+#ifndef FREQUENCECONTROLLER_H
+#define FREQUENCECONTROLLER_H
+
+#include <QString>
+#include <QVector>
+
+#include "coresampler.h"
+
+// Closed-loop user-space frequence control. Every control step takes the busiest online core
+//of each cpufreq policy from the latest snapshot and moves the policy's frequence towards its load:
+//up when the load is above upLoad, down when it stayed below downLoad for downDelay, never faster
+//than the ramp rates. In LimitMode the frequence is the policy's scaling_max_freq and the governor
+//picks below it, in SetspeedMode it's written to scaling_setspeed of the userspace governor.
+// A step walks a few arrays and writes only policies whose frequence changes.
+class FrequenceController
+{
+public:
+    enum Mode
+    {
+        LimitMode,
+        SetspeedMode
+    };
+
+    struct Settings
+    {
+        Mode mode;
+        // Milliseconds between control steps, the caller subscribes load at it.
+        int interval;
+        // Percents, the gap between them is the hysteresis.
+        float upLoad;
+        float downLoad;
+        // kHz per second.
+        uint rampUp;
+        uint rampDown;
+        // Milliseconds from the lowest to the highest frequence under sustained load,
+        //raises the up ramp when it's slower than that.
+        int upLatency;
+        // Milliseconds the load must stay below downLoad before the frequence goes down.
+        int downDelay;
+    };
+    static Settings defaultSettings();
+
+    // Every change of a policy's frequence and every new write error, steps that hold are only counted.
+    struct Decision
+    {
+        // CLOCK_MONOTONIC time of the snapshot it was made on, nanoseconds.
+        qint64 timestamp;
+        uint policyLeader;
+        // Busiest core of the policy, percents.
+        float load;
+        // kHz.
+        uint from;
+        uint to;
+        // Empty when the frequence was written.
+        QString error;
+    };
+    static const int decisionLogCapacity = 1024;
+
+    explicit FrequenceController(CoreSampler &coreSampler);
+    FrequenceController(const FrequenceController &) = delete;
+    FrequenceController &operator=(const FrequenceController &) = delete;
+
+    // Starts from the current scaling limits. SetspeedMode switches policies to the userspace governor,
+    //returns false when it's not available or settings are invalid (see errorString()).
+    bool start(const Settings &settings, const CoreStateStore &current);
+    // Gives policies their scaling_max_freq and governor from before start() back.
+    void stop(const CoreStateStore &current);
+    bool isActive() const;
+    const Settings &settings() const;
+    QString errorString() const;
+    // SamplingPlan attributes the caller keeps subscribed for all cores at the interval.
+    quint32 attributes() const;
+
+    // One control step, returns the number of policies whose frequence changed.
+    int control(const CoreStateStore &current);
+
+    quint64 stepsTotal() const;
+    quint64 changesTotal() const;
+    // Thread CPU time spent in control(), nanoseconds.
+    qint64 controlTime() const;
+    // Entries ever logged, the newest decisionLogCapacity of them are kept.
+    quint64 logTotal() const;
+    // Index must be in [oldestLogEntry(), logTotal()).
+    const Decision &logEntry(quint64 index) const;
+    quint64 oldestLogEntry() const;
+
+private:
+    struct Policy
+    {
+        uint leader;
+        // Cores of the policy, leader first.
+        QVector<int> cores;
+        uint minFrequence;
+        uint maxFrequence;
+        // Frequence the controller wants, kHz.
+        uint frequence;
+        // Snapshot time the load went below downLoad, 0 while it isn't.
+        qint64 lowSince;
+        qint64 lastTimestamp;
+        // State from before start().
+        uint originalMaxScaling;
+        quint8 originalGovernor;
+        // Last error, logged again only when it changes.
+        QString error;
+    };
+
+    CoreSampler &coreSampler;
+    Settings current;
+    QVector<Policy> policies;
+    // Scaling state of policy leaders as the controller left it. apply() compares against it,
+    //a snapshot may still show the value from before the last write. Online state follows snapshots.
+    CoreStateStore written;
+    bool active;
+    QString error;
+    quint64 steps;
+    quint64 changes;
+    qint64 cpuTime;
+    QVector<Decision> log;
+    quint64 logged;
+
+    // Copies the leader's written state and the snapshot's online state to the core that writes the policy.
+    void syncWritten(const Policy &policy, int core, const CoreStateStore &current);
+    // Writes through the first online core of the policy.
+    //Returns false with `error` set when the frequence couldn't be written.
+    bool write(const Policy &policy, uint frequence, const CoreStateStore &current, QString &error);
+    void appendLog(const Decision &decision);
+};
+
+#endif // FREQUENCECONTROLLER_H
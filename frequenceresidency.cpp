@@ -0,0 +1,333 @@
+#include "frequenceresidency.h"
+
+#include <algorithm>
+#include <unistd.h>
+#include <QFile>
+#include <QStringList>
+
+#include "trace.h"
+
+const int FrequenceResidency::historyLength;
+
+namespace
+{
+// time_in_state of a policy has one short line per frequence.
+const size_t initialBufferSize = 4096;
+// Bins between hardware limits when the driver lists no frequences (intel_pstate, amd-pstate).
+const int fallbackBinsTotal = 16;
+
+const char *parseNumber(const char *position, const char *end, unsigned long long &value, bool &success)
+{
+    while(position < end && (*position == ' ' || *position == '\t'))
+        position++;
+    value = 0;
+    success = false;
+    while(position < end && *position >= '0' && *position <= '9')
+    {
+        value = value*10 + unsigned(*position - '0');
+        position++;
+        success = true;
+    }
+    return position;
+}
+}
+
+FrequenceResidency::Entry::Entry():
+    exact(false),
+    transitions(0),
+    timestamp(0),
+    baseTransitions(0),
+    baseTimestamp(0),
+    historyHead(0),
+    historyCount(0),
+    lastFrequence(0),
+    lastSampleTimestamp(0)
+{
+}
+
+FrequenceResidency::FrequenceResidency(const QVector<LogicCore*> &logicCores, qint64 timestamp):
+    logicCores(logicCores),
+    entries(size_t(logicCores.size())),
+    buffer(initialBufferSize),
+    // time_in_state counts in USER_HZ ticks.
+    nsecPerClockTick(1000000000/sysconf(_SC_CLK_TCK)),
+    updates(0)
+{
+    // Leaders first, an offline core below the leader of its policy is its follower.
+    for(int core = 0; core < logicCores.size(); core++)
+    {
+        if(logicCores[core]->isPolicyLeader())
+            initialize(core, timestamp);
+    }
+    for(int core = 0; core < logicCores.size(); core++)
+    {
+        if(!logicCores[core]->isPolicyLeader())
+            initialize(core, timestamp);
+    }
+}
+
+void FrequenceResidency::initialize(int coreNumber, qint64 timestamp)
+{
+    Entry &entry = this->entries[size_t(coreNumber)];
+    const LogicCore *logicCore = this->logicCores[coreNumber];
+    entry.exact = false;
+    entry.frequences.clear();
+    if(!logicCore->isPolicyLeader())
+    {
+        // Stats are per policy, followers use the leader's entry.
+        if(entryFor(coreNumber).exact)
+            return;
+    }
+    else
+    {
+        entry.timeInStateFile.open(logicCore->corePath("/cpufreq/stats/time_in_state"));
+        entry.totalTransitionsFile.open(logicCore->corePath("/cpufreq/stats/total_trans"));
+    }
+
+    if(entry.timeInStateFile.isOpen())
+    {
+        // First read sizes the table, later reads parse into it in the same order.
+        ssize_t length;
+        while((length = entry.timeInStateFile.read(this->buffer.data(), this->buffer.size())) == ssize_t(this->buffer.size()))
+            this->buffer.resize(this->buffer.size()*2);
+        const char *position = this->buffer.data();
+        const char *end = position + (length > 0 ? length : 0);
+        while(position < end)
+        {
+            unsigned long long frequence, time;
+            bool frequenceParsed, timeParsed;
+            position = parseNumber(position, end, frequence, frequenceParsed);
+            position = parseNumber(position, end, time, timeParsed);
+            if(frequenceParsed && timeParsed)
+                entry.frequences.push_back(uint(frequence));
+            while(position < end && *position++ != '\n')
+                ;
+        }
+        entry.exact = !entry.frequences.empty();
+    }
+    if(!entry.exact)
+    {
+        entry.timeInStateFile.close();
+        entry.totalTransitionsFile.close();
+        QFile file(logicCore->corePath("/cpufreq/scaling_available_frequencies"));
+        if(file.open(QIODevice::ReadOnly))
+        {
+            for(const QString &frequence: QString::fromLatin1(file.readAll()).split(' '))
+            {
+                bool success = false;
+                uint value = frequence.trimmed().toUInt(&success);
+                if(success)
+                    entry.frequences.push_back(value);
+            }
+        }
+        const uint minimum = logicCore->getMinCoreFrequence();
+        const uint maximum = logicCore->getMaxCoreFrequence();
+        if(entry.frequences.empty() && maximum > minimum)
+        {
+            for(int bin = 0; bin < fallbackBinsTotal; bin++)
+                entry.frequences.push_back(minimum + uint(qint64(maximum - minimum)*bin/(fallbackBinsTotal - 1)));
+        }
+        std::sort(entry.frequences.begin(), entry.frequences.end());
+    }
+    if(entry.frequences.empty())
+        return;
+
+    const size_t frequencesTotal = entry.frequences.size();
+    entry.times.assign(frequencesTotal, 0);
+    entry.historyTimes.assign(frequencesTotal*historyLength, 0);
+    entry.historyTransitions.assign(historyLength, 0);
+    entry.historyTimestamps.assign(historyLength, 0);
+    entry.historyHead = 0;
+    entry.historyCount = 0;
+    entry.transitions = 0;
+    entry.lastSampleTimestamp = 0;
+    if(entry.exact)
+        readStats(entry);
+    entry.timestamp = timestamp;
+    entry.baseTimes = entry.times;
+    entry.baseTransitions = entry.transitions;
+    entry.baseTimestamp = timestamp;
+}
+
+bool FrequenceResidency::readStats(Entry &entry)
+{
+    TRACE_SCOPE("FrequenceResidency::readStats");
+    const ssize_t length = entry.timeInStateFile.read(this->buffer.data(), this->buffer.size());
+    if(length <= 0)
+        return false;
+    const char *position = this->buffer.data();
+    const char *end = position + length;
+    const size_t frequencesTotal = entry.frequences.size();
+    size_t index = 0;
+    while(position < end)
+    {
+        unsigned long long frequence, time;
+        bool frequenceParsed, timeParsed;
+        position = parseNumber(position, end, frequence, frequenceParsed);
+        position = parseNumber(position, end, time, timeParsed);
+        while(position < end && *position++ != '\n')
+            ;
+        if(!frequenceParsed || !timeParsed)
+            continue;
+        // Lines keep their order, a frequence that appeared later (boost) is searched for.
+        if(index >= frequencesTotal || entry.frequences[index] != uint(frequence))
+        {
+            index = 0;
+            while(index < frequencesTotal && entry.frequences[index] != uint(frequence))
+                index++;
+            if(index == frequencesTotal)
+                continue;
+        }
+        entry.times[index] = qint64(time)*this->nsecPerClockTick;
+        index++;
+    }
+    uint transitions;
+    if(entry.totalTransitionsFile.isOpen() && entry.totalTransitionsFile.readUInt(transitions))
+        entry.transitions = transitions;
+    return true;
+}
+
+void FrequenceResidency::pushHistory(Entry &entry)
+{
+    const size_t frequencesTotal = entry.frequences.size();
+    std::copy(entry.times.begin(), entry.times.end(), entry.historyTimes.begin() + entry.historyHead*frequencesTotal);
+    entry.historyTransitions[size_t(entry.historyHead)] = entry.transitions;
+    entry.historyTimestamps[size_t(entry.historyHead)] = entry.timestamp;
+    entry.historyHead = (entry.historyHead + 1) % historyLength;
+    if(entry.historyCount < historyLength)
+        entry.historyCount++;
+}
+
+int FrequenceResidency::nearestFrequence(const Entry &entry, uint frequence)
+{
+    int nearest = 0;
+    uint nearestDistance = ~0u;
+    for(size_t i = 0; i < entry.frequences.size(); i++)
+    {
+        const uint distance = entry.frequences[i] > frequence ? entry.frequences[i] - frequence : frequence - entry.frequences[i];
+        if(distance < nearestDistance)
+        {
+            nearest = int(i);
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+const FrequenceResidency::Entry &FrequenceResidency::entryFor(int coreNumber) const
+{
+    const LogicCore *logicCore = this->logicCores[coreNumber];
+    const uint leader = logicCore->getSamplingLeaderNumber();
+    if(!logicCore->isPolicyLeader() && leader < this->entries.size() && this->entries[leader].exact)
+        return this->entries[leader];
+    return this->entries[size_t(coreNumber)];
+}
+
+FrequenceResidency::Entry &FrequenceResidency::entryFor(int coreNumber)
+{
+    return const_cast<Entry&>(static_cast<const FrequenceResidency*>(this)->entryFor(coreNumber));
+}
+
+void FrequenceResidency::sample(const std::vector<int> &cores, qint64 timestamp)
+{
+    QMutexLocker locker(&this->mutex);
+    for(int core: cores)
+    {
+        Entry &entry = this->entries[size_t(core)];
+        if(entry.exact || entry.frequences.empty())
+            continue;
+        const LogicCore *logicCore = this->logicCores[core];
+        if(!logicCore->getOnline())
+        {
+            entry.lastSampleTimestamp = 0;
+            continue;
+        }
+        // Time since the previous sample is charged to the frequence seen then.
+        const uint frequence = logicCore->getCurrentCoreFrequence();
+        if(entry.lastSampleTimestamp != 0)
+        {
+            entry.times[size_t(nearestFrequence(entry, entry.lastFrequence))] += timestamp - entry.lastSampleTimestamp;
+            if(frequence != entry.lastFrequence)
+                entry.transitions++;
+        }
+        entry.lastFrequence = frequence;
+        entry.lastSampleTimestamp = timestamp;
+        entry.timestamp = timestamp;
+    }
+}
+
+void FrequenceResidency::update(const std::vector<int> &cores, qint64 timestamp)
+{
+    QMutexLocker locker(&this->mutex);
+    for(int core: cores)
+    {
+        Entry &entry = entryFor(core);
+        if(entry.frequences.empty())
+            continue;
+        // Followers of one policy share the leader's entry, it's read once per tick.
+        const int newest = (entry.historyHead + historyLength - 1) % historyLength;
+        if(entry.historyCount > 0 && entry.historyTimestamps[size_t(newest)] == timestamp)
+            continue;
+        if(entry.exact)
+        {
+            readStats(entry);
+            entry.timestamp = timestamp;
+        }
+        pushHistory(entry);
+    }
+    this->updates++;
+}
+
+void FrequenceResidency::refresh(int coreNumber, qint64 timestamp)
+{
+    QMutexLocker locker(&this->mutex);
+    // Tables of a core that was offline since start are made when its cpufreq directory shows up.
+    if(this->entries[size_t(coreNumber)].frequences.empty() && !entryFor(coreNumber).exact)
+        initialize(coreNumber, timestamp);
+}
+
+bool FrequenceResidency::query(int coreNumber, qint64 window, Table &table) const
+{
+    QMutexLocker locker(&this->mutex);
+    const Entry &entry = entryFor(coreNumber);
+    if(entry.frequences.empty())
+        return false;
+    // Newest table old enough for the window, or the oldest one while history is short.
+    const qint64 *referenceTimes = entry.baseTimes.data();
+    quint64 referenceTransitions = entry.baseTransitions;
+    qint64 referenceTimestamp = entry.baseTimestamp;
+    if(window > 0)
+    {
+        const size_t frequencesTotal = entry.frequences.size();
+        for(int age = 0; age < entry.historyCount; age++)
+        {
+            const int index = (entry.historyHead + historyLength - 1 - age) % historyLength;
+            const bool oldest = age == entry.historyCount - 1 && entry.historyCount == historyLength;
+            if(entry.historyTimestamps[size_t(index)] <= entry.timestamp - window || oldest)
+            {
+                referenceTimes = &entry.historyTimes[size_t(index)*frequencesTotal];
+                referenceTransitions = entry.historyTransitions[size_t(index)];
+                referenceTimestamp = entry.historyTimestamps[size_t(index)];
+                break;
+            }
+        }
+    }
+    const int frequencesTotal = int(entry.frequences.size());
+    table.frequences.resize(frequencesTotal);
+    table.times.resize(frequencesTotal);
+    for(int i = 0; i < frequencesTotal; i++)
+    {
+        table.frequences[i] = entry.frequences[size_t(i)];
+        table.times[i] = entry.times[size_t(i)] - referenceTimes[i];
+    }
+    table.transitions = entry.transitions - referenceTransitions;
+    table.duration = entry.timestamp - referenceTimestamp;
+    table.exact = entry.exact;
+    return true;
+}
+
+quint64 FrequenceResidency::revision() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->updates;
+}
@@ -0,0 +1,94 @@
+#ifndef FREQUENCERESIDENCY_H
+#define FREQUENCERESIDENCY_H
+
+#include <vector>
+#include <QMutex>
+#include <QVector>
+
+#include "logiccore.h"
+#include "sysfsattribute.h"
+
+// Time spent at every frequence and number of transitions, per core.
+// Exact values come from the kernel's cpufreq/stats/time_in_state and total_trans of the policy,
+//read as deltas against a baseline taken at start. Without stats the residency is accumulated
+//from polled current frequences, as exact as their sampling rate.
+// Tables are sized once by the frequence list, nothing is allocated while sampling.
+class FrequenceResidency
+{
+public:
+    // Residency over a window, times are in nanoseconds.
+    struct Table
+    {
+        QVector<uint> frequences;
+        QVector<qint64> times;
+        quint64 transitions;
+        // Covered time, shorter than the window while history is still being collected.
+        qint64 duration;
+        // From cpufreq stats, not from polling.
+        bool exact;
+    };
+    // Cumulative tables kept for windows, one per residency tick of the sampling plan.
+    static const int historyLength = 64;
+
+    // Baseline for "since start" is taken here, timestamps are CLOCK_MONOTONIC nanoseconds.
+    FrequenceResidency(const QVector<LogicCore*> &logicCores, qint64 timestamp);
+    FrequenceResidency(const FrequenceResidency &) = delete;
+    FrequenceResidency &operator=(const FrequenceResidency &) = delete;
+
+    // Sampler thread. sample() runs every tick for cores whose current frequence was read,
+    //update() for cores due for residency, it reads stats and appends to the history.
+    void sample(const std::vector<int> &cores, qint64 timestamp);
+    void update(const std::vector<int> &cores, qint64 timestamp);
+    // Reopens stats of a core after hotplug or after it became the leader of its policy,
+    //does nothing when its table is ready.
+    void refresh(int coreNumber, qint64 timestamp);
+
+    // Any thread. Window 0 means since start. False when the core has no frequence table.
+    bool query(int coreNumber, qint64 window, Table &table) const;
+    // Grows with every update(), so views can skip unchanged tables.
+    quint64 revision() const;
+
+private:
+    struct Entry
+    {
+        SysfsAttribute timeInStateFile;
+        SysfsAttribute totalTransitionsFile;
+        bool exact;
+        std::vector<uint> frequences;
+        // Cumulative values as of `timestamp`.
+        std::vector<qint64> times;
+        quint64 transitions;
+        qint64 timestamp;
+        std::vector<qint64> baseTimes;
+        quint64 baseTransitions;
+        qint64 baseTimestamp;
+        // Ring of historyLength cumulative tables.
+        std::vector<qint64> historyTimes;
+        std::vector<quint64> historyTransitions;
+        std::vector<qint64> historyTimestamps;
+        int historyHead;
+        int historyCount;
+        // Polling fallback.
+        uint lastFrequence;
+        qint64 lastSampleTimestamp;
+
+        Entry();
+    };
+
+    const QVector<LogicCore*> &logicCores;
+    std::vector<Entry> entries;
+    std::vector<char> buffer;
+    const qint64 nsecPerClockTick;
+    mutable QMutex mutex;
+    quint64 updates;
+
+    void initialize(int coreNumber, qint64 timestamp);
+    bool readStats(Entry &entry);
+    void pushHistory(Entry &entry);
+    static int nearestFrequence(const Entry &entry, uint frequence);
+    // Entry with the values of this core, the policy leader's one when it has exact stats.
+    const Entry &entryFor(int coreNumber) const;
+    Entry &entryFor(int coreNumber);
+};
+
+#endif // FREQUENCERESIDENCY_H
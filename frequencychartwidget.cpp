@@ -0,0 +1,75 @@
+#include "frequencychartwidget.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#include "trace.h"
+
+FrequencyChartWidget::FrequencyChartWidget(QWidget *parent):
+    QWidget(parent),
+    pyramid(nullptr),
+    span(1),
+    minimum(0),
+    maximum(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumHeight(120);
+}
+
+void FrequencyChartWidget::setSeries(const SamplePyramid *pyramid, quint64 span, quint32 minimum, quint32 maximum)
+{
+    this->pyramid = pyramid;
+    this->span = span < 1 ? 1 : span;
+    this->minimum = minimum;
+    this->maximum = maximum;
+    update();
+}
+
+int FrequencyChartWidget::valueToY(quint32 value, int height) const
+{
+    if(this->maximum <= this->minimum)
+        return height/2;
+    if(value < this->minimum)
+        value = this->minimum;
+    if(value > this->maximum)
+        value = this->maximum;
+    return height - 1 - int(qint64(value - this->minimum)*(height - 1)/qint64(this->maximum - this->minimum));
+}
+
+void FrequencyChartWidget::paintEvent(QPaintEvent *event)
+{
+    TRACE_SCOPE("FrequencyChartWidget::paintEvent");
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(0, 0, width() - 1, height() - 1);
+    if(this->pyramid == nullptr || width() < 2)
+        return;
+
+    // One bucket per pixel column at most.
+    const int chartWidth = width();
+    const int chartHeight = height();
+    quint64 newestSamples;
+    const quint64 samplesPerBucket = this->pyramid->query(this->span, chartWidth, this->buckets, newestSamples);
+    const int count = this->buckets.size();
+    this->bandLines.resize(count);
+    this->averagePoints.resize(count);
+    for(int i = 0; i < count; i++)
+    {
+        // Bucket i ends (count - 1 - i) whole buckets before the newest one, which may be partial.
+        const quint64 samplesBack = quint64(count - 1 - i)*samplesPerBucket + newestSamples;
+        const int x = chartWidth - 1 - int(samplesBack*quint64(chartWidth - 1)/this->span);
+        const SamplePyramid::Bucket &bucket = this->buckets[i];
+        this->bandLines[i] = QLine(x, valueToY(bucket.minimum, chartHeight), x, valueToY(bucket.maximum, chartHeight));
+        this->averagePoints[i] = QPoint(x, valueToY(bucket.average, chartHeight));
+    }
+    painter.setPen(QColor(170, 200, 240));
+    painter.drawLines(this->bandLines.constData(), count);
+    painter.setPen(QColor(20, 70, 160));
+    painter.drawPolyline(this->averagePoints.constData(), count);
+
+    const int HZ_TO_MHZ = 1000;
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(4, 14, QString::number(this->maximum/HZ_TO_MHZ) + " MHz");
+    painter.drawText(4, chartHeight - 4, QString::number(this->minimum/HZ_TO_MHZ) + " MHz");
+}
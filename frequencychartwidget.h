@@ -0,0 +1,41 @@
+#ifndef FREQUENCYCHARTWIDGET_H
+#define FREQUENCYCHARTWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+#include <QLine>
+#include <QPoint>
+
+#include "samplepyramid.h"
+
+// Frequence history of one core: min/max band and average line, newest sample at the right edge.
+// Buckets come from a SamplePyramid level picked for the widget width,
+//so painting costs the same for a minute and for hours of history.
+class FrequencyChartWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FrequencyChartWidget(QWidget *parent = nullptr);
+
+    // Span is in samples, range is the hardware frequence range in kHz.
+    void setSeries(const SamplePyramid *pyramid, quint64 span, quint32 minimum, quint32 maximum);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    const SamplePyramid *pyramid;
+    quint64 span;
+    quint32 minimum;
+    quint32 maximum;
+
+    // Reused between paints.
+    QVector<SamplePyramid::Bucket> buckets;
+    QVector<QLine> bandLines;
+    QVector<QPoint> averagePoints;
+
+    int valueToY(quint32 value, int height) const;
+};
+
+#endif // FREQUENCYCHARTWIDGET_H
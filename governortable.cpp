@@ -0,0 +1,85 @@
+#include "governortable.h"
+
+#include <cstring>
+
+GovernorTable::GovernorTable():
+    count(1)
+{
+    this->rawLengths[unknownGovernor] = 0;
+    this->rawNames[unknownGovernor][0] = '\0';
+}
+
+GovernorTable &GovernorTable::instance()
+{
+    static GovernorTable table;
+    return table;
+}
+
+int GovernorTable::lookup(const char *name, ssize_t length, int namesTotal) const
+{
+    for(int id = 0; id < namesTotal; id++)
+    {
+        if(this->rawLengths[id] == length && memcmp(this->rawNames[id], name, size_t(length)) == 0)
+            return id;
+    }
+    return -1;
+}
+
+quint8 GovernorTable::intern(const char *name, ssize_t length)
+{
+    if(length <= 0)
+        return unknownGovernor;
+    // Keep room for the terminating NUL.
+    if(length >= SysfsAttribute::bufferSize)
+        length = SysfsAttribute::bufferSize - 1;
+    int id = lookup(name, length, this->count.load(std::memory_order_acquire));
+    if(id >= 0)
+        return quint8(id);
+
+    std::lock_guard<std::mutex> lock(this->appendMutex);
+    const int namesTotal = this->count.load(std::memory_order_relaxed);
+    id = lookup(name, length, namesTotal);
+    if(id >= 0)
+        return quint8(id);
+    if(namesTotal == capacity)
+        return unknownGovernor;
+    memcpy(this->rawNames[namesTotal], name, size_t(length));
+    this->rawNames[namesTotal][length] = '\0';
+    this->rawLengths[namesTotal] = length;
+    this->names[namesTotal] = QString::fromLatin1(name, int(length));
+    // Readers see the new entry only after it is complete.
+    this->count.store(namesTotal + 1, std::memory_order_release);
+    return quint8(namesTotal);
+}
+
+quint8 GovernorTable::intern(const QString &name)
+{
+    QByteArray latin = name.toLatin1();
+    return intern(latin.constData(), latin.size());
+}
+
+quint8 GovernorTable::find(const QString &name) const
+{
+    QByteArray latin = name.toLatin1();
+    int id = lookup(latin.constData(), latin.size(), this->count.load(std::memory_order_acquire));
+    return id < 0 ? unknownGovernor : quint8(id);
+}
+
+const QString &GovernorTable::name(quint8 id) const
+{
+    if(id >= this->count.load(std::memory_order_acquire))
+        return this->names[unknownGovernor];
+    return this->names[id];
+}
+
+const char *GovernorTable::latin1Name(quint8 id) const
+{
+    if(id >= this->count.load(std::memory_order_acquire))
+        return this->rawNames[unknownGovernor];
+    return this->rawNames[id];
+}
+
+int GovernorTable::size() const
+{
+    return this->count.load(std::memory_order_acquire);
+}
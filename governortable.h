@@ -0,0 +1,44 @@
+#ifndef GOVERNORTABLE_H
+#define GOVERNORTABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <sys/types.h>
+#include <QString>
+
+#include "sysfsattribute.h"
+
+// Process-wide table of governor names, every distinct name gets a small integer id.
+// Lookups are lock-free, only appending a name never seen before takes a lock.
+//Names are never removed, so an id stays valid for the whole run.
+class GovernorTable
+{
+public:
+    static const int capacity = 32;
+    // Id of the empty name, also returned when the table is full.
+    static const quint8 unknownGovernor = 0;
+
+    static GovernorTable &instance();
+
+    quint8 intern(const char *name, ssize_t length);
+    quint8 intern(const QString &name);
+    // Id of an already interned name or unknownGovernor.
+    quint8 find(const QString &name) const;
+
+    const QString &name(quint8 id) const;
+    // Same name as a NUL-terminated Latin-1 string, for writers that avoid QString.
+    const char *latin1Name(quint8 id) const;
+    int size() const;
+
+private:
+    QString names[capacity];
+    char rawNames[capacity][SysfsAttribute::bufferSize];
+    ssize_t rawLengths[capacity];
+    std::atomic<int> count;
+    std::mutex appendMutex;
+
+    GovernorTable();
+    int lookup(const char *name, ssize_t length, int namesTotal) const;
+};
+
+#endif // GOVERNORTABLE_H
@@ -0,0 +1,58 @@
+#ifndef HISTORYFORMAT_H
+#define HISTORYFORMAT_H
+
+#include <QtGlobal>
+
+#include "streamformat.h"
+
+// Layout of the memory-mapped history ring written by HistoryRecorder, native byte order.
+//
+// HistoryFileHeader, padded to historyHeaderAlignment
+// HistoryCoreInfo for every core (static attributes)
+// padding to historyHeaderAlignment
+// `capacity` records of `recordSize` bytes: HistoryRecordHeader, then StreamCoreRecord for every core.
+//
+// Record number N (counting from the first one ever written) lives in slot N % capacity.
+//Records [max(0, recordsWritten - capacity), recordsWritten) are valid.
+
+const char historyMagic[4] = {'L', 'C', 'I', 'H'};
+const quint16 historyVersion = 1;
+const int historyHeaderAlignment = 4096;
+const int historyGovernorsCapacity = 32;
+const int historyGovernorNameSize = 32;
+
+struct HistoryFileHeader
+{
+    char magic[4];
+    quint16 version;
+    quint16 headerSize;
+    quint32 coresTotal;
+    quint32 recordSize;
+    quint64 capacity;
+    // Offset of the first record slot from the file start.
+    quint64 recordsOffset;
+    // Updated after the record is complete.
+    quint64 recordsWritten;
+    // Sampling interval in nanoseconds, informative only.
+    qint64 interval;
+    quint32 governorsTotal;
+    quint32 reserved;
+    // NUL-terminated names, index is the governor id used in records.
+    char governorNames[historyGovernorsCapacity][historyGovernorNameSize];
+};
+
+struct HistoryCoreInfo
+{
+    quint32 minCoreFrequence;
+    quint32 maxCoreFrequence;
+    quint32 availableGovernors;
+    quint32 reserved;
+};
+
+struct HistoryRecordHeader
+{
+    quint64 sequence;
+    qint64 timestamp;
+};
+
+#endif // HISTORYFORMAT_H
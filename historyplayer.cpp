@@ -0,0 +1,161 @@
+#include "historyplayer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "governortable.h"
+
+HistoryPlayer::HistoryPlayer():
+    mapping(nullptr),
+    mappingSize(0),
+    header(nullptr),
+    coreInfo(nullptr),
+    firstRecord(0),
+    recordsAvailable(0)
+{
+}
+
+HistoryPlayer::~HistoryPlayer()
+{
+    close();
+}
+
+bool HistoryPlayer::open(const QString &path)
+{
+    close();
+    this->error.clear();
+    int fileDescriptor = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if(fileDescriptor < 0)
+    {
+        this->error = QString("Cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat fileStatus;
+    if(fstat(fileDescriptor, &fileStatus) != 0 || size_t(fileStatus.st_size) < sizeof(HistoryFileHeader))
+    {
+        ::close(fileDescriptor);
+        this->error = "File is too small to be a history file.";
+        return false;
+    }
+    void *map = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    ::close(fileDescriptor);
+    if(map == MAP_FAILED)
+    {
+        this->error = QString("Cannot map history file: ") + strerror(errno);
+        return false;
+    }
+    this->mapping = static_cast<char*>(map);
+    this->mappingSize = size_t(fileStatus.st_size);
+    this->header = reinterpret_cast<const HistoryFileHeader*>(this->mapping);
+
+    const HistoryFileHeader &fileHeader = *this->header;
+    const size_t recordSize = sizeof(HistoryRecordHeader) + size_t(fileHeader.coresTotal)*sizeof(StreamCoreRecord);
+    const size_t coreInfoOffset = (sizeof(HistoryFileHeader) + historyHeaderAlignment - 1)/historyHeaderAlignment*historyHeaderAlignment;
+    if(memcmp(fileHeader.magic, historyMagic, sizeof(historyMagic)) != 0 || fileHeader.version != historyVersion)
+        this->error = "Not a history file or unsupported version.";
+    else if(fileHeader.recordSize != recordSize || fileHeader.capacity == 0
+            || fileHeader.recordsOffset < coreInfoOffset + size_t(fileHeader.coresTotal)*sizeof(HistoryCoreInfo)
+            || fileHeader.recordsOffset + fileHeader.capacity*recordSize > this->mappingSize
+            || fileHeader.governorsTotal > quint32(historyGovernorsCapacity))
+        this->error = "History file is damaged.";
+    if(!this->error.isEmpty())
+    {
+        close();
+        return false;
+    }
+
+    this->coreInfo = reinterpret_cast<const HistoryCoreInfo*>(this->mapping + coreInfoOffset);
+    const quint64 recordsWritten = __atomic_load_n(&fileHeader.recordsWritten, __ATOMIC_ACQUIRE);
+    this->recordsAvailable = recordsWritten < fileHeader.capacity ? recordsWritten : fileHeader.capacity;
+    this->firstRecord = recordsWritten - this->recordsAvailable;
+
+    for(int id = 0; id < historyGovernorsCapacity; id++)
+        this->governorMap[id] = GovernorTable::unknownGovernor;
+    for(quint32 id = 1; id < fileHeader.governorsTotal; id++)
+    {
+        const char *name = fileHeader.governorNames[id];
+        this->governorMap[id] = GovernorTable::instance().intern(name, ssize_t(strnlen(name, historyGovernorNameSize)));
+    }
+    return true;
+}
+
+void HistoryPlayer::close()
+{
+    if(this->mapping != nullptr)
+        munmap(this->mapping, this->mappingSize);
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+    this->header = nullptr;
+    this->coreInfo = nullptr;
+    this->firstRecord = 0;
+    this->recordsAvailable = 0;
+}
+
+QString HistoryPlayer::errorString() const
+{
+    return this->error;
+}
+
+int HistoryPlayer::coresTotal() const
+{
+    return this->header == nullptr ? 0 : int(this->header->coresTotal);
+}
+
+quint64 HistoryPlayer::recordsTotal() const
+{
+    return this->recordsAvailable;
+}
+
+const char *HistoryPlayer::recordAt(quint64 index) const
+{
+    const quint64 slot = (this->firstRecord + index) % this->header->capacity;
+    return this->mapping + this->header->recordsOffset + slot*this->header->recordSize;
+}
+
+qint64 HistoryPlayer::timestampAt(quint64 index) const
+{
+    return reinterpret_cast<const HistoryRecordHeader*>(recordAt(index))->timestamp;
+}
+
+quint32 HistoryPlayer::mapGovernorMask(quint32 mask) const
+{
+    quint32 mapped = 0;
+    for(int id = 0; id < historyGovernorsCapacity; id++)
+    {
+        if(mask & (quint32(1) << id) && this->governorMap[id] != GovernorTable::unknownGovernor)
+            mapped |= quint32(1) << this->governorMap[id];
+    }
+    return mapped;
+}
+
+void HistoryPlayer::read(quint64 index, CoreStateStore &store) const
+{
+    const int coresTotal = this->coresTotal();
+    if(store.size() != coresTotal)
+        store.resize(coresTotal);
+    const char *record = recordAt(index);
+    const HistoryRecordHeader *recordHeader = reinterpret_cast<const HistoryRecordHeader*>(record);
+    const StreamCoreRecord *cores = reinterpret_cast<const StreamCoreRecord*>(record + sizeof(HistoryRecordHeader));
+    store.sequence = recordHeader->sequence;
+    store.timestamp = recordHeader->timestamp;
+    store.samplingDuration = 0;
+    store.samplingCpuTime = 0;
+    store.jitter = 0;
+    for(int core = 0; core < coresTotal; core++)
+    {
+        store.minCoreFrequences[core] = this->coreInfo[core].minCoreFrequence;
+        store.maxCoreFrequences[core] = this->coreInfo[core].maxCoreFrequence;
+        store.availableGovernors[core] = mapGovernorMask(this->coreInfo[core].availableGovernors);
+        store.currentFrequences[core] = cores[core].currentFrequence;
+        store.minScalingFrequences[core] = cores[core].minScalingFrequence;
+        store.maxScalingFrequences[core] = cores[core].maxScalingFrequence;
+        store.loads[core] = cores[core].load == streamUnknownLoad ? -1.0f : float(cores[core].load)/100.0f;
+        store.online[core] = cores[core].online;
+        const quint8 governor = cores[core].governor;
+        store.governors[core] = governor < historyGovernorsCapacity ? this->governorMap[governor] : GovernorTable::unknownGovernor;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef HISTORYPLAYER_H
+#define HISTORYPLAYER_H
+
+#include <QString>
+
+#include "corestatestore.h"
+#include "historyformat.h"
+
+// Read-only view of a history file written by HistoryRecorder.
+// Records are indexed from the oldest one still kept in the ring.
+class HistoryPlayer
+{
+public:
+    HistoryPlayer();
+    ~HistoryPlayer();
+    HistoryPlayer(const HistoryPlayer &) = delete;
+    HistoryPlayer &operator=(const HistoryPlayer &) = delete;
+
+    bool open(const QString &path);
+    void close();
+    QString errorString() const;
+
+    int coresTotal() const;
+    quint64 recordsTotal() const;
+    qint64 timestampAt(quint64 index) const;
+    // Fills `store` with the record, governor ids are mapped to this process' GovernorTable.
+    void read(quint64 index, CoreStateStore &store) const;
+
+private:
+    char *mapping;
+    size_t mappingSize;
+    const HistoryFileHeader *header;
+    const HistoryCoreInfo *coreInfo;
+    quint64 firstRecord;
+    quint64 recordsAvailable;
+    quint8 governorMap[historyGovernorsCapacity];
+    QString error;
+
+    const char *recordAt(quint64 index) const;
+    quint32 mapGovernorMask(quint32 mask) const;
+};
+
+#endif // HISTORYPLAYER_H
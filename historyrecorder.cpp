@@ -0,0 +1,158 @@
+#include "historyrecorder.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "governortable.h"
+
+namespace
+{
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1)/alignment*alignment;
+}
+}
+
+HistoryRecorder::HistoryRecorder():
+    fileDescriptor(-1),
+    mapping(nullptr),
+    mappingSize(0),
+    header(nullptr),
+    nextTimestamp(0)
+{
+}
+
+HistoryRecorder::~HistoryRecorder()
+{
+    close();
+}
+
+bool HistoryRecorder::open(const QString &path, quint64 capacity, const CoreStateStore &store, int interval)
+{
+    close();
+    if(capacity == 0)
+    {
+        this->error = "History capacity must be positive.";
+        return false;
+    }
+    const int coresTotal = store.size();
+    const size_t recordSize = sizeof(HistoryRecordHeader) + size_t(coresTotal)*sizeof(StreamCoreRecord);
+    const size_t recordsOffset = alignUp(alignUp(sizeof(HistoryFileHeader), historyHeaderAlignment)
+                                         + size_t(coresTotal)*sizeof(HistoryCoreInfo), historyHeaderAlignment);
+    const size_t fileSize = recordsOffset + recordSize*capacity;
+
+    this->fileDescriptor = ::open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(this->fileDescriptor < 0)
+    {
+        this->error = QString("Cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    // Reserve blocks now, so a full disk is reported here and not as SIGBUS while recording.
+    int result = posix_fallocate(this->fileDescriptor, 0, off_t(fileSize));
+    if(result != 0)
+    {
+        this->error = QString("Cannot allocate history file: ") + strerror(result);
+        close();
+        return false;
+    }
+    void *map = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fileDescriptor, 0);
+    if(map == MAP_FAILED)
+    {
+        this->error = QString("Cannot map history file: ") + strerror(errno);
+        close();
+        return false;
+    }
+    this->mapping = static_cast<char*>(map);
+    this->mappingSize = fileSize;
+    this->header = reinterpret_cast<HistoryFileHeader*>(this->mapping);
+
+    memset(this->header, 0, sizeof(HistoryFileHeader));
+    memcpy(this->header->magic, historyMagic, sizeof(this->header->magic));
+    this->header->version = historyVersion;
+    this->header->headerSize = sizeof(HistoryFileHeader);
+    this->header->coresTotal = quint32(coresTotal);
+    this->header->recordSize = quint32(recordSize);
+    this->header->capacity = capacity;
+    this->header->recordsOffset = recordsOffset;
+    this->header->interval = qint64(interval)*1000000;
+    this->nextTimestamp = 0;
+    HistoryCoreInfo *coreInfo = reinterpret_cast<HistoryCoreInfo*>(this->mapping + alignUp(sizeof(HistoryFileHeader), historyHeaderAlignment));
+    for(int core = 0; core < coresTotal; core++)
+    {
+        coreInfo[core].minCoreFrequence = store.minCoreFrequences[core];
+        coreInfo[core].maxCoreFrequence = store.maxCoreFrequences[core];
+        coreInfo[core].availableGovernors = store.availableGovernors[core];
+        coreInfo[core].reserved = 0;
+    }
+    updateGovernorNames();
+    return true;
+}
+
+void HistoryRecorder::close()
+{
+    if(this->mapping != nullptr)
+    {
+        msync(this->mapping, this->mappingSize, MS_ASYNC);
+        munmap(this->mapping, this->mappingSize);
+    }
+    if(this->fileDescriptor >= 0)
+        ::close(this->fileDescriptor);
+    this->mapping = nullptr;
+    this->header = nullptr;
+    this->mappingSize = 0;
+    this->fileDescriptor = -1;
+}
+
+bool HistoryRecorder::isOpen() const
+{
+    return this->mapping != nullptr;
+}
+
+QString HistoryRecorder::errorString() const
+{
+    return this->error;
+}
+
+void HistoryRecorder::updateGovernorNames()
+{
+    const GovernorTable &governorTable = GovernorTable::instance();
+    int governorsTotal = governorTable.size();
+    if(governorsTotal > historyGovernorsCapacity)
+        governorsTotal = historyGovernorsCapacity;
+    for(int id = int(this->header->governorsTotal); id < governorsTotal; id++)
+        strncpy(this->header->governorNames[id], governorTable.latin1Name(quint8(id)), historyGovernorNameSize - 1);
+    this->header->governorsTotal = quint32(governorsTotal);
+}
+
+void HistoryRecorder::consume(const CoreStateStore &store)
+{
+    if(this->header == nullptr || store.timestamp < this->nextTimestamp)
+        return;
+    // Sampling plan aligns deadlines to multiples of the interval, ticks only come after them.
+    this->nextTimestamp = (store.timestamp/this->header->interval + 1)*this->header->interval;
+    if(this->header->governorsTotal < quint32(GovernorTable::instance().size()))
+        updateGovernorNames();
+
+    const quint64 recordNumber = this->header->recordsWritten;
+    char *record = this->mapping + this->header->recordsOffset + (recordNumber % this->header->capacity)*this->header->recordSize;
+    HistoryRecordHeader *recordHeader = reinterpret_cast<HistoryRecordHeader*>(record);
+    recordHeader->sequence = store.sequence;
+    recordHeader->timestamp = store.timestamp;
+    StreamCoreRecord *cores = reinterpret_cast<StreamCoreRecord*>(record + sizeof(HistoryRecordHeader));
+    const int coresTotal = int(this->header->coresTotal);
+    for(int core = 0; core < coresTotal; core++)
+    {
+        const float load = store.loads[core];
+        cores[core].currentFrequence = store.currentFrequences[core];
+        cores[core].minScalingFrequence = store.minScalingFrequences[core];
+        cores[core].maxScalingFrequence = store.maxScalingFrequences[core];
+        cores[core].load = load < 0 ? streamUnknownLoad : quint16(load*100.0f + 0.5f);
+        cores[core].online = store.online[core];
+        cores[core].governor = store.governors[core];
+    }
+    // Readers of a live file only look at records below recordsWritten.
+    __atomic_store_n(&this->header->recordsWritten, recordNumber + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,41 @@
+#ifndef HISTORYRECORDER_H
+#define HISTORYRECORDER_H
+
+#include <QString>
+
+#include "snapshotsink.h"
+#include "historyformat.h"
+
+// Appends ticks to a memory-mapped ring file (see historyformat.h), at most one per interval,
+//so faster subscriptions of other views don't use up the capacity.
+// Records are written straight into the mapping, nothing is allocated per tick.
+class HistoryRecorder : public SnapshotSink
+{
+public:
+    HistoryRecorder();
+    ~HistoryRecorder();
+    HistoryRecorder(const HistoryRecorder &) = delete;
+    HistoryRecorder &operator=(const HistoryRecorder &) = delete;
+
+    // Creates or truncates the file, `capacity` is the number of ticks kept.
+    //Static attributes are taken from `store`, interval is in milliseconds.
+    bool open(const QString &path, quint64 capacity, const CoreStateStore &store, int interval);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    void consume(const CoreStateStore &store) override;
+
+private:
+    int fileDescriptor;
+    char *mapping;
+    size_t mappingSize;
+    HistoryFileHeader *header;
+    // Ticks before it are skipped.
+    qint64 nextTimestamp;
+    QString error;
+
+    void updateGovernorNames();
+};
+
+#endif // HISTORYRECORDER_H
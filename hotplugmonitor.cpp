@@ -0,0 +1,87 @@
+#include "hotplugmonitor.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+namespace
+{
+const char cpuDevicePath[] = "/devices/system/cpu/cpu";
+// Kernel uevents are a few hundred bytes.
+const int messageSize = 4096;
+// Multicast group of uevents sent by the kernel itself (udev uses group 2).
+const unsigned kernelEventsGroup = 1;
+}
+
+HotplugMonitor::HotplugMonitor()
+{
+    this->socketDescriptor = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if(this->socketDescriptor < 0)
+        return;
+    sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kernelEventsGroup;
+    if(bind(this->socketDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(this->socketDescriptor);
+        this->socketDescriptor = -1;
+    }
+}
+
+HotplugMonitor::~HotplugMonitor()
+{
+    if(this->socketDescriptor >= 0)
+        ::close(this->socketDescriptor);
+}
+
+bool HotplugMonitor::isOpen() const
+{
+    return this->socketDescriptor >= 0;
+}
+
+int HotplugMonitor::descriptor() const
+{
+    return this->socketDescriptor;
+}
+
+bool HotplugMonitor::next(int &coreNumber)
+{
+    if(this->socketDescriptor < 0)
+        return false;
+    char message[messageSize];
+    for(;;)
+    {
+        ssize_t length = recv(this->socketDescriptor, message, sizeof(message) - 1, 0);
+        if(length < 0)
+        {
+            // ENOBUFS means events were lost, report core -1 so the caller refreshes everything.
+            if(errno == ENOBUFS)
+            {
+                coreNumber = -1;
+                return true;
+            }
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        message[length] = '\0';
+        // Message starts with "action@devpath", key=value pairs follow.
+        const char *path = strchr(message, '@');
+        if(path == nullptr || strncmp(path + 1, cpuDevicePath, sizeof(cpuDevicePath) - 1) != 0)
+            continue;
+        const char *number = path + sizeof(cpuDevicePath);
+        if(*number < '0' || *number > '9')
+            continue;
+        int value = 0;
+        for(; *number >= '0' && *number <= '9'; number++)
+            value = value*10 + (*number - '0');
+        // Skip events of child devices like cpu3/cache.
+        if(*number != '\0')
+            continue;
+        coreNumber = value;
+        return true;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef HOTPLUGMONITOR_H
+#define HOTPLUGMONITOR_H
+
+// Kernel uevents of CPU devices from a NETLINK_KOBJECT_UEVENT socket.
+// The socket is non-blocking, the owner waits on descriptor() and drains it with next().
+class HotplugMonitor
+{
+public:
+    HotplugMonitor();
+    ~HotplugMonitor();
+    HotplugMonitor(const HotplugMonitor &) = delete;
+    HotplugMonitor &operator=(const HotplugMonitor &) = delete;
+
+    bool isOpen() const;
+    int descriptor() const;
+
+    // Core number of the next CPU uevent (online, offline, add, remove),
+    //false when no more messages are queued. Other devices are skipped.
+    bool next(int &coreNumber);
+
+private:
+    int socketDescriptor;
+};
+
+#endif // HOTPLUGMONITOR_H
@@ -0,0 +1,197 @@
+#include "idlestates.h"
+
+#include <algorithm>
+#include <QFile>
+
+#include "trace.h"
+
+const int IdleStates::maxStates;
+
+namespace
+{
+const qint64 NSEC_PER_USEC = 1000;
+
+// usage and time outgrow 32 bits, time is in microseconds.
+bool readNumber(const SysfsAttribute &file, unsigned long long &value)
+{
+    char buffer[SysfsAttribute::bufferSize];
+    const ssize_t length = file.isOpen() ? file.read(buffer, sizeof(buffer)) : -1;
+    value = 0;
+    ssize_t position = 0;
+    while(position < length && buffer[position] >= '0' && buffer[position] <= '9')
+        value = value*10 + unsigned(buffer[position++] - '0');
+    return position > 0;
+}
+
+QString readText(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return QString();
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+QString statePath(const LogicCore &logicCore, int state, const char *attribute)
+{
+    return logicCore.corePath("/cpuidle/state") + QString::number(state) + "/" + attribute;
+}
+}
+
+IdleStates::IdleStates(const QVector<LogicCore*> &logicCores, qint64 timestamp):
+    logicCores(logicCores),
+    cores(size_t(logicCores.size())),
+    stride(0)
+{
+    const Core *listed = nullptr;
+    for(int i = 0; i < logicCores.size(); i++)
+    {
+        Core &core = this->cores[size_t(i)];
+        for(int state = 0; state < maxStates; state++)
+        {
+            const QString name = readText(statePath(*logicCores[i], state, "name"));
+            if(name.isEmpty())
+                break;
+            core.names.push_back(name);
+            core.latencies.push_back(readText(statePath(*logicCores[i], state, "latency")).toUInt());
+        }
+        if(listed == nullptr && !core.names.isEmpty())
+            listed = &core;
+        this->stride = qMax(this->stride, core.names.size());
+    }
+    for(Core &core: this->cores)
+    {
+        if(core.names.isEmpty() && listed != nullptr)
+        {
+            core.names = listed->names;
+            core.latencies = listed->latencies;
+        }
+    }
+    this->residencies.assign(size_t(logicCores.size()*this->stride), -1);
+    this->wakeups.assign(size_t(logicCores.size()), 0);
+    this->disabled.assign(size_t(logicCores.size()), 0);
+    this->unknown.resize(size_t(logicCores.size()));
+    for(int i = 0; i < logicCores.size(); i++)
+    {
+        const int statesTotal = this->cores[size_t(i)].names.size();
+        this->unknown[size_t(i)] = statesTotal < maxStates ? (quint32(1) << statesTotal) - 1 : ~quint32(0);
+        openStates(i);
+        // Disable masks are known before the first tick, so the first published store shows them.
+        readCore(i, timestamp);
+    }
+}
+
+void IdleStates::openStates(int coreNumber)
+{
+    Core &core = this->cores[size_t(coreNumber)];
+    const LogicCore &logicCore = *this->logicCores[coreNumber];
+    core.states.clear();
+    core.states.resize(size_t(core.names.size()));
+    for(int state = 0; state < core.names.size(); state++)
+    {
+        State &entry = core.states[size_t(state)];
+        entry.usageFile.open(statePath(logicCore, state, "usage"));
+        entry.timeFile.open(statePath(logicCore, state, "time"));
+        entry.disableFile.open(statePath(logicCore, state, "disable"));
+        entry.lastUsage = 0;
+        entry.lastTime = 0;
+    }
+    core.lastTimestamp = 0;
+}
+
+void IdleStates::readCore(int coreNumber, qint64 timestamp)
+{
+    Core &core = this->cores[size_t(coreNumber)];
+    float *residencies = this->residencies.data() + coreNumber*this->stride;
+    // An offline core's files fail to read, it has no baseline until it comes back.
+    const qint64 elapsed = timestamp - core.lastTimestamp;
+    const bool known = core.lastTimestamp != 0 && elapsed > 0;
+    bool complete = !core.states.empty();
+    quint32 wakeups = 0;
+    // Offline cores can't read disable files, the last read value is still what the kernel has.
+    quint32 disabled = this->disabled[size_t(coreNumber)];
+    quint32 unknown = this->unknown[size_t(coreNumber)];
+    for(size_t state = 0; state < core.states.size(); state++)
+    {
+        State &entry = core.states[state];
+        unsigned long long usage, time, disable;
+        const quint32 bit = quint32(1) << state;
+        if(readNumber(entry.disableFile, disable))
+        {
+            disabled = disable != 0 ? disabled | bit : disabled & ~bit;
+            unknown &= ~bit;
+        }
+        if(!readNumber(entry.usageFile, usage) || !readNumber(entry.timeFile, time))
+        {
+            residencies[state] = -1;
+            complete = false;
+            continue;
+        }
+        if(known && usage >= entry.lastUsage && time >= entry.lastTime)
+        {
+            residencies[state] = std::min(float(double((time - entry.lastTime)*NSEC_PER_USEC)*100/elapsed), 100.0f);
+            wakeups += quint32(usage - entry.lastUsage);
+        }
+        else
+            residencies[state] = -1;
+        entry.lastUsage = usage;
+        entry.lastTime = time;
+    }
+    std::fill(residencies + core.states.size(), residencies + this->stride, -1.0f);
+    this->wakeups[size_t(coreNumber)] = known ? wakeups : 0;
+    this->disabled[size_t(coreNumber)] = disabled;
+    this->unknown[size_t(coreNumber)] = unknown;
+    core.lastTimestamp = complete ? timestamp : 0;
+}
+
+int IdleStates::statesTotal() const
+{
+    return this->stride;
+}
+
+int IdleStates::coreStatesTotal(int coreNumber) const
+{
+    return this->cores[size_t(coreNumber)].names.size();
+}
+
+const QString &IdleStates::stateName(int coreNumber, int state) const
+{
+    return this->cores[size_t(coreNumber)].names[state];
+}
+
+uint IdleStates::stateLatency(int coreNumber, int state) const
+{
+    return this->cores[size_t(coreNumber)].latencies[state];
+}
+
+void IdleStates::update(const std::vector<int> &cores, qint64 timestamp)
+{
+    TRACE_SCOPE("IdleStates::update");
+    for(int core: cores)
+        readCore(core, timestamp);
+}
+
+void IdleStates::refresh(int coreNumber)
+{
+    // cpuidle directory of the core was removed and made again, old descriptors read nothing.
+    openStates(coreNumber);
+}
+
+const float *IdleStates::residencyData() const
+{
+    return this->residencies.data();
+}
+
+const quint32 *IdleStates::wakeupData() const
+{
+    return this->wakeups.data();
+}
+
+const quint32 *IdleStates::disabledData() const
+{
+    return this->disabled.data();
+}
+
+const quint32 *IdleStates::unknownData() const
+{
+    return this->unknown.data();
+}
@@ -0,0 +1,83 @@
+#ifndef IDLESTATES_H
+#define IDLESTATES_H
+
+#include <vector>
+#include <QString>
+#include <QVector>
+
+#include "logiccore.h"
+#include "sysfsattribute.h"
+
+// cpuidle states of every core (cpuN/cpuidle/stateM), listed once at start with their names and exit latencies.
+// usage, time and disable of every state stay open and are re-read with pread(), so a tick costs three reads
+//per state and nothing else. Deltas of usage and time since the core's previous update become the residency
+//of every state and the number of wakeups (entries into any state) of that interval.
+// A core without a cpuidle directory at start (offline) borrows the states of the first core that has one,
+//the driver registers the same states on every core of usual systems.
+class IdleStates
+{
+public:
+    // Disable masks of LogicCore::ApplySettings and CoreStateStore have one bit per state.
+    static const int maxStates = 32;
+
+    // Baseline is read here, timestamps are CLOCK_MONOTONIC nanoseconds.
+    IdleStates(const QVector<LogicCore*> &logicCores, qint64 timestamp);
+    IdleStates(const IdleStates &) = delete;
+    IdleStates &operator=(const IdleStates &) = delete;
+
+    // Names and latencies never change after construction, safe from any thread.
+    //statesTotal() is the most states of a core, the number of values per core in published stores.
+    int statesTotal() const;
+    int coreStatesTotal(int coreNumber) const;
+    const QString &stateName(int coreNumber, int state) const;
+    // Exit latency in microseconds.
+    uint stateLatency(int coreNumber, int state) const;
+
+    // Sampler thread.
+    void update(const std::vector<int> &cores, qint64 timestamp);
+    // Reopens the files of a core after hotplug, its next update only takes a baseline.
+    void refresh(int coreNumber);
+
+    // statesTotal() values per core: percents of the interval between the core's last two updates
+    //spent in every state, negative when unknown (first update, offline core, missing state).
+    const float *residencyData() const;
+    // Wakeups of every core in the same interval.
+    const quint32 *wakeupData() const;
+    // Bit N is set when stateN is disabled. An unreadable disable file keeps the bit it had.
+    const quint32 *disabledData() const;
+    // Bit N is set while stateN's disable file was never read.
+    const quint32 *unknownData() const;
+
+private:
+    struct State
+    {
+        SysfsAttribute usageFile;
+        SysfsAttribute timeFile;
+        SysfsAttribute disableFile;
+        unsigned long long lastUsage;
+        // Microseconds.
+        unsigned long long lastTime;
+    };
+
+    struct Core
+    {
+        QVector<QString> names;
+        QVector<uint> latencies;
+        std::vector<State> states;
+        // Previous update that read every state, 0 when there is no baseline.
+        qint64 lastTimestamp;
+    };
+
+    const QVector<LogicCore*> &logicCores;
+    std::vector<Core> cores;
+    int stride;
+    std::vector<float> residencies;
+    std::vector<quint32> wakeups;
+    std::vector<quint32> disabled;
+    std::vector<quint32> unknown;
+
+    void openStates(int coreNumber);
+    void readCore(int coreNumber, qint64 timestamp);
+};
+
+#endif // IDLESTATES_H
@@ -0,0 +1,325 @@
+#include "iouringsampler.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+namespace
+{
+// Larger batches are split into several submissions.
+const unsigned maxRingEntries = 4096;
+}
+
+IoUringSampler::IoUringSampler(const QVector<LogicCore*> &logicCores):
+    logicCores(logicCores),
+    available(false),
+    ringDescriptor(-1),
+    submissionRing(nullptr),
+    submissionRingSize(0),
+    completionRing(nullptr),
+    completionRingSize(0),
+    submissionEntries(nullptr),
+    submissionEntriesSize(0),
+    submissionTail(nullptr),
+    submissionMask(nullptr),
+    completionHead(nullptr),
+    completionTail(nullptr),
+    completionMask(nullptr),
+    completionEntries(nullptr),
+    ringEntries(0),
+    fixedFiles(false)
+{
+    const size_t slotsTotal = size_t(logicCores.size())*LogicCore::SampledAttributeCount;
+    this->buffers.resize(slotsTotal*SysfsAttribute::bufferSize);
+    collectRequests();
+    this->available = !this->requestDescriptors.empty() && setupRing();
+}
+
+void IoUringSampler::collectRequests()
+{
+    const size_t slotsTotal = size_t(this->logicCores.size())*LogicCore::SampledAttributeCount;
+    // Slots of closed files keep length 0, which LogicCore::update() ignores.
+    this->lengths.assign(slotsTotal, 0);
+    this->slotRequests.assign(slotsTotal, -1);
+    this->dueAttributes.assign(size_t(this->logicCores.size()), 0);
+    this->requestDescriptors.clear();
+    this->requestSlots.clear();
+    this->allRequests.clear();
+    for(int core = 0; core < this->logicCores.size(); core++)
+    {
+        for(int attribute = 0; attribute < LogicCore::SampledAttributeCount; attribute++)
+        {
+            int descriptor = this->logicCores[core]->sampledDescriptor(LogicCore::SampledAttribute(attribute));
+            if(descriptor < 0)
+                continue;
+            const uint slot = uint(core*LogicCore::SampledAttributeCount + attribute);
+            this->slotRequests[slot] = int(this->requestDescriptors.size());
+            this->allRequests.push_back(uint(this->requestDescriptors.size()));
+            this->requestDescriptors.push_back(descriptor);
+            this->requestSlots.push_back(slot);
+        }
+    }
+}
+
+void IoUringSampler::rebuild()
+{
+    // Registered file table holds the old descriptors, a new ring is the simplest way to replace it.
+    destroyRing();
+    collectRequests();
+    this->available = !this->requestDescriptors.empty() && setupRing();
+}
+
+IoUringSampler::~IoUringSampler()
+{
+    destroyRing();
+}
+
+bool IoUringSampler::isAvailable() const
+{
+    return this->available;
+}
+
+#ifdef HAVE_IO_URING
+
+bool IoUringSampler::setupRing()
+{
+    unsigned entries = 1;
+    while(entries < this->requestDescriptors.size() && entries < maxRingEntries)
+        entries <<= 1;
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    this->ringDescriptor = int(syscall(__NR_io_uring_setup, entries, &params));
+    if(this->ringDescriptor < 0)
+        return false;
+
+    this->submissionRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+    this->completionRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMap)
+    {
+        if(this->completionRingSize > this->submissionRingSize)
+            this->submissionRingSize = this->completionRingSize;
+        this->completionRingSize = 0;
+    }
+    this->submissionRing = mmap(nullptr, this->submissionRingSize, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, this->ringDescriptor, IORING_OFF_SQ_RING);
+    if(this->submissionRing == MAP_FAILED)
+    {
+        this->submissionRing = nullptr;
+        destroyRing();
+        return false;
+    }
+    if(singleMap)
+        this->completionRing = this->submissionRing;
+    else
+    {
+        this->completionRing = mmap(nullptr, this->completionRingSize, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, this->ringDescriptor, IORING_OFF_CQ_RING);
+        if(this->completionRing == MAP_FAILED)
+        {
+            this->completionRing = nullptr;
+            destroyRing();
+            return false;
+        }
+    }
+    this->submissionEntriesSize = params.sq_entries*sizeof(io_uring_sqe);
+    void *entriesMap = mmap(nullptr, this->submissionEntriesSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, this->ringDescriptor, IORING_OFF_SQES);
+    if(entriesMap == MAP_FAILED)
+    {
+        destroyRing();
+        return false;
+    }
+    this->submissionEntries = static_cast<io_uring_sqe*>(entriesMap);
+
+    char *submission = static_cast<char*>(this->submissionRing);
+    char *completion = static_cast<char*>(this->completionRing);
+    this->submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+    this->submissionMask = reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+    this->completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+    this->completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+    this->completionMask = reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+    this->completionEntries = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+    this->ringEntries = params.sq_entries;
+
+    // Entries are always filled in ring order, so the index array is an identity map.
+    unsigned *submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+    for(unsigned i = 0; i < params.sq_entries; i++)
+        submissionArray[i] = i;
+
+    // Registered files save an fget/fput per read; plain descriptors work too.
+    this->fixedFiles = syscall(__NR_io_uring_register, this->ringDescriptor, IORING_REGISTER_FILES,
+                               this->requestDescriptors.data(), unsigned(this->requestDescriptors.size())) == 0;
+    return true;
+}
+
+void IoUringSampler::destroyRing()
+{
+    if(this->submissionEntries != nullptr)
+        munmap(this->submissionEntries, this->submissionEntriesSize);
+    if(this->completionRing != nullptr && this->completionRing != this->submissionRing)
+        munmap(this->completionRing, this->completionRingSize);
+    if(this->submissionRing != nullptr)
+        munmap(this->submissionRing, this->submissionRingSize);
+    if(this->ringDescriptor >= 0)
+        ::close(this->ringDescriptor);
+    this->submissionEntries = nullptr;
+    this->completionRing = nullptr;
+    this->submissionRing = nullptr;
+    this->ringDescriptor = -1;
+}
+
+bool IoUringSampler::submitAndWait(const uint *requests, size_t count)
+{
+    unsigned tail = *this->submissionTail;
+    const unsigned mask = *this->submissionMask;
+    for(size_t i = 0; i < count; i++, tail++)
+    {
+        const uint request = requests[i];
+        io_uring_sqe *entry = &this->submissionEntries[tail & mask];
+        memset(entry, 0, sizeof(*entry));
+        entry->opcode = IORING_OP_READ;
+        if(this->fixedFiles)
+        {
+            entry->fd = int(request);
+            entry->flags = IOSQE_FIXED_FILE;
+        }
+        else
+            entry->fd = this->requestDescriptors[request];
+        entry->off = 0;
+        entry->addr = reinterpret_cast<unsigned long long>(&this->buffers[this->requestSlots[request]*SysfsAttribute::bufferSize]);
+        entry->len = SysfsAttribute::bufferSize;
+        entry->user_data = request;
+    }
+    __atomic_store_n(this->submissionTail, tail, __ATOMIC_RELEASE);
+
+    unsigned toSubmit = unsigned(count);
+    size_t received = 0;
+    unsigned head = *this->completionHead;
+    while(received < count)
+    {
+        if(head == __atomic_load_n(this->completionTail, __ATOMIC_ACQUIRE))
+        {
+            long result = syscall(__NR_io_uring_enter, this->ringDescriptor, toSubmit,
+                                  unsigned(count - received), IORING_ENTER_GETEVENTS, nullptr, 0);
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            if(unsigned(result) != toSubmit)
+                return false;
+            toSubmit = 0;
+            continue;
+        }
+        const io_uring_cqe &completion = this->completionEntries[head & *this->completionMask];
+        // Kernel without IORING_OP_READ, use the synchronous path from now on.
+        if(completion.res == -EINVAL || completion.res == -EOPNOTSUPP)
+            return false;
+        const size_t request = size_t(completion.user_data);
+        this->lengths[this->requestSlots[request]] = completion.res < 0 ? -1 : completion.res;
+        head++;
+        received++;
+        __atomic_store_n(this->completionHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+#else
+
+bool IoUringSampler::setupRing()
+{
+    return false;
+}
+
+void IoUringSampler::destroyRing()
+{
+}
+
+bool IoUringSampler::submitAndWait(const uint *, size_t)
+{
+    return false;
+}
+
+#endif // HAVE_IO_URING
+
+bool IoUringSampler::submitAll(const std::vector<uint> &requests)
+{
+    for(size_t first = 0; first < requests.size(); first += this->ringEntries)
+    {
+        size_t count = requests.size() - first;
+        if(count > this->ringEntries)
+            count = this->ringEntries;
+        if(!submitAndWait(&requests[first], count))
+        {
+            destroyRing();
+            this->available = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+void IoUringSampler::parseCore(int core)
+{
+    typedef const char AttributeBuffer[SysfsAttribute::bufferSize];
+    const size_t coreStride = LogicCore::SampledAttributeCount;
+    AttributeBuffer *coreBuffers = reinterpret_cast<AttributeBuffer*>(&this->buffers[core*coreStride*SysfsAttribute::bufferSize]);
+    ssize_t *coreLengths = &this->lengths[core*coreStride];
+    this->logicCores[core]->update(coreBuffers, coreLengths);
+    // Content stays in the buffers, a slot that isn't due next time must not be parsed again.
+    for(size_t attribute = 0; attribute < coreStride; attribute++)
+        coreLengths[attribute] = 0;
+}
+
+void IoUringSampler::update()
+{
+    TRACE_SCOPE("IoUringSampler::update");
+    if(this->available && submitAll(this->allRequests))
+    {
+        for(int core = 0; core < this->logicCores.size(); core++)
+            parseCore(core);
+        return;
+    }
+    for(auto *logicCore: this->logicCores)
+        logicCore->update();
+}
+
+void IoUringSampler::update(const std::vector<uint> &readSlots, const std::vector<int> &cores)
+{
+    TRACE_SCOPE("IoUringSampler::update");
+    if(this->available)
+    {
+        this->dueRequests.clear();
+        for(uint slot: readSlots)
+        {
+            const int request = this->slotRequests[slot];
+            if(request >= 0)
+                this->dueRequests.push_back(uint(request));
+        }
+        if(submitAll(this->dueRequests))
+        {
+            for(int core: cores)
+                parseCore(core);
+            return;
+        }
+    }
+    const uint coreStride = LogicCore::SampledAttributeCount;
+    for(uint slot: readSlots)
+        this->dueAttributes[slot/coreStride] |= 1u << (slot%coreStride);
+    for(int core: cores)
+    {
+        this->logicCores[core]->update(this->dueAttributes[size_t(core)]);
+        this->dueAttributes[size_t(core)] = 0;
+    }
+}
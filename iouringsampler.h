@@ -0,0 +1,74 @@
+#ifndef IOURINGSAMPLER_H
+#define IOURINGSAMPLER_H
+
+#include <vector>
+#include <QVector>
+
+#include "logiccore.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Reads sampled attributes of all cores, or of the slots due in this tick, with one io_uring submission.
+// When io_uring is not available (old kernel, seccomp, built without HAVE_IO_URING)
+//it falls back to LogicCore::update() of every core.
+class IoUringSampler
+{
+private:
+    const QVector<LogicCore*> &logicCores;
+    bool available;
+
+    int ringDescriptor;
+    void *submissionRing;
+    size_t submissionRingSize;
+    void *completionRing;
+    size_t completionRingSize;
+    io_uring_sqe *submissionEntries;
+    size_t submissionEntriesSize;
+
+    unsigned *submissionTail;
+    unsigned *submissionMask;
+    unsigned *completionHead;
+    unsigned *completionTail;
+    unsigned *completionMask;
+    io_uring_cqe *completionEntries;
+    unsigned ringEntries;
+    bool fixedFiles;
+
+    // One request per existing attribute file.
+    std::vector<int> requestDescriptors;
+    std::vector<uint> requestSlots;
+    // Request of every slot, -1 when its file is closed.
+    std::vector<int> slotRequests;
+    // Requests submitted by update(): all of them, or the due ones.
+    std::vector<uint> allRequests;
+    std::vector<uint> dueRequests;
+    // Attribute bits per core for the synchronous fallback of a partial update.
+    std::vector<quint32> dueAttributes;
+    // Read results indexed by core*SampledAttributeCount + attribute.
+    std::vector<char> buffers;
+    std::vector<ssize_t> lengths;
+
+    void collectRequests();
+    bool setupRing();
+    void destroyRing();
+    bool submitAndWait(const uint *requests, size_t count);
+    bool submitAll(const std::vector<uint> &requests);
+    void parseCore(int core);
+
+public:
+    explicit IoUringSampler(const QVector<LogicCore*> &logicCores);
+    ~IoUringSampler();
+    IoUringSampler(const IoUringSampler &) = delete;
+    IoUringSampler &operator=(const IoUringSampler &) = delete;
+
+    bool isAvailable() const;
+    void update();
+    // Reads only `readSlots` (core*SampledAttributeCount + attribute), `cores` lists their distinct cores.
+    //Attributes that weren't read keep their previous values.
+    void update(const std::vector<uint> &readSlots, const std::vector<int> &cores);
+    // Picks up files opened or closed by LogicCore::refresh(), registers them again.
+    void rebuild();
+};
+
+#endif // IOURINGSAMPLER_H
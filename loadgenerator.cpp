@@ -0,0 +1,309 @@
+#include "loadgenerator.h"
+
+#include <cerrno>
+#include <sched.h>
+#include <time.h>
+
+#include "coresampler.h"
+
+namespace
+{
+const qint64 NSEC_PER_MSEC = 1000000;
+const qint64 NSEC_PER_SEC = 1000000000;
+
+// Operations per batch, a batch takes some microseconds so the clock is read rarely
+//and the period end is still met closely.
+const int integerBatch = 4096;
+const int memoryBatch = 1024;
+const int branchyBatch = 2048;
+// 16 MiB, beyond last level caches of desktop processors.
+const size_t memoryWords = 16*1024*1024/sizeof(quint64);
+const size_t cacheLineWords = 64/sizeof(quint64);
+
+void sleepUntil(qint64 deadline)
+{
+    timespec time;
+    time.tv_sec = time_t(deadline/NSEC_PER_SEC);
+    time.tv_nsec = long(deadline%NSEC_PER_SEC);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR)
+        ;
+}
+
+quint64 runInteger(quint64 &state)
+{
+    for(int i = 0; i < integerBatch; i++)
+    {
+        state = state*6364136223846793005ULL + 1442695040888963407ULL;
+        state ^= state >> 29;
+    }
+    return integerBatch;
+}
+
+quint64 runMemory(std::vector<quint64> &memory, size_t &position, quint64 &state)
+{
+    for(int i = 0; i < memoryBatch; i++)
+    {
+        state += memory[position];
+        memory[position] = state;
+        position += cacheLineWords;
+        if(position >= memory.size())
+            position = 0;
+    }
+    return memoryBatch;
+}
+
+quint64 runBranchy(quint64 &state)
+{
+    quint64 value = state;
+    for(int i = 0; i < branchyBatch; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if(state & 1)
+            value += state >> 7;
+        else
+            value -= state;
+        if((state >> 9) & 1)
+            value ^= value << 3;
+        if((state >> 17)%3 == 0)
+            value += 11;
+    }
+    state ^= value;
+    return branchyBatch;
+}
+}
+
+LoadGenerator::Settings LoadGenerator::defaultSettings()
+{
+    Settings settings;
+    settings.work = IntegerWork;
+    settings.dutyCycle = 100;
+    settings.period = 10;
+    settings.warmup = 500;
+    return settings;
+}
+
+const char *LoadGenerator::workTypeName(WorkType work)
+{
+    switch(work)
+    {
+    case IntegerWork:
+        return "integer";
+    case MemoryWork:
+        return "memory";
+    case BranchyWork:
+        return "branchy";
+    }
+    return "";
+}
+
+bool LoadGenerator::findWorkType(const QString &name, WorkType &work)
+{
+    for(WorkType type: {IntegerWork, MemoryWork, BranchyWork})
+    {
+        if(name == workTypeName(type))
+        {
+            work = type;
+            return true;
+        }
+    }
+    return false;
+}
+
+LoadGenerator::Worker::Worker(int core, const Settings &settings, qint64 countFrom):
+    operations(0),
+    stopping(false),
+    pinned(false),
+    checksum(0),
+    core(core),
+    work(settings.work),
+    period(qint64(settings.period)*NSEC_PER_MSEC),
+    busyTime(qint64(settings.period)*NSEC_PER_MSEC*settings.dutyCycle/100),
+    countFrom(countFrom)
+{
+}
+
+void LoadGenerator::Worker::run()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(this->core, &set);
+    this->pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+    // Touched after pinning, so pages come from the node of the core.
+    if(this->work == MemoryWork)
+        this->memory.assign(memoryWords, 1);
+
+    quint64 state = quint64(this->core) + 1;
+    size_t position = 0;
+    qint64 periodStart = CoreSampler::monotonicTime();
+    while(!this->stopping.load(std::memory_order_relaxed))
+    {
+        const qint64 busyEnd = periodStart + this->busyTime;
+        qint64 now;
+        do
+        {
+            quint64 done;
+            if(this->work == MemoryWork)
+                done = runMemory(this->memory, position, state);
+            else if(this->work == BranchyWork)
+                done = runBranchy(state);
+            else
+                done = runInteger(state);
+            now = CoreSampler::monotonicTime();
+            if(now >= this->countFrom)
+                this->operations.fetch_add(done, std::memory_order_relaxed);
+        }
+        while(now < busyEnd && !this->stopping.load(std::memory_order_relaxed));
+
+        if(this->busyTime >= this->period)
+        {
+            periodStart = now;
+            continue;
+        }
+        // Periods overrun by a preemption start again from now, not caught up.
+        periodStart += this->period;
+        if(periodStart < now)
+            periodStart = now;
+        else
+            sleepUntil(periodStart);
+    }
+    this->checksum = state;
+}
+
+LoadGenerator::LoadGenerator():
+    current(defaultSettings()),
+    countFrom(0),
+    countTo(0),
+    counting(false)
+{
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    stop();
+}
+
+bool LoadGenerator::start(const Settings &settings, const CoreStateStore &current)
+{
+    if(!this->workers.empty())
+    {
+        this->error = "Load generator is already running.";
+        return false;
+    }
+    if(settings.dutyCycle < 1 || settings.dutyCycle > 100 || settings.period < 1 || settings.warmup < 0)
+    {
+        this->error = "Load needs a duty cycle between 1 and 100 % and a positive period.";
+        return false;
+    }
+    QVector<int> cores;
+    const int coresTotal = qMin(current.size(), int(CPU_SETSIZE));
+    for(int i = 0; i < coresTotal; i++)
+    {
+        if(settings.cores.isEmpty() ? (i == 0 || current.online[i]) : settings.cores.contains(i))
+            cores.push_back(i);
+    }
+    for(int core: settings.cores)
+    {
+        if(core < 0 || core >= coresTotal || (core != 0 && !current.online[core]))
+        {
+            this->error = "Core " + QString::number(core) + " is not an online core.";
+            return false;
+        }
+    }
+    if(cores.isEmpty())
+    {
+        this->error = "No online core to load.";
+        return false;
+    }
+
+    this->current = settings;
+    this->coreResults.clear();
+    this->error.clear();
+    {
+        QMutexLocker locker(&this->frequencesMutex);
+        this->loadedCores = cores;
+        this->frequenceSums.assign(size_t(cores.size()), 0);
+        this->frequenceSamples.assign(size_t(cores.size()), 0);
+        this->countFrom = CoreSampler::monotonicTime() + qint64(settings.warmup)*NSEC_PER_MSEC;
+        this->countTo = this->countFrom;
+        this->counting = true;
+    }
+    for(int core: cores)
+    {
+        Worker *worker = new Worker(core, settings, this->countFrom);
+        this->workers.push_back(worker);
+        worker->start();
+    }
+    return true;
+}
+
+void LoadGenerator::stop()
+{
+    if(this->workers.empty())
+        return;
+    {
+        QMutexLocker locker(&this->frequencesMutex);
+        this->countTo = CoreSampler::monotonicTime();
+        this->counting = false;
+    }
+    for(Worker *worker: this->workers)
+        worker->stopping = true;
+    const qint64 duration = measuredDuration();
+    for(size_t i = 0; i < this->workers.size(); i++)
+    {
+        Worker *worker = this->workers[i];
+        worker->wait();
+        CoreResult result;
+        result.core = this->loadedCores[int(i)];
+        result.operations = worker->operations;
+        result.operationsPerSecond = duration > 0 ? double(result.operations)*NSEC_PER_SEC/duration : 0;
+        result.frequence = this->frequenceSamples[i] > 0 ? this->frequenceSums[i]/this->frequenceSamples[i] : 0;
+        if(!worker->pinned && this->error.isEmpty())
+            this->error = "Worker of core " + QString::number(result.core) + " couldn't be pinned.";
+        this->coreResults.push_back(result);
+        delete worker;
+    }
+    this->workers.clear();
+}
+
+bool LoadGenerator::isRunning() const
+{
+    return !this->workers.empty();
+}
+
+QString LoadGenerator::errorString() const
+{
+    return this->error;
+}
+
+const QVector<int> &LoadGenerator::cores() const
+{
+    return this->loadedCores;
+}
+
+const QVector<LoadGenerator::CoreResult> &LoadGenerator::results() const
+{
+    return this->coreResults;
+}
+
+qint64 LoadGenerator::measuredDuration() const
+{
+    return qMax(this->countTo - this->countFrom, qint64(0));
+}
+
+void LoadGenerator::consume(const CoreStateStore &store)
+{
+    QMutexLocker locker(&this->frequencesMutex);
+    if(!this->counting || store.timestamp < this->countFrom)
+        return;
+    for(int i = 0; i < this->loadedCores.size(); i++)
+    {
+        const int core = this->loadedCores[i];
+        if(core < store.currentFrequences.size())
+        {
+            this->frequenceSums[size_t(i)] += store.currentFrequences[core];
+            this->frequenceSamples[size_t(i)]++;
+        }
+    }
+}
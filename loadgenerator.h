@@ -0,0 +1,115 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <vector>
+
+#include "snapshotsink.h"
+
+// Synthetic load on worker threads pinned to chosen cores, for comparing governor and limit settings.
+// Every worker runs short batches of its work type and counts them, below a 100 % duty cycle it sleeps
+//the rest of every period. Frequences of the loaded cores are averaged from sampled snapshots,
+//add it as a sink and keep CurrentFrequenceAttribute of the cores subscribed while it runs.
+class LoadGenerator : public SnapshotSink
+{
+public:
+    enum WorkType
+    {
+        // Dependent multiply and shift chain, scales with core frequence.
+        IntegerWork,
+        // Read-modify-write of one cache line per operation over a buffer larger than caches.
+        MemoryWork,
+        // Unpredictable data dependent branches.
+        BranchyWork
+    };
+
+    struct Settings
+    {
+        // Empty means every online core.
+        QVector<int> cores;
+        WorkType work;
+        // Percents of every period spent working.
+        int dutyCycle;
+        // Milliseconds.
+        int period;
+        // Milliseconds after start() that aren't counted, governors ramp up meanwhile.
+        int warmup;
+    };
+    static Settings defaultSettings();
+    static const char *workTypeName(WorkType work);
+    // False for unknown names.
+    static bool findWorkType(const QString &name, WorkType &work);
+
+    struct CoreResult
+    {
+        int core;
+        quint64 operations;
+        double operationsPerSecond;
+        // Mean of sampled current frequences in kHz, 0 when none was sampled.
+        double frequence;
+    };
+
+    LoadGenerator();
+    ~LoadGenerator();
+    LoadGenerator(const LoadGenerator &) = delete;
+    LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+    // Starts one worker per core, returns false when settings are invalid (see errorString()).
+    bool start(const Settings &settings, const CoreStateStore &current);
+    // Stops the workers and computes results().
+    void stop();
+    bool isRunning() const;
+    QString errorString() const;
+    // Cores the workers were started on.
+    const QVector<int> &cores() const;
+    const QVector<CoreResult> &results() const;
+    // Counted time of the last run, nanoseconds.
+    qint64 measuredDuration() const;
+
+    // Sampler thread.
+    void consume(const CoreStateStore &store) override;
+
+private:
+    class Worker : public QThread
+    {
+    public:
+        Worker(int core, const Settings &settings, qint64 countFrom);
+        std::atomic<quint64> operations;
+        std::atomic<bool> stopping;
+        // False when the thread couldn't be pinned.
+        std::atomic<bool> pinned;
+        // Last work value, stored so the work can't be optimized away.
+        quint64 checksum;
+
+    protected:
+        void run() override;
+
+    private:
+        const int core;
+        const WorkType work;
+        const qint64 period;
+        const qint64 busyTime;
+        const qint64 countFrom;
+        std::vector<quint64> memory;
+    };
+
+    Settings current;
+    QVector<int> loadedCores;
+    std::vector<Worker*> workers;
+    qint64 countFrom;
+    qint64 countTo;
+    QVector<CoreResult> coreResults;
+    QString error;
+
+    // Written by consume() while workers count.
+    mutable QMutex frequencesMutex;
+    std::vector<double> frequenceSums;
+    std::vector<int> frequenceSamples;
+    bool counting;
+};
+
+#endif // LOADGENERATOR_H
@@ -1,129 +1,253 @@
 #include "logiccore.h"
 
-#include <QTextStream>
-
 #include <QFile>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "trace.h"
 
 const QString LogicCore::defaultPath = "/sys/devices/system/cpu/cpu";
 
-LogicCore::LogicCore(const uint &coreNumber):
-    coreNumber(coreNumber)
+LogicCore::LogicCore(const uint &coreNumber, const CoreTopology *topology):
+    coreNumber(coreNumber),
+    staticKnown(false),
+    availableGovernorMask(0),
+    isOnline(true),
+    currentCoreFrequence(0),
+    maxCoreFrequence(0),
+    minCoreFrequence(0),
+    maxScalingFrequence(0),
+    minScalingFrequence(0),
+    currentGovernor(GovernorTable::unknownGovernor),
+    policyLeaderNumber(coreNumber),
+    policySize(1),
+    packageId(-1),
+    physicalCoreId(-1),
+    policyLeader(nullptr)
 {
-    this->maxCoreFrequence = readMaxCoreFrequence();
-    this->minCoreFrequence = readMinCoreFrequence();
-    this->availableGovernors = readAvalibleGovernors();
+    // Core 0 has no online parameter, other cores may be hotplugged.
+    if(this->coreNumber != 0)
+        this->onlineFile.open(corePath("/online"));
+    this->isOnline = readIsOnline();
+    if(topology != nullptr)
+    {
+        // Governor modules may have been loaded since the cache was saved, the list is one short read.
+        CoreTopology cached = *topology;
+        if(this->isOnline)
+        {
+            const QStringList governors = readAvalibleGovernors();
+            if(!governors.isEmpty())
+                cached.availableGovernors = governors;
+        }
+        setTopology(cached);
+    }
+    else if(this->isOnline)
+        readStaticAttributes();
+    openSampledAttributes();
 
     update();
 }
 
-bool LogicCore::getOnline() const
+void LogicCore::setTopology(const CoreTopology &topology)
 {
-    return this->isOnline;
+    QMutexLocker locker(&this->topologyMutex);
+    this->minCoreFrequence = topology.minCoreFrequence;
+    this->maxCoreFrequence = topology.maxCoreFrequence;
+    this->availableGovernors = topology.availableGovernors;
+    this->policyLeaderNumber = topology.policyLeader;
+    this->policySize = topology.policySize;
+    this->packageId = topology.packageId;
+    this->physicalCoreId = topology.coreId;
+    this->threadSiblings = topology.threadSiblings;
+    quint32 mask = 0;
+    for(const QString &governor: this->availableGovernors)
+    {
+        quint8 id = GovernorTable::instance().intern(governor);
+        if(id != GovernorTable::unknownGovernor)
+            mask |= quint32(1) << id;
+    }
+    this->availableGovernorMask = mask;
+    this->staticKnown = topology.known;
 }
 
-uint LogicCore::readCurrentCoreFrequence() const
+CoreTopology LogicCore::topology() const
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_cur_freq");
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Scaling current frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    uint frequence = uint(fileStream.readAll().toInt(&success));
-    if(success != true)
-    {
-        QString errorMessage = "Cannot read scaling current core frequence on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
-    }
-    file.close();
-    return frequence;
+    QMutexLocker locker(&this->topologyMutex);
+    CoreTopology topology;
+    topology.known = this->staticKnown;
+    topology.minCoreFrequence = this->minCoreFrequence;
+    topology.maxCoreFrequence = this->maxCoreFrequence;
+    topology.availableGovernors = this->availableGovernors;
+    topology.policyLeader = this->policyLeaderNumber;
+    topology.policySize = this->policySize;
+    topology.packageId = this->packageId;
+    topology.coreId = this->physicalCoreId;
+    topology.threadSiblings = this->threadSiblings;
+    return topology;
 }
 
-uint LogicCore::readMaxCoreFrequence() const
+bool LogicCore::readAttribute(const char *attribute, uint &value) const
 {
-    QString path = LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/cpuinfo_max_freq";
-    QFile file(path);
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Max frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    uint frequence = uint(fileStream.readAll().toInt(&success));
-    if(success != true)
-    {
-        QString errorMessage = "Cannot read min core frequence on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
-    }
-    file.close();
-    return frequence;
+    TRACE_SCOPE("LogicCore::readAttribute");
+    SysfsAttribute file;
+    return file.open(corePath(attribute)) && file.readUInt(value);
 }
 
-uint LogicCore::readMinCoreFrequence() const
+void LogicCore::readStaticAttributes()
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/cpuinfo_min_freq");
+    TRACE_SCOPE("LogicCore::readStaticAttributes");
+    // cpufreq and topology directories of an offline core may be missing,
+    //the attributes are read again when the core comes online.
+    CoreTopology topology;
+    if(!readAttribute("/cpufreq/cpuinfo_min_freq", topology.minCoreFrequence)
+            || !readAttribute("/cpufreq/cpuinfo_max_freq", topology.maxCoreFrequence))
+        return;
+    topology.availableGovernors = readAvalibleGovernors();
+    uint value;
+    if(readAttribute("/topology/physical_package_id", value))
+        topology.packageId = int(value);
+    if(readAttribute("/topology/core_id", value))
+        topology.coreId = int(value);
+    QFile siblingsFile(corePath("/topology/thread_siblings_list"));
+    if(siblingsFile.open(QIODevice::ReadOnly))
+        topology.threadSiblings = QString::fromLatin1(siblingsFile.readAll()).trimmed();
+    topology.policyLeader = this->coreNumber;
+    topology.policySize = 1;
+    readRelatedCores(topology);
+    topology.known = true;
+    setTopology(topology);
+}
+
+void LogicCore::readRelatedCores(CoreTopology &topology) const
+{
+    TRACE_SCOPE("LogicCore::readRelatedCores");
+    // Space separated list of cores sharing the policy, missing on old kernels.
+    QFile file(corePath("/cpufreq/related_cpus"));
     if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Min core frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    uint frequence = uint(fileStream.readAll().toInt(&success));
-    if(success != true)
+        return;
+    // Empty parts fail toUInt() below and are skipped.
+    QStringList cores = QString::fromLatin1(file.readAll()).split(' ');
+    uint leader = this->coreNumber;
+    int size = 0;
+    for(const QString &core: cores)
     {
-        QString errorMessage = "Cannot read min core frequence on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
+        bool success = true;
+        uint number = core.trimmed().toUInt(&success);
+        if(!success)
+            continue;
+        size++;
+        if(number < leader)
+            leader = number;
     }
-    file.close();
-    return frequence;
+    if(size == 0)
+        return;
+    topology.policyLeader = leader;
+    topology.policySize = size;
 }
 
-uint LogicCore::readScalingMaxFrequence() const
+uint LogicCore::getPolicyLeaderNumber() const
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_max_freq");
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Scaling max frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    uint frequence = uint(fileStream.readAll().toInt(&success));
-    if(success != true)
+    return this->policyLeaderNumber;
+}
+
+int LogicCore::getPolicySize() const
+{
+    return this->policySize;
+}
+
+bool LogicCore::isPolicyLeader() const
+{
+    return this->policyLeader == nullptr;
+}
+
+uint LogicCore::getSamplingLeaderNumber() const
+{
+    const LogicCore *leader = this->policyLeader;
+    return leader != nullptr ? leader->coreNumber : this->coreNumber;
+}
+
+void LogicCore::setPolicyLeader(const LogicCore *leader)
+{
+    if(leader == this)
+        leader = nullptr;
+    const bool wasFollower = this->policyLeader != nullptr;
+    this->policyLeader = leader;
+    if(leader == nullptr)
     {
-        QString errorMessage = "Cannot read Scaling max frequence on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
+        // Former follower takes over from an offline leader, its values were never read.
+        if(wasFollower)
+        {
+            openSampledAttributes();
+            update(1u << ScalingMaxAttribute | 1u << ScalingMinAttribute | 1u << GovernorAttribute);
+        }
+        return;
     }
-    file.close();
-    return frequence;
+    // Leader reads these for the whole policy, IoUringSampler skips closed files.
+    this->scalingMaxFile.close();
+    this->scalingMinFile.close();
+    this->governorFile.close();
 }
 
-void LogicCore::setScalingMaxFrequence(const uint &value)
+QString LogicCore::corePath(const char *attribute) const
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_max_freq");
-    if(value > this->maxCoreFrequence)
-        throw std::logic_error("Cannot set scaling max frequence greater than max hardware frequence.");
-    if(value < this->minCoreFrequence)
-        throw std::logic_error("Cannot set scaling max frequence lesser than min hardware frequence.");
-    if(value <= this->readScalingMinFrequence())
-        throw std::logic_error("Cannot set scaling max frequence lesser than min scaling frequence.");
-    if(!file.open(QIODevice::WriteOnly))
-        throw std::logic_error("Scaling max frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    fileStream << value;
-    file.close();
+    return SysfsAttribute::rootPath() + LogicCore::defaultPath + QString::number(this->coreNumber) + attribute;
 }
 
-void LogicCore::setScalingMinFrequence(const uint &value)
+void LogicCore::openSampledAttributes()
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_min_freq");
-    if(value > this->maxCoreFrequence)
-        throw std::logic_error("Cannot set scaling min frequence greater than max hardware frequence.");
-    if(value < this->minCoreFrequence)
-        throw std::logic_error("Cannot set scaling min frequence lesser than min hardware frequence.");
-    if(value >= this->readScalingMaxFrequence())
-        throw std::logic_error("Cannot set scaling max frequence greater than max scaling frequence.");
-    if(!file.open(QIODevice::WriteOnly))
-        throw std::logic_error("Scaling min frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    fileStream << value;
-    file.close();
+    // Missing files are not an error, an offline core may have no cpufreq directory.
+    //Closed attributes are skipped by update() and IoUringSampler.
+    if(!this->currentFrequenceFile.isOpen())
+        this->currentFrequenceFile.open(corePath("/cpufreq/scaling_cur_freq"));
+    // Followers don't read policy attributes.
+    if(this->policyLeader != nullptr)
+        return;
+    if(!this->scalingMaxFile.isOpen())
+        this->scalingMaxFile.open(corePath("/cpufreq/scaling_max_freq"));
+    if(!this->scalingMinFile.isOpen())
+        this->scalingMinFile.open(corePath("/cpufreq/scaling_min_freq"));
+    if(!this->governorFile.isOpen())
+        this->governorFile.open(corePath("/cpufreq/scaling_governor"));
+}
+
+void LogicCore::refresh()
+{
+    TRACE_SCOPE("LogicCore::refresh");
+    this->isOnline = readIsOnline();
+    if(!this->isOnline)
+        return;
+    if(!this->staticKnown)
+        readStaticAttributes();
+    openSampledAttributes();
+}
+
+bool LogicCore::hasStaticAttributes() const
+{
+    return this->staticKnown;
+}
+
+int LogicCore::getPackageId() const
+{
+    return this->packageId;
+}
+
+int LogicCore::getPhysicalCoreId() const
+{
+    return this->physicalCoreId;
+}
+
+bool LogicCore::getOnline() const
+{
+    return this->isOnline;
 }
 
 uint LogicCore::getScalingMaxFrequence() const
 {
+    const LogicCore *leader = this->policyLeader;
+    if(leader != nullptr)
+        return leader->maxScalingFrequence;
     return this->maxScalingFrequence;
 }
 
@@ -144,67 +268,138 @@ uint LogicCore::getMinCoreFrequence() const
 
 QStringList LogicCore::getAvailableGovernors() const
 {
+    QMutexLocker locker(&this->topologyMutex);
     return this->availableGovernors;
 }
 
-uint LogicCore::readScalingMinFrequence() const
+quint32 LogicCore::getAvailableGovernorMask() const
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_min_freq");
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Scaling min frequence file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    uint frequence = uint(fileStream.readAll().toInt(&success));
-    if(success != true)
-    {
-        QString errorMessage = "Cannot read Scaling min frequence on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
-    }
-    file.close();
-    return frequence;
+    return this->availableGovernorMask;
 }
 
 uint LogicCore::getScalingMinFrequence() const
 {
+    const LogicCore *leader = this->policyLeader;
+    if(leader != nullptr)
+        return leader->minScalingFrequence;
     return this->minScalingFrequence;
 }
 
 QStringList LogicCore::readAvalibleGovernors() const
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_available_governors");
+    TRACE_SCOPE("LogicCore::readAvalibleGovernors");
+    QFile file(corePath("/cpufreq/scaling_available_governors"));
     if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Governor file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    QStringList governors = fileStream.readAll().split(" ");
-    for(auto& governor: governors)
+        return QStringList();
+    QStringList governors;
+    for(const QString &governor: QString::fromLatin1(file.readAll()).split(' '))
     {
-        governor = governor.trimmed();
+        QString name = governor.trimmed();
+        if(!name.isEmpty())
+            governors.push_back(name);
     }
-    if(success != true)
+    return governors;
+}
+
+void LogicCore::writeAttribute(const char *attribute, const char *value, size_t length) const
+{
+    if(!SysfsAttribute::writeFile(corePath(attribute), value, length))
     {
-        QString errorMessage = "Cannot read governor list on core " + QString::number(this->coreNumber);
+        QString errorMessage = QString("Cannot write ") + attribute + " on core " + QString::number(this->coreNumber)
+                + ": " + strerror(errno);
         throw std::logic_error(errorMessage.toUtf8().constData());
     }
-    file.close();
-    return governors;
 }
 
-void LogicCore::setGovernor(const QString &governorName)
+void LogicCore::writeAttribute(const char *attribute, uint value) const
 {
-    QStringList avalibleGovernors = this->readAvalibleGovernors();
-    if(!avalibleGovernors.contains(governorName))
-        return;
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_available_governors");
-    if(!file.open(QIODevice::WriteOnly))
-        throw std::logic_error("Governor file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    fileStream << governorName;
-    file.close();
+    char buffer[SysfsAttribute::bufferSize];
+    int length = snprintf(buffer, sizeof(buffer), "%u", value);
+    writeAttribute(attribute, buffer, size_t(length));
+}
+
+void LogicCore::apply(const ApplySettings &settings, const CoreStateStore &current, bool writePolicy) const
+{
+    TRACE_SCOPE("LogicCore::apply");
+    if(settings.minScalingFrequence > settings.maxScalingFrequence)
+        throw std::logic_error("Cannot set scaling min frequence greater than scaling max frequence.");
+    if(settings.minScalingFrequence < this->minCoreFrequence)
+        throw std::logic_error("Cannot set scaling min frequence lesser than min hardware frequence.");
+    if(settings.maxScalingFrequence > this->maxCoreFrequence)
+        throw std::logic_error("Cannot set scaling max frequence greater than max hardware frequence.");
+    if(settings.governor != GovernorTable::unknownGovernor && !(this->availableGovernorMask & (quint32(1) << settings.governor)))
+        throw std::logic_error("Governor is not available on this core.");
+
+    const int index = int(this->coreNumber);
+    // Core 0 has no online parameter.
+    const bool wasOnline = this->coreNumber == 0 || current.online[index] != 0;
+    const bool online = this->coreNumber == 0 || settings.online;
+    // cpufreq files of an offline core can't be written,
+    //so the core goes up before the other writes and down after them.
+    if(online && !wasOnline)
+        writeAttribute("/online", "1", 1);
+    if(writePolicy && (online || wasOnline))
+    {
+        // Switching a governor restarts it, don't do it when nothing changes.
+        if(settings.governor != GovernorTable::unknownGovernor && settings.governor != current.governors[index])
+        {
+            const char *name = GovernorTable::instance().latin1Name(settings.governor);
+            writeAttribute("/cpufreq/scaling_governor", name, strlen(name));
+        }
+        const uint currentMin = current.minScalingFrequences[index];
+        const uint currentMax = current.maxScalingFrequences[index];
+        // Older kernels reject min above the current max and max below the current min,
+        //so when the range moves up max goes first, otherwise min goes first.
+        const bool maxFirst = settings.minScalingFrequence > currentMax;
+        if(maxFirst && settings.maxScalingFrequence != currentMax)
+            writeAttribute("/cpufreq/scaling_max_freq", settings.maxScalingFrequence);
+        if(settings.minScalingFrequence != currentMin)
+            writeAttribute("/cpufreq/scaling_min_freq", settings.minScalingFrequence);
+        if(!maxFirst && settings.maxScalingFrequence != currentMax)
+            writeAttribute("/cpufreq/scaling_max_freq", settings.maxScalingFrequence);
+    }
+    // Idle states belong to the core, not to its policy. Stores without them get every masked state written,
+    //so do states whose disable was never read.
+    if(online && settings.idleStatesMask != 0)
+    {
+        const bool known = index < current.disabledIdleStates.size();
+        const quint32 changed = known ? ((current.disabledIdleStates[index] ^ settings.disabledIdleStates)
+                                         | current.unknownIdleStates[index]) & settings.idleStatesMask
+                                      : settings.idleStatesMask;
+        char attribute[SysfsAttribute::bufferSize];
+        for(int state = 0; state < 32; state++)
+        {
+            const quint32 bit = quint32(1) << state;
+            if(!(changed & bit))
+                continue;
+            snprintf(attribute, sizeof(attribute), "/cpuidle/state%d/disable", state);
+            writeAttribute(attribute, settings.disabledIdleStates & bit ? "1" : "0", 1);
+        }
+    }
+    if(!online && wasOnline)
+        writeAttribute("/online", "0", 1);
+}
+
+void LogicCore::setScalingSpeed(uint value) const
+{
+    TRACE_SCOPE("LogicCore::setScalingSpeed");
+    if(value > this->maxCoreFrequence)
+        throw std::logic_error("Cannot set scaling speed greater than max hardware frequence.");
+    if(value < this->minCoreFrequence)
+        throw std::logic_error("Cannot set scaling speed lesser than min hardware frequence.");
+    writeAttribute("/cpufreq/scaling_setspeed", value);
 }
 
 QString LogicCore::getGovernor() const
 {
+    return GovernorTable::instance().name(getGovernorId());
+}
+
+quint8 LogicCore::getGovernorId() const
+{
+    const LogicCore *leader = this->policyLeader;
+    if(leader != nullptr)
+        return leader->currentGovernor;
     return this->currentGovernor;
 }
 
@@ -213,63 +408,84 @@ uint LogicCore::getNumber() const
     return this->coreNumber;
 }
 
-QString LogicCore::readCurrentGovernor()
+void LogicCore::update()
 {
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/cpufreq/scaling_governor");
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Governor file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    QString governor = fileStream.readAll();
-    if(success != true)
+    update((1u << SampledAttributeCount) - 1);
+}
+
+void LogicCore::update(quint32 attributes)
+{
+    TRACE_SCOPE("LogicCore::update");
+    char buffers[SampledAttributeCount][SysfsAttribute::bufferSize];
+    ssize_t lengths[SampledAttributeCount];
+    for(int attribute = 0; attribute < SampledAttributeCount; attribute++)
     {
-        QString errorMessage = "Cannot read governor on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
+        const SysfsAttribute &file = sampledFile(SampledAttribute(attribute));
+        const bool wanted = attributes & (1u << attribute);
+        lengths[attribute] = wanted && file.isOpen() ? file.read(buffers[attribute], SysfsAttribute::bufferSize) : -1;
     }
-    file.close();
-    return governor.trimmed();
+    update(buffers, lengths);
 }
 
-void LogicCore::update()
+void LogicCore::update(const char buffers[][SysfsAttribute::bufferSize], const ssize_t lengths[])
 {
-    this->isOnline = readIsOnline();
-    this->currentCoreFrequence = readCurrentCoreFrequence();
+    TRACE_SCOPE("LogicCore::parse");
+    // Unreadable or closed attributes keep their previous values,
+    //one missing file must not fail the tick of every other core.
+    uint value;
+    if(SysfsAttribute::parseUInt(buffers[OnlineAttribute], lengths[OnlineAttribute], value))
+        this->isOnline = value != 0;
+    // cpufreq files of an offline core may be gone, they are reopened on the hotplug event.
+    if(!this->isOnline)
+        return;
+    if(SysfsAttribute::parseUInt(buffers[CurrentFrequenceAttribute], lengths[CurrentFrequenceAttribute], value))
+        this->currentCoreFrequence = value;
 
-    this->maxScalingFrequence = readScalingMaxFrequence();
-    this->minScalingFrequence = readScalingMinFrequence();
-    this->currentGovernor = readCurrentGovernor();
+    // Policy attributes of a follower are not read at all.
+    if(this->policyLeader != nullptr)
+        return;
+    if(SysfsAttribute::parseUInt(buffers[ScalingMaxAttribute], lengths[ScalingMaxAttribute], value))
+        this->maxScalingFrequence = value;
+    if(SysfsAttribute::parseUInt(buffers[ScalingMinAttribute], lengths[ScalingMinAttribute], value))
+        this->minScalingFrequence = value;
+    ssize_t governorLength = SysfsAttribute::trimmedLength(buffers[GovernorAttribute], lengths[GovernorAttribute]);
+    // Governor is kept as an interned id, so no string is built on every tick.
+    if(governorLength > 0)
+        this->currentGovernor = GovernorTable::instance().intern(buffers[GovernorAttribute], governorLength);
 }
 
-bool LogicCore::readIsOnline() const
+const SysfsAttribute &LogicCore::sampledFile(SampledAttribute attribute) const
 {
-    // Core 0 has no online parameter,
-    //so core is always online.
-    if(this->coreNumber == 0)
-        return true;
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/online");
-    if(!file.open(QIODevice::ReadOnly))
-        throw std::logic_error("Online file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    bool success = true;
-    bool isOnline = fileStream.readAll().toInt(&success);
-    if(success != true)
+    switch(attribute)
     {
-        QString errorMessage = "Cannot read online parameter on core " + QString::number(this->coreNumber);
-        throw std::logic_error(errorMessage.toUtf8().constData());
+    case OnlineAttribute:
+        return this->onlineFile;
+    case CurrentFrequenceAttribute:
+        return this->currentFrequenceFile;
+    case ScalingMaxAttribute:
+        return this->scalingMaxFile;
+    case ScalingMinAttribute:
+        return this->scalingMinFile;
+    default:
+        return this->governorFile;
     }
-    file.close();
-    return isOnline;
 }
 
-void LogicCore::setOnline(bool value)
+int LogicCore::sampledDescriptor(SampledAttribute attribute) const
 {
-    // Core 0 has no online parameter
-    if(this->coreNumber == 0)
-        return;
-    QFile file(LogicCore::defaultPath + QString::number(this->coreNumber) + "/online");
-    if(!file.open(QIODevice::WriteOnly))
-        throw std::logic_error("Online file is not existing or permission error.");
-    QTextStream fileStream(&file);
-    fileStream << value;
-    file.close();
+    if(attribute < 0 || attribute >= SampledAttributeCount)
+        return -1;
+    return sampledFile(attribute).descriptor();
 }
+
+bool LogicCore::readIsOnline() const
+{
+    TRACE_SCOPE("LogicCore::readIsOnline");
+    // Core 0 and cores that can't be hotplugged have no online parameter,
+    //so core is always online.
+    uint isOnline;
+    if(!this->onlineFile.isOpen() || !this->onlineFile.readUInt(isOnline))
+        return true;
+    return isOnline != 0;
+}
+
@@ -1,59 +1,160 @@
 #ifndef LOGICCORE_H
 #define LOGICCORE_H
 
+#include <atomic>
 #include <vector>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 
+#include "sysfsattribute.h"
+#include "governortable.h"
+#include "corestatestore.h"
+#include "topologycache.h"
+
 class LogicCore
 {
+public:
+    // Attributes read on every update().
+    enum SampledAttribute
+    {
+        OnlineAttribute,
+        CurrentFrequenceAttribute,
+        ScalingMaxAttribute,
+        ScalingMinAttribute,
+        GovernorAttribute,
+        SampledAttributeCount
+    };
+
+    // Target state for apply(), frequences are in kHz.
+    struct ApplySettings
+    {
+        bool online;
+        uint minScalingFrequence;
+        uint maxScalingFrequence;
+        // GovernorTable id, unknownGovernor keeps the current one.
+        quint8 governor;
+        // Bit N disables cpuidle stateN, only states with their idleStatesMask bit set are written.
+        quint32 idleStatesMask;
+        quint32 disabledIdleStates;
+    };
+
 private:
     static const QString defaultPath;
     const uint coreNumber;
+    // Static attributes of a core offline since start are filled in by refresh() on the sampler thread
+    //while other threads validate against them, so scalars are atomic and lists are guarded by topologyMutex.
+    // Static attributes were read from sysfs or topology cache.
+    std::atomic<bool> staticKnown;
 
     QStringList availableGovernors;
-    bool isOnline;
+    // Same list as GovernorTable id bits.
+    std::atomic<quint32> availableGovernorMask;
+    std::atomic<bool> isOnline;
+    // Sampled values are written and read on the sampler thread only, others read published stores.
     uint currentCoreFrequence;
-    uint maxCoreFrequence;
-    uint minCoreFrequence;
+    std::atomic<uint> maxCoreFrequence;
+    std::atomic<uint> minCoreFrequence;
     uint maxScalingFrequence;
     uint minScalingFrequence;
-    QString currentGovernor;
+    quint8 currentGovernor;
+
+    // Lowest core of the cpufreq policy (related_cpus) and number of cores in it.
+    std::atomic<uint> policyLeaderNumber;
+    std::atomic<int> policySize;
+    std::atomic<int> packageId;
+    std::atomic<int> physicalCoreId;
+    QString threadSiblings;
+    mutable QMutex topologyMutex;
+    // Core that samples scaling limits and governor for the whole policy, nullptr when it's this one.
+    //It's the lowest online core of the policy, the lowest core's files may be gone while it's offline.
+    std::atomic<const LogicCore*> policyLeader;
+
+    // Attributes read on every update() are kept open between ticks.
+    SysfsAttribute onlineFile;
+    SysfsAttribute currentFrequenceFile;
+    SysfsAttribute scalingMaxFile;
+    SysfsAttribute scalingMinFile;
+    SysfsAttribute governorFile;
+    void openSampledAttributes();
+    const SysfsAttribute &sampledFile(SampledAttribute attribute) const;
+    bool readAttribute(const char *attribute, uint &value) const;
+    void readStaticAttributes();
+    void setTopology(const CoreTopology &topology);
+    void writeAttribute(const char *attribute, const char *value, size_t length) const;
+    void writeAttribute(const char *attribute, uint value) const;
 
-    QString readCurrentGovernor();
     QStringList readAvalibleGovernors() const;
-    uint readScalingMinFrequence() const;
-    uint readScalingMaxFrequence() const;
-    uint readCurrentCoreFrequence() const;
-    uint readMaxCoreFrequence() const;
-    uint readMinCoreFrequence() const;
+    void readRelatedCores(CoreTopology &topology) const;
     bool readIsOnline() const;
 
 public:
-    LogicCore(const uint &coreNumber);
+    // Static attributes are taken from `topology` when it's given, otherwise read from sysfs.
+    //Available governors of an online core are read from sysfs either way.
+    //Missing files of an offline core are not an error, see refresh().
+    LogicCore(const uint &coreNumber, const CoreTopology *topology = nullptr);
+    LogicCore(const LogicCore &) = delete;
+    LogicCore &operator=(const LogicCore &) = delete;
 
+    // Sampled state, changed only through apply().
     bool getOnline() const;
-    void setOnline(bool value);
-
-    void setScalingMaxFrequence(const uint &value);
     uint getScalingMaxFrequence() const;
+    uint getScalingMinFrequence() const;
 
     uint getCurrentCoreFrequence() const;
     uint getMaxCoreFrequence() const;
     uint getMinCoreFrequence() const;
     QStringList getAvailableGovernors() const;
+    quint32 getAvailableGovernorMask() const;
 
-    void setScalingMinFrequence(const uint &value);
-    uint getScalingMinFrequence() const;
-
-    void setGovernor(const QString &governorName);
     QString getGovernor() const;
+    quint8 getGovernorId() const;
 
-    void setCurrentGovernor(const QString &governorName);
+    // Frequence of the userspace governor (scaling_setspeed) in kHz, within hardware limits.
+    //Safe from any thread like apply(). Throws std::logic_error on failure.
+    void setScalingSpeed(uint value) const;
 
     uint getNumber() const;
+    // Path of an attribute below the core's sysfs directory, e.g. "/cpufreq/stats/total_trans".
+    QString corePath(const char *attribute) const;
+
+    // False when the core was offline since start and nothing was cached for it.
+    bool hasStaticAttributes() const;
+    CoreTopology topology() const;
+    int getPackageId() const;
+    int getPhysicalCoreId() const;
+    // Called on the sampler thread after a hotplug event of this core,
+    //re-reads online state, missing static attributes and reopens sampled files.
+    void refresh();
+
+    // Cores of one cpufreq policy share scaling limits and governor.
+    //The policy is named by its lowest core, whether it's online or not.
+    uint getPolicyLeaderNumber() const;
+    int getPolicySize() const;
+    // True when this core reads policy attributes itself.
+    bool isPolicyLeader() const;
+    // Core that reads policy attributes of this one, this core's number when it's the leader.
+    uint getSamplingLeaderNumber() const;
+    // Called on the sampler thread when the lowest online core of the policy changes. A follower
+    //doesn't read policy attributes anymore and getters return leader's values, a new leader reads them at once.
+    void setPolicyLeader(const LogicCore *leader);
+
+    // Writes only attributes that differ from `current`, the last sampled state of this core.
+    //Validation uses cached hardware limits and governors, nothing is read back from sysfs.
+    //Safe to call for different cores from different threads. Throws std::logic_error on failure.
+    //Policy attributes (scaling limits, governor) are skipped when writePolicy is false,
+    //bulk operations write them through one core of every policy.
+    void apply(const ApplySettings &settings, const CoreStateStore &current, bool writePolicy = true) const;
+
+    // Descriptor of a sampled attribute, -1 if the core has no such file.
+    int sampledDescriptor(SampledAttribute attribute) const;
 
     void update();
+    // Reads only attributes with their bit (1 << SampledAttribute) set, others keep previous values.
+    void update(quint32 attributes);
+    // Same as update(), but attribute contents were already read by the caller.
+    //Lengths are read() results, buffers are indexed by SampledAttribute.
+    void update(const char buffers[][SysfsAttribute::bufferSize], const ssize_t lengths[]);
 };
 
 #endif // LOGICCORE_H
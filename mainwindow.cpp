@@ -1,27 +1,150 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include <unistd.h> // sysconf, getuid for checking for root
+#include <cmath>
+#include <ctime>
 #include <QLabel>
-#include <QProgressBar>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QFile>
+#include <QLineEdit>
+#include <QTableWidgetItem>
 #include <QDebug>
 
+#include "trace.h"
+
+namespace
+{
+// Milliseconds between samples of frequence history, recordings and slow attributes.
+const int samplingInterval = 1000;
+// Current frequence of the core shown in the Detailed tab.
+const int currentFrequenceInterval = 50;
+// Governor rarely changes.
+const int governorInterval = 5000;
+// Scaling state of all cores while a saved profile waits for it.
+const int saveInterval = 50;
+// Busiest tasks listed for the core shown in the Detailed tab.
+const int tasksShown = 10;
+// Replay timer period in milliseconds.
+const int replayRefreshInterval = 15;
+
+struct ChartSpan
+{
+    const char *name;
+    int seconds;
+};
+const ChartSpan chartSpans[] =
+{
+    {"1 minute", 60},
+    {"10 minutes", 600},
+    {"1 hour", 3600},
+    {"6 hours", 6*3600},
+    {"24 hours", 24*3600}
+};
+// Seconds 0 means since start.
+const ChartSpan residencyWindows[] =
+{
+    {"last 10 seconds", 10},
+    {"last minute", 60},
+    {"since start", 0}
+};
+
+// CPU time of the whole process in nanoseconds, sampler and exporter threads included.
+qint64 processCpuTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return qint64(now.tv_sec)*1000000000 + now.tv_nsec;
+}
+
+// Busy cycles of all online cores per second in MHz, negative when loads are unknown.
+double busyFrequence(const CoreStateStore &store)
+{
+    double busy = 0;
+    bool known = false;
+    for(int i = 0; i < store.size(); i++)
+    {
+        if(!store.online[i] || store.loads[i] < 0)
+            continue;
+        busy += double(store.currentFrequences[i])/1000*double(store.loads[i])/100;
+        known = true;
+    }
+    return known ? busy : -1;
+}
+
+// Sum of package domains, psys only when there are none as it already contains them. Negative when unknown.
+double packagePower(const CoreStateStore &store, const PowerSensors &sensors)
+{
+    double packages = 0, platform = -1;
+    bool packagesKnown = false;
+    for(int i = 0; i < store.powers.size() && i < sensors.domainsTotal(); i++)
+    {
+        if(!sensors.isTopDomain(i) || store.powers[i] < 0)
+            continue;
+        if(sensors.domainName(i) == "psys")
+        {
+            platform = double(store.powers[i]);
+            continue;
+        }
+        packages += double(store.powers[i]);
+        packagesKnown = true;
+    }
+    return packagesKnown ? packages : platform;
+}
+
+QString efficiencyText(double cycles, double energy)
+{
+    // MHz*s/J is millions of cycles per joule.
+    return QString::number(cycles/energy, 'f', 0) + " Mcycles/J";
+}
+}
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    coresTotal(uint(sysconf( _SC_NPROCESSORS_CONF )))
+    coresTotal(uint(sysconf( _SC_NPROCESSORS_CONF ))),
+    interfaceCpuTime(0),
+    diagnosticsWindowStart(CoreSampler::monotonicTime()),
+    diagnosticsProcessCpuStart(processCpuTime()),
+    diagnosticsTicks(0),
+    nextHistoryTimestamp(0),
+    residencyRevision(0),
+    residencyCore(-1),
+    residencyWindow(-1),
+    taskRevision(0),
+    taskCore(-1),
+    efficiencyTimestamp(0),
+    recordingSubscription(-1),
+    saveSubscription(-1),
+    saveTimestamp(0),
+    profileReconciler(nullptr),
+    nextReconcileTimestamp(0),
+    profileSubscription(-1),
+    shownDriftEntries(0),
+    replayStartTimestamp(0),
+    replayIndex(0),
+    replaySpeed(1.0),
+    replaying(false)
 {
     ui->setupUi(this);
-    initLogicCores();
+    // Read information from CPU pseudofiles on the sampler thread, only what the visible tab subscribes to.
+    coreSampler = new CoreSampler(coresTotal, 0);
+    // Load and power go with it, performance per watt of profiles is accumulated on every tab.
+    historySubscription = coreSampler->subscribe(QVector<int>(), SamplingPlan::attribute(LogicCore::CurrentFrequenceAttribute)
+                                                 | SamplingPlan::loadAttribute | SamplingPlan::powerAttribute, samplingInterval);
+    liveSnapshot = coreSampler->snapshots().acquireLatest();
+    currentSnapshot = liveSnapshot;
+    profileReconciler = new ProfileReconciler(*coreSampler, bulkApplier);
     initCoreUsageTab();
     initDetailedTab();
     initParametersTab();
     updateParametersTab();
+    subscribeVisibleTab();
 
-    // Set time when we will read information from CPU pseudofiles.
-    interfaceUpdateTimer = new QTimer(this);
-    connect(interfaceUpdateTimer, SIGNAL(timeout()), this, SLOT(updateInterface()));
-    interfaceUpdateTimer->start(1000);
+    connect(coreSampler, SIGNAL(snapshotPublished()), this, SLOT(updateInterface()));
+    connect(&replayTimer, SIGNAL(timeout()), this, SLOT(advanceReplay()));
+    coreSampler->start();
 
     // If user is not root then disable buttons for set action.
     if(getuid() != 0)
@@ -34,50 +157,76 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
-    for(auto &logicCore:this->logicCores)
+    replayTimer.stop();
+    coreSampler->stop();
+    delete profileReconciler;
+    delete coreSampler;
+    delete ui;
+}
+
+void MainWindow::subscribeVisibleTab()
+{
+    for(int subscription: tabSubscriptions)
+        coreSampler->unsubscribe(subscription);
+    tabSubscriptions.clear();
+    const quint32 limits = SamplingPlan::attribute(LogicCore::OnlineAttribute)
+            | SamplingPlan::attribute(LogicCore::ScalingMaxAttribute)
+            | SamplingPlan::attribute(LogicCore::ScalingMinAttribute);
+    const quint32 governor = SamplingPlan::attribute(LogicCore::GovernorAttribute);
+    QWidget *tab = ui->tabWidget->currentWidget();
+    if(tab == ui->coreUsageTab)
     {
-        delete logicCore;
+        tabSubscriptions.push_back(coreSampler->subscribe(QVector<int>(), SamplingPlan::attribute(LogicCore::OnlineAttribute)
+                                                          | SamplingPlan::loadAttribute, samplingInterval));
     }
-    for(auto &widgetPair:this->usageTabWidgets)
+    else if(tab == ui->tab_2)
     {
-        delete widgetPair.first;
-        delete widgetPair.second;
+        QVector<int> cores;
+        cores.push_back(ui->listWidget_detailedTab->currentRow());
+        tabSubscriptions.push_back(coreSampler->subscribe(cores, SamplingPlan::attribute(LogicCore::CurrentFrequenceAttribute),
+                                                          currentFrequenceInterval));
+        tabSubscriptions.push_back(coreSampler->subscribe(cores, limits | SamplingPlan::loadAttribute
+                                                          | SamplingPlan::residencyAttribute | SamplingPlan::taskAttribute
+                                                          | SamplingPlan::idleAttribute, samplingInterval));
+        tabSubscriptions.push_back(coreSampler->subscribe(cores, governor, governorInterval));
+    }
+    else if(tab == ui->tab)
+    {
+        // Apply skips attributes equal to the live snapshot, so every core it may touch is kept fresh.
+        tabSubscriptions.push_back(coreSampler->subscribe(QVector<int>(), limits | governor | SamplingPlan::idleAttribute,
+                                                          samplingInterval));
     }
-    delete interfaceUpdateTimer;
-    delete ui;
 }
 
-void MainWindow::initLogicCores()
+void MainWindow::on_tabWidget_currentChanged(int index)
 {
-    for(uint i = 0; i < this->coresTotal; i++)
-    {
-        this->logicCores.push_back(new LogicCore(i));
-    }
+    subscribeVisibleTab();
 }
 
 void MainWindow::initCoreUsageTab()
 {
-    QFormLayout *formLayout = static_cast<QFormLayout*>(ui->scrollAreaWidgetContents->layout());
-    for(uint i = 0; i < this->coresTotal; i++)
-    {
-        QLabel *coreLabel = new QLabel(QString("Core " + QString::number(i)));
-        QProgressBar *coreLoad = new QProgressBar();
-        formLayout->addRow(coreLabel, coreLoad);
-        QPair<QWidget*, QWidget*> widgetPair(coreLabel, coreLoad);
-        this->usageTabWidgets.push_back(widgetPair);
-    }
+    ui->coreHeatmap->setCoresTotal(this->currentSnapshot->size());
+    ui->coreHeatmap->setValues(this->currentSnapshot->loads.constData(), this->currentSnapshot->size());
 }
-
 void MainWindow::initDetailedTab()
 {
-    for(int i = 0; i < this->logicCores.size(); i++)
+    for(int i = 0; i < this->currentSnapshot->size(); i++)
         ui->listWidget_detailedTab->addItem("Logic core " + QString::number(i));
     ui->listWidget_detailedTab->setCurrentRow(0);
+    // Pyramids are preallocated, history of all cores is kept even when only one is shown.
+    frequencyHistory.resize(this->currentSnapshot->size());
+    appendFrequencyHistory(*this->currentSnapshot);
+    for(const ChartSpan &span: chartSpans)
+        ui->comboBox_chartSpan->addItem(span.name);
+    ui->comboBox_chartSpan->setCurrentIndex(0);
+    for(const ChartSpan &window: residencyWindows)
+        ui->comboBox_residencyWindow->addItem(window.name);
+    ui->comboBox_residencyWindow->setCurrentIndex(0);
 }
 
 void MainWindow::initParametersTab()
 {
-    for(int i = 0; i < this->logicCores.size(); i++)
+    for(int i = 0; i < this->currentSnapshot->size(); i++)
         ui->listWidget_parameterTab->addItem("Logic core " + QString::number(i));
     ui->listWidget_parameterTab->setCurrentRow(0);
 }
@@ -86,31 +235,23 @@ void MainWindow::initParametersTab()
 
 void MainWindow::updateUsageTab()
 {
-    for(auto& logicCore: this->logicCores)
-    {
-        int maxFreq = int(logicCore->getMaxCoreFrequence());
-        int minFreq = int(logicCore->getMinCoreFrequence());
-        int curFreq = int(logicCore->getCurrentCoreFrequence());
-        int coreNumber = int(logicCore->getNumber());
-        QProgressBar* progressBar = static_cast<QProgressBar*>(usageTabWidgets[coreNumber].second);
-        progressBar->setMaximum(maxFreq);
-        progressBar->setMinimum(minFreq);
-        progressBar->setValue(curFreq);
-    }
+    TRACE_SCOPE("MainWindow::updateUsageTab");
+    // Unknown load (offline core) is drawn as a gray cell.
+    ui->coreHeatmap->setValues(currentSnapshot->loads.constData(), currentSnapshot->size());
 }
-
 void MainWindow::updateDetailedTab()
 {
-    int currentRow = ui->listWidget_detailedTab->currentRow();
-    LogicCore *logicCore = logicCores[currentRow];
-    int maxFreq = int(logicCore->getMaxCoreFrequence());
-    int minFreq = int(logicCore->getMinCoreFrequence());
-    int maxScalFreq = int(logicCore->getScalingMaxFrequence());
-    int minScalFreq = int(logicCore->getScalingMinFrequence());
-    int curFreq = int(logicCore->getCurrentCoreFrequence());
-    QString currentGovernor = logicCore->getGovernor();
-    bool coreOnline = logicCore->getOnline();
-    int coreNumber = int(logicCore->getNumber());
+    TRACE_SCOPE("MainWindow::updateDetailedTab");
+    int coreNumber = ui->listWidget_detailedTab->currentRow();
+    const CoreStateStore &store = *currentSnapshot;
+    int maxFreq = int(store.maxCoreFrequences[coreNumber]);
+    int minFreq = int(store.minCoreFrequences[coreNumber]);
+    int maxScalFreq = int(store.maxScalingFrequences[coreNumber]);
+    int minScalFreq = int(store.minScalingFrequences[coreNumber]);
+    int curFreq = int(store.currentFrequences[coreNumber]);
+    QString currentGovernor = GovernorTable::instance().name(store.governors[coreNumber]);
+    bool coreOnline = store.online[coreNumber];
+    float load = store.loads[coreNumber];
     ui->coreNumValueLabel->setText(QString::number(coreNumber));
     ui->onlineValueLabel->setText(coreOnline?"True":"False");
     ui->governorValueLabel->setText(currentGovernor);
@@ -121,18 +262,256 @@ void MainWindow::updateDetailedTab()
     ui->curFreqValueLabel->setText(QString::number(curFreq/HZ_TO_MHZ) + " MHz");
     ui->maxScalFreqValueLabel->setText(QString::number(maxScalFreq/HZ_TO_MHZ) + " MHz");
     ui->minScalFreqValueLabel->setText(QString::number(minScalFreq/HZ_TO_MHZ) + " MHz");
+    ui->loadValueLabel->setText(load < 0 ? "Unknown" : QString::number(double(load), 'f', 1) + " %");
+    const LogicCore &logicCore = coreSampler->logicCore(coreNumber);
+    ui->policyValueLabel->setText("Shared by " + QString::number(logicCore.getPolicySize())
+                                  + " logic cores, led by core " + QString::number(logicCore.getPolicyLeaderNumber()));
+    if(logicCore.hasStaticAttributes())
+        ui->topologyValueLabel->setText("Package " + QString::number(logicCore.getPackageId())
+                                        + ", physical core " + QString::number(logicCore.getPhysicalCoreId()));
+    else
+        ui->topologyValueLabel->setText("Unknown, core was offline since start");
+
+    updateResidencyTable(coreNumber);
+    updateTaskTable(coreNumber);
+    updateIdleTable(coreNumber, store);
+    updateSensorLabels(store);
+
+    int spanIndex = ui->comboBox_chartSpan->currentIndex();
+    if(spanIndex < 0)
+        spanIndex = 0;
+    const quint64 spanSamples = quint64(chartSpans[spanIndex].seconds)*1000/samplingInterval;
+    ui->frequencyChart->setSeries(&frequencyHistory[coreNumber], spanSamples, uint(minFreq), uint(maxFreq));
 
 }
 
 void MainWindow::updateParametersTab()
 {
+    TRACE_SCOPE("MainWindow::updateParametersTab");
     int currentRow = ui->listWidget_parameterTab->currentRow();
-    LogicCore *logicCore = logicCores[currentRow];
-    QStringList list = logicCore->getAvailableGovernors();
+    const GovernorTable &governorTable = GovernorTable::instance();
+    quint32 availableGovernors = currentSnapshot->availableGovernors[currentRow];
+    QStringList list;
+    for(int id = 0; id < governorTable.size(); id++)
+    {
+        if(availableGovernors & (quint32(1) << id))
+            list.push_back(governorTable.name(quint8(id)));
+    }
     ui->comboBox_governors->clear();
     ui->comboBox_governors->addItems(list);
-    QString currentGovernor = logicCore->getGovernor();
+    QString currentGovernor = governorTable.name(currentSnapshot->governors[currentRow]);
     ui->comboBox_governors->setCurrentText(currentGovernor);
+
+    // Checked states are enabled, apply writes the disable files of the listed states only.
+    const IdleStates &idleStates = coreSampler->idleStates();
+    const quint32 disabled = currentRow < currentSnapshot->disabledIdleStates.size()
+            ? currentSnapshot->disabledIdleStates[currentRow] : 0;
+    ui->listWidget_idleStates->clear();
+    for(int state = 0; state < idleStates.coreStatesTotal(currentRow); state++)
+    {
+        QListWidgetItem *item = new QListWidgetItem(QString("%1 (%2 us)").arg(idleStates.stateName(currentRow, state))
+                                                    .arg(idleStates.stateLatency(currentRow, state)));
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(disabled & (quint32(1) << state) ? Qt::Unchecked : Qt::Checked);
+        ui->listWidget_idleStates->addItem(item);
+    }
+}
+
+void MainWindow::updateDiagnosticsTab()
+{
+    const qint64 NSEC_PER_USEC = 1000;
+    ui->samplerCpuValueLabel->setText(QString::number(liveSnapshot->samplingCpuTime/NSEC_PER_USEC) + " us");
+    ui->samplerWallValueLabel->setText(QString::number(liveSnapshot->samplingDuration/NSEC_PER_USEC) + " us");
+    ui->interfaceCpuValueLabel->setText(QString::number(interfaceCpuTime/NSEC_PER_USEC) + " us");
+    const qint64 now = CoreSampler::monotonicTime();
+    const qint64 window = now - diagnosticsWindowStart;
+    if(window < 1000000000)
+        return;
+    const qint64 processCpu = processCpuTime();
+    ui->tickRateValueLabel->setText(QString::number(double(diagnosticsTicks)*1e9/window, 'f', 1));
+    // Percents of one core, every thread of the tool together.
+    ui->processCpuValueLabel->setText(QString::number(double(processCpu - diagnosticsProcessCpuStart)*100.0/window, 'f', 2) + " %");
+    diagnosticsWindowStart = now;
+    diagnosticsProcessCpuStart = processCpu;
+    diagnosticsTicks = 0;
+}
+
+void MainWindow::reconcileProfile()
+{
+    profileReconciler->reconcile(*liveSnapshot);
+    // Checks follow the profile's subscription, whose deadlines are multiples of the interval.
+    const qint64 interval = qint64(profileFile.getInterval())*1000000;
+    nextReconcileTimestamp = (liveSnapshot->timestamp/interval + 1)*interval;
+    ui->profileValueLabel->setText(QString("%1, %2 checks, %3 drifted attributes corrected")
+                                   .arg(profileReconciler->profileName())
+                                   .arg(profileReconciler->checksTotal())
+                                   .arg(profileReconciler->driftsTotal()));
+    quint64 index = shownDriftEntries;
+    if(index < profileReconciler->oldestLogEntry())
+        index = profileReconciler->oldestLogEntry();
+    for(; index < profileReconciler->logTotal(); index++)
+    {
+        const ProfileReconciler::DriftEntry &entry = profileReconciler->logEntry(index);
+        QString line = QString("%1 s: logic core %2 %3 was %4, expected %5")
+                .arg(double(entry.timestamp)/1000000000, 0, 'f', 3)
+                .arg(entry.coreNumber)
+                .arg(entry.attribute)
+                .arg(entry.found)
+                .arg(entry.expected);
+        if(!entry.error.isEmpty())
+            line += ", not corrected: " + entry.error;
+        else if(!entry.drifted)
+            line += ", applied";
+        else
+            line += ", corrected";
+        ui->driftLogText->appendPlainText(line);
+    }
+    shownDriftEntries = index;
+}
+
+void MainWindow::enforceProfile(const Profile &profile)
+{
+    if(profileSubscription >= 0)
+        coreSampler->unsubscribe(profileSubscription);
+    profileReconciler->setProfile(profile, profileFile.getInterval());
+    profileSubscription = coreSampler->subscribe(profileReconciler->cores(), profileReconciler->attributes(),
+                                                 profileFile.getInterval());
+    nextReconcileTimestamp = 0;
+    ui->actionStop_profile->setEnabled(true);
+    ui->driftLogText->appendPlainText("Enforcing profile " + profile.name + " from " + profilePath);
+    reconcileProfile();
+}
+
+void MainWindow::saveProfile(const QString &path)
+{
+    // Other profiles of the file are kept, the captured one replaces its namesake.
+    ProfileFile saved;
+    if(QFile::exists(path) && !saved.load(path))
+    {
+        QMessageBox::warning(this, "Saving configuration failed.", saved.errorString());
+        return;
+    }
+    QString name = profileReconciler->isActive() ? profileReconciler->profileName() : profileName;
+    bool ok = false;
+    name = QInputDialog::getText(this, "Save configuration", "Profile name:", QLineEdit::Normal,
+                                 name.isEmpty() ? "default" : name, &ok).trimmed();
+    if(!ok || name.isEmpty())
+        return;
+    // Tabs keep scaling state fresh only for the cores they show, so it's read for all cores
+    //and captured from a snapshot taken after the request, see finishSaveProfile().
+    if(saveSubscription >= 0)
+        coreSampler->unsubscribe(saveSubscription);
+    pendingSave = saved;
+    pendingSavePath = path;
+    pendingSaveName = name;
+    const quint32 state = SamplingPlan::attribute(LogicCore::OnlineAttribute)
+            | SamplingPlan::attribute(LogicCore::ScalingMaxAttribute)
+            | SamplingPlan::attribute(LogicCore::ScalingMinAttribute)
+            | SamplingPlan::attribute(LogicCore::GovernorAttribute);
+    saveSubscription = coreSampler->subscribe(QVector<int>(), state, saveInterval);
+    // Deadlines of the plan are multiples of the interval, the plan is rebuilt before the next one passes,
+    //so every tick from the second multiple on has read the subscription at least once.
+    const qint64 interval = qint64(saveInterval)*1000000;
+    saveTimestamp = (CoreSampler::monotonicTime()/interval + 2)*interval;
+    ui->statusBar->showMessage("Reading the state of all cores for profile " + name + "...");
+}
+
+void MainWindow::finishSaveProfile()
+{
+    coreSampler->unsubscribe(saveSubscription);
+    saveSubscription = -1;
+    ProfileFile saved = pendingSave;
+    const QString name = pendingSaveName;
+    const QString path = pendingSavePath;
+    saved.setProfile(ProfileFile::capture(name, *liveSnapshot));
+    if(!saved.save(path))
+    {
+        QMessageBox::warning(this, "Saving configuration failed.", saved.errorString());
+        return;
+    }
+    profileFile = saved;
+    profilePath = path;
+    profileName = name;
+    // The enforced profile now holds the current state, so it is checked against that.
+    if(profileReconciler->isActive() && profileReconciler->profileName() == name)
+        enforceProfile(*profileFile.find(name));
+    ui->statusBar->showMessage("Profile " + name + " saved to " + path);
+}
+
+void MainWindow::on_actionSave_configuration_triggered()
+{
+    if(profilePath.isEmpty())
+    {
+        on_actionSave_configuration_as_triggered();
+        return;
+    }
+    saveProfile(profilePath);
+}
+
+void MainWindow::on_actionSave_configuration_as_triggered()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Save configuration", profilePath, "Profiles (*.lcip);;All files (*)");
+    if(path.isEmpty())
+        return;
+    saveProfile(path);
+}
+
+void MainWindow::on_actionOpen_configuration_triggered()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Open configuration", profilePath, "Profiles (*.lcip);;All files (*)");
+    if(path.isEmpty())
+        return;
+    ProfileFile opened;
+    if(!opened.load(path))
+    {
+        QMessageBox::warning(this, "Opening configuration failed.", opened.errorString());
+        return;
+    }
+    if(opened.getProfiles().isEmpty())
+    {
+        QMessageBox::warning(this, "Opening configuration failed.", "File has no profiles.");
+        return;
+    }
+    QStringList names;
+    for(const Profile &profile: opened.getProfiles())
+        names.push_back(profile.name);
+    bool ok = false;
+    QString name = QInputDialog::getItem(this, "Open configuration", "Profile to enforce:", names, 0, false, &ok);
+    if(!ok)
+        return;
+    profileFile = opened;
+    profilePath = path;
+    profileName = name;
+    enforceProfile(*profileFile.find(name));
+}
+
+void MainWindow::on_actionStop_profile_triggered()
+{
+    coreSampler->unsubscribe(profileSubscription);
+    profileSubscription = -1;
+    profileReconciler->clear();
+    ui->actionStop_profile->setEnabled(false);
+    ui->profileValueLabel->setText("None");
+    ui->driftLogText->appendPlainText("Stopped enforcing profile " + profileName);
+}
+
+void MainWindow::on_checkBox_tracing_toggled(bool checked)
+{
+    Trace::setEnabled(checked);
+}
+
+void MainWindow::on_button_exportTrace_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export trace", QString(), "Chrome trace (*.json);;All files (*)");
+    if(path.isEmpty())
+        return;
+    QString error;
+    if(!Trace::exportChromeTrace(path, error))
+    {
+        QMessageBox::warning(this, "Export failed.", error);
+        return;
+    }
+    ui->statusBar->showMessage("Trace exported to " + path);
 }
 
 void MainWindow::on_actionExit_triggered()
@@ -142,13 +521,299 @@ void MainWindow::on_actionExit_triggered()
 
 void MainWindow::updateInterface()
 {
-    for(auto& logicCore: this->logicCores)
-        logicCore->update();
-    updateUsageTab();
+    TRACE_SCOPE("MainWindow::updateInterface");
+    // Frequence history takes one tick per samplingInterval, tabs show only the newest one.
+    const qint64 cpuStart = CoreSampler::threadCpuTime();
+    const CoreStateStore *snapshot = nullptr;
+    const CoreStateStore *next;
+    while((next = coreSampler->snapshots().acquireNext()) != nullptr)
+    {
+        diagnosticsTicks++;
+        if(next->timestamp >= nextHistoryTimestamp)
+            appendFrequencyHistory(*next);
+        snapshot = next;
+    }
+    if(snapshot == nullptr)
+        return;
+    liveSnapshot = snapshot;
+    if(saveSubscription >= 0 && snapshot->timestamp >= saveTimestamp)
+        finishSaveProfile();
+    if(profileReconciler->isActive() && snapshot->timestamp >= nextReconcileTimestamp)
+        reconcileProfile();
+    if(ui->tabWidget->currentWidget() == ui->diagnosticsTab)
+        updateDiagnosticsTab();
+    if(!replaying)
+    {
+        currentSnapshot = snapshot;
+        interfaceUpdateTimer.start();
+        updateUsageTab();
+        updateDetailedTab();
+        updateStatusBar(interfaceUpdateTimer.nsecsElapsed());
+    }
+    interfaceCpuTime = CoreSampler::threadCpuTime() - cpuStart;
+}
+
+void MainWindow::appendFrequencyHistory(const CoreStateStore &store)
+{
+    const uint *currentFrequences = store.currentFrequences.constData();
+    for(int i = 0; i < frequencyHistory.size(); i++)
+        frequencyHistory[i].add(currentFrequences[i]);
+    // History deadlines of the sampling plan are multiples of the interval.
+    const qint64 historyInterval = qint64(samplingInterval)*1000000;
+    nextHistoryTimestamp = (store.timestamp/historyInterval + 1)*historyInterval;
+    accumulateEfficiency(store);
+}
+
+void MainWindow::accumulateEfficiency(const CoreStateStore &store)
+{
+    // Powers are averages since the previous power tick, so the interval before this tick gets them.
+    const double power = packagePower(store, coreSampler->powerSensors());
+    const double busy = busyFrequence(store);
+    const qint64 previous = efficiencyTimestamp;
+    efficiencyTimestamp = store.timestamp;
+    if(previous == 0 || power <= 0 || busy < 0)
+        return;
+    const QString name = profileReconciler != nullptr ? profileReconciler->profileName() : QString();
+    int index = 0;
+    while(index < efficiencyTotals.size() && efficiencyTotals[index].profileName != name)
+        index++;
+    if(index == efficiencyTotals.size())
+    {
+        EfficiencyTotals totals;
+        totals.profileName = name;
+        totals.cycles = 0;
+        totals.energy = 0;
+        totals.duration = 0;
+        efficiencyTotals.push_back(totals);
+    }
+    EfficiencyTotals &totals = efficiencyTotals[index];
+    const double seconds = double(store.timestamp - previous)/1000000000;
+    totals.cycles += busy*seconds;
+    totals.energy += power*seconds;
+    totals.duration += store.timestamp - previous;
+}
+
+void MainWindow::updateSensorLabels(const CoreStateStore &store)
+{
+    const PowerSensors &sensors = coreSampler->powerSensors();
+    // Replayed stores carry no sensors.
+    if(store.temperatures.size() != sensors.zonesTotal() || store.powers.size() != sensors.domainsTotal())
+    {
+        ui->temperatureValueLabel->setText("Not recorded");
+        ui->powerValueLabel->setText("Not recorded");
+        ui->efficiencyValueLabel->setText("Not recorded");
+        return;
+    }
+    QStringList temperatures;
+    for(int i = 0; i < sensors.zonesTotal(); i++)
+    {
+        temperatures.push_back(sensors.zoneName(i) + " " + (std::isnan(store.temperatures[i]) ? QString("unknown")
+                               : QString::number(double(store.temperatures[i]), 'f', 1) + QChar(0x00B0) + "C"));
+    }
+    ui->temperatureValueLabel->setText(temperatures.isEmpty() ? QString("No thermal zones") : temperatures.join(", "));
+
+    QStringList powers;
+    bool unreadable = false;
+    for(int i = 0; i < sensors.domainsTotal(); i++)
+    {
+        if(!sensors.isDomainReadable(i))
+        {
+            unreadable = true;
+            continue;
+        }
+        powers.push_back(sensors.domainName(i) + " " + (store.powers[i] < 0 ? QString("unknown")
+                         : QString::number(double(store.powers[i]), 'f', 1) + " W"));
+    }
+    if(unreadable)
+        powers.push_back(getuid() != 0 ? "RAPL energy counters are readable by root only" : "Some RAPL energy counters can't be read");
+    ui->powerValueLabel->setText(powers.isEmpty() ? QString("No RAPL energy counters") : powers.join(", "));
+
+    const double power = packagePower(store, sensors);
+    const double busy = busyFrequence(store);
+    if(power <= 0 || busy < 0)
+    {
+        ui->efficiencyValueLabel->setText("Unknown, needs package power and core loads");
+        return;
+    }
+    QString efficiency = "Now " + efficiencyText(busy, power) + " at " + QString::number(power, 'f', 1) + " W";
+    for(const EfficiencyTotals &totals: efficiencyTotals)
+    {
+        if(totals.energy <= 0)
+            continue;
+        efficiency += "\n" + (totals.profileName.isEmpty() ? QString("Without profile") : totals.profileName) + ": "
+                + efficiencyText(totals.cycles, totals.energy) + " at "
+                + QString::number(totals.energy*1000000000/double(totals.duration), 'f', 1) + " W over "
+                + QString::number(totals.duration/1000000000) + " s";
+    }
+    ui->efficiencyValueLabel->setText(efficiency);
+}
+
+void MainWindow::updateStatusBar(qint64 interfaceUpdateDuration)
+{
+    // Sampling and interface costs are shown separately, in microseconds.
+    const qint64 NSEC_PER_USEC = 1000;
+    ui->statusBar->showMessage(QString("Sampling: %1 us, jitter: %2 us, interface: %3 us, dropped: %4")
+                               .arg(currentSnapshot->samplingDuration/NSEC_PER_USEC)
+                               .arg(currentSnapshot->jitter/NSEC_PER_USEC)
+                               .arg(interfaceUpdateDuration/NSEC_PER_USEC)
+                               .arg(quint64(coreSampler->snapshots().droppedCount())));
+}
+
+void MainWindow::updateResidencyTable(int coreNumber)
+{
+    // Residency isn't recorded, replay keeps the live table.
+    int windowIndex = ui->comboBox_residencyWindow->currentIndex();
+    if(windowIndex < 0)
+        windowIndex = 0;
+    const FrequenceResidency &residency = coreSampler->frequenceResidency();
+    const quint64 revision = residency.revision();
+    if(revision == residencyRevision && coreNumber == residencyCore && windowIndex == residencyWindow)
+        return;
+    residencyRevision = revision;
+    residencyCore = coreNumber;
+    residencyWindow = windowIndex;
+    const qint64 window = qint64(residencyWindows[windowIndex].seconds)*1000000000;
+    if(!residency.query(coreNumber, window, residencyValues))
+    {
+        ui->residencyValueLabel->setText("Unknown, core has no frequence list");
+        ui->residencyTable->setRowCount(0);
+        return;
+    }
+    const double seconds = double(residencyValues.duration)/1000000000;
+    ui->residencyValueLabel->setText(QString("%1 transitions in %2 s, %3")
+                                     .arg(residencyValues.transitions)
+                                     .arg(seconds, 0, 'f', 1)
+                                     .arg(residencyValues.exact ? "from cpufreq stats" : "polled"));
+    const int rowsTotal = residencyValues.frequences.size();
+    qint64 total = 0;
+    for(qint64 time: residencyValues.times)
+        total += time;
+    if(ui->residencyTable->rowCount() != rowsTotal)
+    {
+        ui->residencyTable->setRowCount(rowsTotal);
+        for(int row = 0; row < rowsTotal; row++)
+        {
+            for(int column = 0; column < 3; column++)
+                ui->residencyTable->setItem(row, column, new QTableWidgetItem());
+        }
+    }
+    // Highest frequence first, like the limits above.
+    const int HZ_TO_MHZ = 1000;
+    for(int row = 0; row < rowsTotal; row++)
+    {
+        const int index = rowsTotal - 1 - row;
+        const qint64 time = residencyValues.times[index];
+        ui->residencyTable->item(row, 0)->setText(QString::number(residencyValues.frequences[index]/HZ_TO_MHZ) + " MHz");
+        ui->residencyTable->item(row, 1)->setText(QString::number(double(time)/1000000000, 'f', 2) + " s");
+        ui->residencyTable->item(row, 2)->setText(total > 0 ? QString::number(100.0*time/total, 'f', 1) + " %" : "-");
+    }
+}
+
+void MainWindow::updateTaskTable(int coreNumber)
+{
+    // Tasks aren't recorded either, replay keeps the live table.
+    const TaskScanner &scanner = coreSampler->taskScanner();
+    const quint64 revision = scanner.revision();
+    if(revision == taskRevision && coreNumber == taskCore)
+        return;
+    taskRevision = revision;
+    taskCore = coreNumber;
+    if(!scanner.isOpen())
+    {
+        ui->taskValueLabel->setText("Unknown, /proc can't be read");
+        ui->taskTable->setRowCount(0);
+        return;
+    }
+    if(revision < 2)
+    {
+        ui->taskValueLabel->setText("Collecting tasks...");
+        ui->taskTable->setRowCount(0);
+        return;
+    }
+    scanner.query(coreNumber, tasksShown, taskValues);
+    const qint64 NSEC_PER_USEC = 1000;
+    ui->taskValueLabel->setText(QString("Busiest tasks, %1 of %2 tasks read in %3 us")
+                                .arg(scanner.tasksRead())
+                                .arg(scanner.tasksKnown())
+                                .arg(scanner.scanCpuTime()/NSEC_PER_USEC));
+    const int rowsTotal = taskValues.size();
+    if(ui->taskTable->rowCount() != rowsTotal)
+    {
+        ui->taskTable->setRowCount(rowsTotal);
+        for(int row = 0; row < rowsTotal; row++)
+        {
+            for(int column = 0; column < 3; column++)
+            {
+                if(ui->taskTable->item(row, column) == nullptr)
+                    ui->taskTable->setItem(row, column, new QTableWidgetItem());
+            }
+        }
+    }
+    for(int row = 0; row < rowsTotal; row++)
+    {
+        const TaskScanner::Task &task = taskValues[row];
+        ui->taskTable->item(row, 0)->setText(task.name);
+        // Threads show the process they belong to.
+        ui->taskTable->item(row, 1)->setText(task.id == task.processId ? QString::number(task.id)
+                                             : QString("%1 (%2)").arg(task.id).arg(task.processId));
+        ui->taskTable->item(row, 2)->setText(QString::number(double(task.load), 'f', 1) + " %");
+    }
+}
+
+void MainWindow::updateIdleTable(int coreNumber, const CoreStateStore &store)
+{
+    const IdleStates &idleStates = coreSampler->idleStates();
+    const int rowsTotal = idleStates.coreStatesTotal(coreNumber);
+    // Recordings don't carry idle states.
+    if(rowsTotal == 0 || store.idleStatesTotal == 0)
+    {
+        ui->idleValueLabel->setText(rowsTotal == 0 ? "No cpuidle states" : "Idle states aren't recorded");
+        ui->idleTable->setRowCount(0);
+        return;
+    }
+    const float *residencies = store.idleResidencies.constData() + coreNumber*store.idleStatesTotal;
+    const quint32 disabled = store.disabledIdleStates[coreNumber];
+    if(residencies[0] < 0)
+        ui->idleValueLabel->setText("Idle states, collecting...");
+    else
+        ui->idleValueLabel->setText(QString("Idle states, %1 wakeups since the previous read")
+                                    .arg(store.idleWakeups[coreNumber]));
+    if(ui->idleTable->rowCount() != rowsTotal)
+    {
+        ui->idleTable->setRowCount(rowsTotal);
+        for(int row = 0; row < rowsTotal; row++)
+        {
+            for(int column = 0; column < 3; column++)
+            {
+                if(ui->idleTable->item(row, column) == nullptr)
+                    ui->idleTable->setItem(row, column, new QTableWidgetItem());
+            }
+        }
+    }
+    for(int row = 0; row < rowsTotal; row++)
+    {
+        QString name = idleStates.stateName(coreNumber, row);
+        if(disabled & (quint32(1) << row))
+            name += " (disabled)";
+        ui->idleTable->item(row, 0)->setText(name);
+        ui->idleTable->item(row, 1)->setText(QString::number(idleStates.stateLatency(coreNumber, row)) + " us");
+        const float residency = row < store.idleStatesTotal ? residencies[row] : -1;
+        ui->idleTable->item(row, 2)->setText(residency < 0 ? "-" : QString::number(double(residency), 'f', 1) + " %");
+    }
+}
+
+void MainWindow::on_comboBox_residencyWindow_currentIndexChanged(int index)
+{
     updateDetailedTab();
 }
 
 void MainWindow::on_listWidget_detailedTab_itemClicked(QListWidgetItem *item)
+{
+    subscribeVisibleTab();
+    updateDetailedTab();
+}
+
+void MainWindow::on_comboBox_chartSpan_currentIndexChanged(int index)
 {
     updateDetailedTab();
 }
@@ -182,55 +847,191 @@ void MainWindow::on_listWidget_parameterTab_itemClicked(QListWidgetItem *item)
     updateParametersTab();
 }
 
-void MainWindow::on_button_applyCurrent_clicked()
+LogicCore::ApplySettings MainWindow::settingsForCore(const LogicCore &core) const
 {
-    // Get information from widgets.
-    int selectedCore = ui->listWidget_parameterTab->currentRow();
-    LogicCore *core = this->logicCores[selectedCore];
-    int maxSliderValue = ui->sliderMaxFreq->maximum();
     // Normalized slider values [0; 1].
-    int maxNormalizedValue = ui->sliderMaxFreq->value()/maxSliderValue;
-    int minNormalizedValue = ui->sliderMinFreq->value()/maxSliderValue;
-    bool isOnline = ui->checkBox_coreOnline->isChecked();
-    QString governor = ui->comboBox_governors->currentText();
-
-    // Apply information from widgets to logic core.
-    core->setOnline(isOnline);
-    int maxHardFreq = int(core->getMaxCoreFrequence());
-    int minHardFreq = int(core->getMinCoreFrequence());
+    double maxNormalizedValue = double(ui->sliderMaxFreq->value())/ui->sliderMaxFreq->maximum();
+    double minNormalizedValue = double(ui->sliderMinFreq->value())/ui->sliderMinFreq->maximum();
+    uint maxHardFreq = core.getMaxCoreFrequence();
+    uint minHardFreq = core.getMinCoreFrequence();
     // Calculate scaling frequence(it's complicated):
     //First, we get delta from maximum and minimum possible hardware frequence (maxHardFreq-minHardFreq);
     //Second, multiply result with normalized value from slider, so we will not exceed hardware bounds;
     //Third, add minimum possible hardware frequence.
-    uint maxScalingFreq = uint((maxHardFreq-minHardFreq)*maxNormalizedValue+minHardFreq);
-    uint minScalingFreq = uint((minHardFreq-minHardFreq)*minNormalizedValue+minHardFreq);
-    core->setScalingMaxFrequence(maxScalingFreq);
-    core->setScalingMinFrequence(minScalingFreq);
-    core->setGovernor(governor);
+    LogicCore::ApplySettings settings;
+    settings.online = ui->checkBox_coreOnline->isChecked();
+    settings.maxScalingFrequence = uint((maxHardFreq - minHardFreq)*maxNormalizedValue + 0.5) + minHardFreq;
+    settings.minScalingFrequence = uint((maxHardFreq - minHardFreq)*minNormalizedValue + 0.5) + minHardFreq;
+    settings.governor = GovernorTable::instance().find(ui->comboBox_governors->currentText());
+    // States listed for the selected core, cores with fewer states skip the rest.
+    const int statesTotal = qMin(ui->listWidget_idleStates->count(), coreSampler->idleStates().coreStatesTotal(int(core.getNumber())));
+    settings.idleStatesMask = 0;
+    settings.disabledIdleStates = 0;
+    for(int state = 0; state < statesTotal; state++)
+    {
+        settings.idleStatesMask |= quint32(1) << state;
+        if(ui->listWidget_idleStates->item(state)->checkState() != Qt::Checked)
+            settings.disabledIdleStates |= quint32(1) << state;
+    }
+    return settings;
+}
+
+void MainWindow::applySettings(const QVector<int> &coreNumbers)
+{
+    TRACE_SCOPE("MainWindow::applySettings");
+    QVector<const LogicCore*> cores;
+    QVector<LogicCore::ApplySettings> settings;
+    for(int coreNumber: coreNumbers)
+    {
+        const LogicCore &core = coreSampler->logicCore(coreNumber);
+        cores.push_back(&core);
+        settings.push_back(settingsForCore(core));
+    }
+    QElapsedTimer applyTimer;
+    applyTimer.start();
+    // Unchanged attributes are skipped by comparing with the latest live snapshot.
+    QVector<BulkApplier::Result> results = bulkApplier.apply(cores, settings, *liveSnapshot);
+    const qint64 NSEC_PER_USEC = 1000;
+    qint64 applyDuration = applyTimer.nsecsElapsed()/NSEC_PER_USEC;
+
+    QStringList failures;
+    for(const BulkApplier::Result &result: results)
+    {
+        if(!result.error.isEmpty())
+            failures.push_back("Logic core " + QString::number(result.coreNumber) + ": " + result.error);
+    }
+    ui->statusBar->showMessage(QString("Applied to %1 of %2 logic cores in %3 us.")
+                               .arg(results.size() - failures.size())
+                               .arg(results.size())
+                               .arg(applyDuration));
+    if(failures.isEmpty())
+        return;
+    // Keep the message box on screen for huge machines.
+    const int failuresShown = 20;
+    int hidden = failures.size() - failuresShown;
+    if(hidden > 0)
+    {
+        failures = failures.mid(0, failuresShown);
+        failures.push_back("... and " + QString::number(hidden) + " more.");
+    }
+    QMessageBox::warning(this, "Apply failed.", failures.join("\n"));
+}
+
+void MainWindow::on_button_applyCurrent_clicked()
+{
+    applySettings(QVector<int>() << ui->listWidget_parameterTab->currentRow());
 }
 
 void MainWindow::on_button_ApplyAll_clicked()
 {
-    int maxSliderValue = ui->sliderMaxFreq->maximum();
-    // Get normalized value [0; 1].
-    int maxNormalizedValue = ui->sliderMaxFreq->value()/maxSliderValue;
-    int minNormalizedValue = ui->sliderMinFreq->value()/maxSliderValue;
-    bool isOnline = ui->checkBox_coreOnline->isChecked();
-    QString governor = ui->comboBox_governors->currentText();
-
-    for(auto* core: logicCores)
-    {
-        int maxHardFreq = int(core->getMaxCoreFrequence());
-        int minHardFreq = int(core->getMinCoreFrequence());
-        // Calculate scaling frequence(it's complicated):
-        //First, we get delta from maximum and minimum possible hardware frequence (maxHardFreq-minHardFreq);
-        //Second, multiply result with normalized value from slider, so we will not exceed hardware bounds;
-        //Third, add minimum possible hardware frequence.
-        uint maxScalingFreq = uint((maxHardFreq-minHardFreq)*maxNormalizedValue+minHardFreq);
-        uint minScalingFreq = uint((minHardFreq-minHardFreq)*minNormalizedValue+minHardFreq);
-        core->setOnline(isOnline);
-        core->setScalingMaxFrequence(maxScalingFreq);
-        core->setScalingMinFrequence(minScalingFreq);
-        core->setGovernor(governor);
+    QVector<int> coreNumbers;
+    for(int i = 0; i < coreSampler->coresTotal(); i++)
+        coreNumbers.push_back(i);
+    applySettings(coreNumbers);
+}
+
+void MainWindow::on_actionStart_recording_triggered()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Record history", QString(), "History files (*.lcih);;All files (*)");
+    if(path.isEmpty())
+        return;
+    bool ok = false;
+    // One day at the default interval.
+    int capacity = QInputDialog::getInt(this, "Record history", "Ticks to keep:", 86400, 1, 100000000, 1, &ok);
+    if(!ok)
+        return;
+    if(!historyRecorder.open(path, quint64(capacity), *liveSnapshot, samplingInterval))
+    {
+        QMessageBox::warning(this, "Recording failed.", historyRecorder.errorString());
+        return;
     }
+    coreSampler->addSink(&historyRecorder);
+    recordingSubscription = coreSampler->subscribe(QVector<int>(), SamplingPlan::allAttributes, samplingInterval);
+    ui->actionStart_recording->setEnabled(false);
+    ui->actionStop_recording->setEnabled(true);
+}
+
+void MainWindow::on_actionStop_recording_triggered()
+{
+    coreSampler->unsubscribe(recordingSubscription);
+    recordingSubscription = -1;
+    coreSampler->removeSink(&historyRecorder);
+    historyRecorder.close();
+    ui->actionStart_recording->setEnabled(true);
+    ui->actionStop_recording->setEnabled(false);
+}
+
+void MainWindow::on_actionOpen_recording_triggered()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Replay history", QString(), "History files (*.lcih);;All files (*)");
+    if(path.isEmpty())
+        return;
+    if(!historyPlayer.open(path))
+    {
+        QMessageBox::warning(this, "Replay failed.", historyPlayer.errorString());
+        return;
+    }
+    // Tabs are built for the cores of this machine.
+    if(historyPlayer.coresTotal() != coreSampler->coresTotal() || historyPlayer.recordsTotal() == 0)
+    {
+        QMessageBox::warning(this, "Replay failed.", "Recording is empty or was made on a machine with "
+                             + QString::number(historyPlayer.coresTotal()) + " logic cores.");
+        historyPlayer.close();
+        return;
+    }
+    bool ok = false;
+    double speed = QInputDialog::getDouble(this, "Replay history", "Speed:", 1.0, 0.01, 10000.0, 2, &ok);
+    if(!ok)
+    {
+        historyPlayer.close();
+        return;
+    }
+    replaySpeed = speed;
+    replaying = true;
+    replayStartTimestamp = historyPlayer.timestampAt(0);
+    replayClock.start();
+    showReplayRecord(0);
+    replayTimer.start(replayRefreshInterval);
+    ui->actionStop_replay->setEnabled(true);
+}
+
+void MainWindow::on_actionStop_replay_triggered()
+{
+    replayTimer.stop();
+    historyPlayer.close();
+    replaying = false;
+    ui->actionStop_replay->setEnabled(false);
+    currentSnapshot = liveSnapshot;
+    updateUsageTab();
+    updateDetailedTab();
+}
+
+void MainWindow::advanceReplay()
+{
+    // Records are in time order, so the position only moves forward.
+    const qint64 position = replayStartTimestamp + qint64(double(replayClock.nsecsElapsed())*replaySpeed);
+    const quint64 recordsTotal = historyPlayer.recordsTotal();
+    quint64 index = replayIndex;
+    while(index + 1 < recordsTotal && historyPlayer.timestampAt(index + 1) <= position)
+        index++;
+    if(index != replayIndex)
+        showReplayRecord(index);
+    if(index + 1 >= recordsTotal)
+    {
+        replayTimer.stop();
+        ui->statusBar->showMessage(QString("Replay finished, %1 records.").arg(recordsTotal));
+    }
+}
+
+void MainWindow::showReplayRecord(quint64 index)
+{
+    replayIndex = index;
+    historyPlayer.read(index, replayStore);
+    currentSnapshot = &replayStore;
+    updateUsageTab();
+    updateDetailedTab();
+    ui->statusBar->showMessage(QString("Replay: record %1 of %2, speed %3x")
+                               .arg(index + 1)
+                               .arg(historyPlayer.recordsTotal())
+                               .arg(replaySpeed));
 }
@@ -4,10 +4,17 @@
 #include <QMainWindow>
 #include <QListWidgetItem>
 #include <QVector>
-#include <QPair>
+#include <QElapsedTimer>
 #include <QTimer>
 
 #include "logiccore.h"
+#include "coresampler.h"
+#include "historyrecorder.h"
+#include "historyplayer.h"
+#include "samplepyramid.h"
+#include "bulkapplier.h"
+#include "profilefile.h"
+#include "profilereconciler.h"
 
 namespace Ui {
 class MainWindow;
@@ -25,8 +32,14 @@ private slots:
     void on_actionExit_triggered();
     void updateInterface();
 
+    void on_tabWidget_currentChanged(int index);
+
     void on_listWidget_detailedTab_itemClicked(QListWidgetItem *item);
 
+    void on_comboBox_chartSpan_currentIndexChanged(int index);
+
+    void on_comboBox_residencyWindow_currentIndexChanged(int index);
+
     void on_sliderMaxFreq_valueChanged(int value);
 
     void on_sliderMinFreq_valueChanged(int value);
@@ -37,21 +50,122 @@ private slots:
 
     void on_button_ApplyAll_clicked();
 
+    void on_actionStart_recording_triggered();
+
+    void on_actionStop_recording_triggered();
+
+    void on_actionOpen_recording_triggered();
+
+    void on_actionStop_replay_triggered();
+
+    void advanceReplay();
+
+    void on_actionSave_configuration_triggered();
+
+    void on_actionSave_configuration_as_triggered();
+
+    void on_actionOpen_configuration_triggered();
+
+    void on_actionStop_profile_triggered();
+
+    void on_checkBox_tracing_toggled(bool checked);
+
+    void on_button_exportTrace_clicked();
+
 private:
-    QTimer *interfaceUpdateTimer;
     Ui::MainWindow *ui;
     const uint coresTotal;
-    QVector<LogicCore*> logicCores;
-    QVector<QPair<QWidget*, QWidget*>> usageTabWidgets;
+    CoreSampler *coreSampler;
+    // Latest snapshot taken from coreSampler, owned by GUI thread until the next one.
+    const CoreStateStore *liveSnapshot;
+    // Snapshot shown in the interface, either liveSnapshot or replayStore.
+    const CoreStateStore *currentSnapshot;
+    QElapsedTimer interfaceUpdateTimer;
+    // GUI thread CPU time of the last updateInterface(), nanoseconds.
+    qint64 interfaceCpuTime;
+    // Tick rate and process CPU usage are averaged over windows of about a second.
+    qint64 diagnosticsWindowStart;
+    qint64 diagnosticsProcessCpuStart;
+    int diagnosticsTicks;
+    // Current frequence of every core once per samplingInterval, one pyramid per core.
+    QVector<SamplePyramid> frequencyHistory;
+    // Ticks before it only refresh the tabs.
+    qint64 nextHistoryTimestamp;
+    // Residency table is filled again only when the sampler updated it or another core or window is picked.
+    FrequenceResidency::Table residencyValues;
+    quint64 residencyRevision;
+    int residencyCore;
+    int residencyWindow;
+    // Task table follows the same rule with the task scanner's revision.
+    QVector<TaskScanner::Task> taskValues;
+    quint64 taskRevision;
+    int taskCore;
+    // Busy cycles and package energy per enforced profile (empty name without one), accumulated
+    //every history tick so profiles can be compared by performance per watt.
+    struct EfficiencyTotals
+    {
+        QString profileName;
+        double cycles;
+        double energy;
+        qint64 duration;
+    };
+    QVector<EfficiencyTotals> efficiencyTotals;
+    qint64 efficiencyTimestamp;
+
+    // Frequence history is always sampled, the other subscriptions follow what is on screen.
+    int historySubscription;
+    int recordingSubscription;
+    QVector<int> tabSubscriptions;
+    // Profile being saved, captured from the first snapshot at or after saveTimestamp.
+    int saveSubscription;
+    qint64 saveTimestamp;
+    ProfileFile pendingSave;
+    QString pendingSavePath;
+    QString pendingSaveName;
+
+    BulkApplier bulkApplier;
+    // Profiles of the last opened or saved file, the enforced one is checked once per its interval.
+    ProfileFile profileFile;
+    QString profilePath;
+    QString profileName;
+    ProfileReconciler *profileReconciler;
+    qint64 nextReconcileTimestamp;
+    int profileSubscription;
+    // Drift log entries already appended to the Diagnostics tab.
+    quint64 shownDriftEntries;
+    HistoryRecorder historyRecorder;
+    HistoryPlayer historyPlayer;
+    CoreStateStore replayStore;
+    QTimer replayTimer;
+    QElapsedTimer replayClock;
+    qint64 replayStartTimestamp;
+    quint64 replayIndex;
+    double replaySpeed;
+    bool replaying;
 
-    void initLogicCores();
     void initCoreUsageTab();
     void initDetailedTab();
 
+    void subscribeVisibleTab();
+    void appendFrequencyHistory(const CoreStateStore &store);
+    void accumulateEfficiency(const CoreStateStore &store);
     void updateUsageTab();
     void updateDetailedTab();
+    void updateResidencyTable(int coreNumber);
+    void updateTaskTable(int coreNumber);
+    void updateIdleTable(int coreNumber, const CoreStateStore &store);
+    void updateSensorLabels(const CoreStateStore &store);
     void updateParametersTab();
+    void updateDiagnosticsTab();
+    void updateStatusBar(qint64 interfaceUpdateDuration);
+    void showReplayRecord(quint64 index);
     void initParametersTab();
+    LogicCore::ApplySettings settingsForCore(const LogicCore &core) const;
+    void applySettings(const QVector<int> &coreNumbers);
+    void reconcileProfile();
+    void enforceProfile(const Profile &profile);
+    void saveProfile(const QString &path);
+    void finishSaveProfile();
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,466 @@
+#include "metricsexporter.h"
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "coresampler.h"
+#include "governortable.h"
+#include "trace.h"
+
+namespace
+{
+// Spare buffers let slow scrapers finish the previous tick while the next one is rendered.
+const int buffersTotal = 4;
+const int maxConnections = 1024;
+// Room for the HTTP header in front of the body.
+const size_t headerCapacity = 256;
+// Lines of a core without the governor name, the name is added by render().
+const size_t bytesPerCore = 640;
+const size_t fixedBytes = 4096;
+// Connections that didn't send a request and take their response within it are closed,
+//so stalled clients can't hold slots and spare buffers.
+const qint64 connectionTimeout = qint64(10)*1000000000;
+// Milliseconds between checks for expired connections while some are open.
+const int reapPeriod = 1000;
+const quint32 requestEnd = ('\r' << 24) | ('\n' << 16) | ('\r' << 8) | '\n';
+// epoll data of the listening socket and the wake eventfd, connections use their slot number.
+const quint32 listenEvent = 0xffffffffu;
+const quint32 wakeEvent = 0xfffffffeu;
+
+struct MetricFamily
+{
+    const char *name;
+    const char *help;
+};
+const MetricFamily frequenceFamilies[] =
+{
+    {"lci_cpu_frequency_hertz", "Current frequency of the logic core (scaling_cur_freq)."},
+    {"lci_cpu_scaling_min_frequency_hertz", "Lower scaling limit of the logic core (scaling_min_freq)."},
+    {"lci_cpu_scaling_max_frequency_hertz", "Upper scaling limit of the logic core (scaling_max_freq)."}
+};
+
+char *appendText(char *position, const char *end, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+char *appendText(char *position, const char *end, const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    const int length = vsnprintf(position, size_t(end - position), format, arguments);
+    va_end(arguments);
+    if(length < 0 || length >= end - position)
+        return const_cast<char*>(end);
+    return position + length;
+}
+
+// Returns `end` when the body didn't fit.
+char *renderBody(char *position, const char *end, const CoreStateStore &store)
+{
+    const int coresTotal = store.size();
+    const QVector<uint> *frequences[] = {&store.currentFrequences, &store.minScalingFrequences, &store.maxScalingFrequences};
+    for(size_t family = 0; family < sizeof(frequenceFamilies)/sizeof(frequenceFamilies[0]); family++)
+    {
+        const MetricFamily &metric = frequenceFamilies[family];
+        position = appendText(position, end, "# HELP %s %s\n# TYPE %s gauge\n", metric.name, metric.help, metric.name);
+        const uint *values = frequences[family]->constData();
+        for(int core = 0; core < coresTotal; core++)
+        {
+            // cpufreq attributes of an offline core are unknown.
+            if(store.online[core])
+                position = appendText(position, end, "%s{cpu=\"%d\"} %llu000\n", metric.name, core, (unsigned long long)values[core]);
+        }
+    }
+    const GovernorTable &governorTable = GovernorTable::instance();
+    position = appendText(position, end, "# HELP lci_cpu_governor Scaling governor of the logic core, 1 for the active one.\n"
+                                         "# TYPE lci_cpu_governor gauge\n");
+    for(int core = 0; core < coresTotal; core++)
+    {
+        if(store.online[core] && store.governors[core] != GovernorTable::unknownGovernor)
+            position = appendText(position, end, "lci_cpu_governor{cpu=\"%d\",governor=\"%s\"} 1\n",
+                                  core, governorTable.latin1Name(store.governors[core]));
+    }
+    position = appendText(position, end, "# HELP lci_cpu_online Online state of the logic core.\n# TYPE lci_cpu_online gauge\n");
+    for(int core = 0; core < coresTotal; core++)
+        position = appendText(position, end, "lci_cpu_online{cpu=\"%d\"} %d\n", core, int(store.online[core]));
+    position = appendText(position, end, "# HELP lci_sample_sequence Number of the sampling tick.\n# TYPE lci_sample_sequence counter\n"
+                                         "lci_sample_sequence %llu\n", (unsigned long long)store.sequence);
+    return position;
+}
+}
+
+MetricsExporter::MetricsExporter(QObject *parent):
+    QThread(parent),
+    listenDescriptor(-1),
+    wakeDescriptor(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    pollDescriptor(epoll_create1(EPOLL_CLOEXEC)),
+    boundPort(0),
+    buffers(buffersTotal),
+    current(-1),
+    connections(maxConnections),
+    scrapes(0),
+    skipped(0)
+{
+    for(Buffer &buffer: this->buffers)
+    {
+        buffer.offset = 0;
+        buffer.length = 0;
+        buffer.users = 0;
+    }
+    for(int slot = maxConnections - 1; slot >= 0; slot--)
+    {
+        this->connections[size_t(slot)].descriptor = -1;
+        this->freeConnections.push_back(slot);
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = wakeEvent;
+    if(this->pollDescriptor >= 0 && this->wakeDescriptor >= 0)
+        epoll_ctl(this->pollDescriptor, EPOLL_CTL_ADD, this->wakeDescriptor, &event);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+    for(int slot = 0; slot < maxConnections; slot++)
+    {
+        if(this->connections[size_t(slot)].descriptor >= 0)
+            closeConnection(slot);
+    }
+    if(this->listenDescriptor >= 0)
+        ::close(this->listenDescriptor);
+    if(!this->socketPath.isEmpty())
+        unlink(this->socketPath.toLocal8Bit().constData());
+    if(this->pollDescriptor >= 0)
+        ::close(this->pollDescriptor);
+    if(this->wakeDescriptor >= 0)
+        ::close(this->wakeDescriptor);
+}
+
+bool MetricsExporter::listenOn(int descriptor, const void *address, size_t addressSize)
+{
+    if(descriptor < 0)
+    {
+        this->error = QString("Cannot create socket: ") + strerror(errno);
+        return false;
+    }
+    if(bind(descriptor, static_cast<const sockaddr*>(address), socklen_t(addressSize)) != 0 || listen(descriptor, SOMAXCONN) != 0)
+    {
+        this->error = QString("Cannot listen: ") + strerror(errno);
+        ::close(descriptor);
+        return false;
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = listenEvent;
+    if(this->pollDescriptor < 0 || epoll_ctl(this->pollDescriptor, EPOLL_CTL_ADD, descriptor, &event) != 0)
+    {
+        this->error = QString("Cannot poll socket: ") + strerror(errno);
+        ::close(descriptor);
+        return false;
+    }
+    this->listenDescriptor = descriptor;
+    return true;
+}
+
+bool MetricsExporter::listenTcp(quint16 port)
+{
+    const int descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(descriptor >= 0)
+    {
+        const int reuse = 1;
+        setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    // Metrics are for local collectors only.
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(!listenOn(descriptor, &address, sizeof(address)))
+        return false;
+    socklen_t addressSize = sizeof(address);
+    if(getsockname(this->listenDescriptor, reinterpret_cast<sockaddr*>(&address), &addressSize) == 0)
+        this->boundPort = ntohs(address.sin_port);
+    return true;
+}
+
+bool MetricsExporter::listenUnix(const QString &path)
+{
+    const QByteArray rawPath = path.toLocal8Bit();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(size_t(rawPath.size()) >= sizeof(address.sun_path))
+    {
+        this->error = "Socket path is too long.";
+        return false;
+    }
+    memcpy(address.sun_path, rawPath.constData(), size_t(rawPath.size()));
+    unlink(rawPath.constData());
+    if(!listenOn(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), &address, sizeof(address)))
+        return false;
+    this->socketPath = path;
+    return true;
+}
+
+quint16 MetricsExporter::port() const
+{
+    return this->boundPort;
+}
+
+QString MetricsExporter::errorString() const
+{
+    return this->error;
+}
+
+void MetricsExporter::stop()
+{
+    if(!isRunning())
+        return;
+    requestInterruption();
+    const quint64 increment = 1;
+    ssize_t length = write(this->wakeDescriptor, &increment, sizeof(increment));
+    (void)length;
+    wait();
+}
+
+quint64 MetricsExporter::scrapesTotal() const
+{
+    return this->scrapes.load(std::memory_order_relaxed);
+}
+
+quint64 MetricsExporter::skippedTotal() const
+{
+    return this->skipped.load(std::memory_order_relaxed);
+}
+
+void MetricsExporter::consume(const CoreStateStore &store)
+{
+    TRACE_SCOPE("MetricsExporter::consume");
+    int spare = -1;
+    {
+        QMutexLocker locker(&this->buffersMutex);
+        for(int i = 0; i < buffersTotal && spare < 0; i++)
+        {
+            if(i != this->current && this->buffers[size_t(i)].users == 0)
+                spare = i;
+        }
+    }
+    if(spare < 0)
+    {
+        this->skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Not current and unused, so no connection can pick it up while it's rendered.
+    render(this->buffers[size_t(spare)], store);
+    QMutexLocker locker(&this->buffersMutex);
+    this->current = spare;
+}
+
+void MetricsExporter::render(Buffer &buffer, const CoreStateStore &store)
+{
+    // Governors may be interned after the first tick, so the longest name is looked up every time.
+    const GovernorTable &governorTable = GovernorTable::instance();
+    size_t longestGovernor = 0;
+    for(int id = 0; id < governorTable.size(); id++)
+        longestGovernor = qMax(longestGovernor, strlen(governorTable.latin1Name(quint8(id))));
+    const size_t capacity = headerCapacity + fixedBytes + size_t(store.size())*(bytesPerCore + longestGovernor);
+    if(buffer.data.size() < capacity)
+        buffer.data.resize(capacity);
+    char *body;
+    char *position;
+    // A body that still doesn't fit is rendered again into a larger buffer, never served cut off.
+    while(true)
+    {
+        body = buffer.data.data() + headerCapacity;
+        const char *const end = buffer.data.data() + buffer.data.size();
+        position = renderBody(body, end, store);
+        if(position != end)
+            break;
+        buffer.data.resize(buffer.data.size()*2);
+    }
+
+    char header[headerCapacity];
+    const int headerLength = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n"
+                                                              "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                                              "Content-Length: %zu\r\n"
+                                                              "Connection: close\r\n\r\n", size_t(position - body));
+    buffer.offset = headerCapacity - size_t(headerLength);
+    memcpy(buffer.data.data() + buffer.offset, header, size_t(headerLength));
+    buffer.length = size_t(position - body) + size_t(headerLength);
+}
+
+void MetricsExporter::run()
+{
+    epoll_event events[64];
+    qint64 nextReap = 0;
+    while(!isInterruptionRequested())
+    {
+        // Nothing to expire while no connection is open.
+        const bool connected = this->freeConnections.size() < size_t(maxConnections);
+        const int ready = epoll_wait(this->pollDescriptor, events, 64, connected ? reapPeriod : -1);
+        if(ready < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return;
+        }
+        for(int i = 0; i < ready; i++)
+        {
+            const quint32 data = events[i].data.u32;
+            if(data == wakeEvent)
+                continue;
+            if(data == listenEvent)
+            {
+                acceptConnections();
+                continue;
+            }
+            const int slot = int(data);
+            if(this->connections[size_t(slot)].descriptor < 0)
+                continue;
+            if(events[i].events & (EPOLLERR | EPOLLHUP))
+                closeConnection(slot);
+            else if(this->connections[size_t(slot)].buffer < 0)
+                readRequest(slot);
+            else
+                writeResponse(slot);
+        }
+        const qint64 now = CoreSampler::monotonicTime();
+        if(now >= nextReap)
+        {
+            closeExpiredConnections(now);
+            nextReap = now + qint64(reapPeriod)*1000000;
+        }
+    }
+}
+
+void MetricsExporter::acceptConnections()
+{
+    int descriptor;
+    while((descriptor = accept4(this->listenDescriptor, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        if(this->freeConnections.empty())
+        {
+            ::close(descriptor);
+            continue;
+        }
+        const int slot = this->freeConnections.back();
+        this->freeConnections.pop_back();
+        Connection &connection = this->connections[size_t(slot)];
+        connection.descriptor = descriptor;
+        connection.buffer = -1;
+        connection.written = 0;
+        connection.tail = 0;
+        connection.deadline = CoreSampler::monotonicTime() + connectionTimeout;
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = quint32(slot);
+        epoll_ctl(this->pollDescriptor, EPOLL_CTL_ADD, descriptor, &event);
+    }
+}
+
+void MetricsExporter::readRequest(int slot)
+{
+    Connection &connection = this->connections[size_t(slot)];
+    char request[4096];
+    bool complete = false;
+    while(!complete)
+    {
+        const ssize_t length = read(connection.descriptor, request, sizeof(request));
+        if(length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR))
+        {
+            closeConnection(slot);
+            return;
+        }
+        if(length < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return;
+        }
+        // Any request gets the metrics, only its end matters.
+        for(ssize_t i = 0; i < length && !complete; i++)
+        {
+            connection.tail = (connection.tail << 8) | quint8(request[i]);
+            complete = connection.tail == requestEnd;
+        }
+    }
+    {
+        QMutexLocker locker(&this->buffersMutex);
+        connection.buffer = this->current;
+        if(connection.buffer >= 0)
+            this->buffers[size_t(connection.buffer)].users++;
+    }
+    if(connection.buffer < 0)
+    {
+        static const char unavailable[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        ssize_t length = write(connection.descriptor, unavailable, sizeof(unavailable) - 1);
+        (void)length;
+        closeConnection(slot);
+        return;
+    }
+    this->scrapes.fetch_add(1, std::memory_order_relaxed);
+    writeResponse(slot);
+}
+
+void MetricsExporter::writeResponse(int slot)
+{
+    Connection &connection = this->connections[size_t(slot)];
+    const Buffer &buffer = this->buffers[size_t(connection.buffer)];
+    while(connection.written < buffer.length)
+    {
+        // One write() for the whole response unless the socket buffer is smaller.
+        const ssize_t length = write(connection.descriptor, buffer.data.data() + buffer.offset + connection.written,
+                                     buffer.length - connection.written);
+        if(length < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN)
+            {
+                epoll_event event;
+                event.events = EPOLLOUT;
+                event.data.u32 = quint32(slot);
+                epoll_ctl(this->pollDescriptor, EPOLL_CTL_MOD, connection.descriptor, &event);
+                return;
+            }
+            break;
+        }
+        connection.written += size_t(length);
+    }
+    closeConnection(slot);
+}
+
+void MetricsExporter::closeConnection(int slot)
+{
+    Connection &connection = this->connections[size_t(slot)];
+    if(connection.buffer >= 0)
+    {
+        QMutexLocker locker(&this->buffersMutex);
+        this->buffers[size_t(connection.buffer)].users--;
+    }
+    // close() removes the descriptor from the epoll set.
+    ::close(connection.descriptor);
+    connection.descriptor = -1;
+    connection.buffer = -1;
+    this->freeConnections.push_back(slot);
+}
+
+void MetricsExporter::closeExpiredConnections(qint64 now)
+{
+    for(int slot = 0; slot < maxConnections; slot++)
+    {
+        const Connection &connection = this->connections[size_t(slot)];
+        if(connection.descriptor >= 0 && now >= connection.deadline)
+            closeConnection(slot);
+    }
+}
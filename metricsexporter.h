@@ -0,0 +1,86 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <vector>
+
+#include "snapshotsink.h"
+
+// Serves the latest tick in the Prometheus text exposition format over HTTP on a localhost TCP port
+//or a Unix socket. The whole response is rendered once per tick on the sampler thread into a pooled buffer,
+//a scrape is one write() of it from the exporter's own thread, so scrapers never cause sysfs reads.
+class MetricsExporter : public QThread, public SnapshotSink
+{
+public:
+    explicit MetricsExporter(QObject *parent = nullptr);
+    ~MetricsExporter();
+
+    // Binds 127.0.0.1, port 0 picks a free one (see port()). Call before start().
+    bool listenTcp(quint16 port);
+    // Replaces a stale socket file at `path`. Call before start().
+    bool listenUnix(const QString &path);
+    quint16 port() const;
+    QString errorString() const;
+    void stop();
+
+    void consume(const CoreStateStore &store) override;
+
+    quint64 scrapesTotal() const;
+    // Ticks not rendered because every spare buffer was still being sent to slow scrapers.
+    quint64 skippedTotal() const;
+
+protected:
+    void run() override;
+
+private:
+    // Rendered response, HTTP header right in front of the body.
+    struct Buffer
+    {
+        std::vector<char> data;
+        size_t offset;
+        size_t length;
+        // Connections still writing it, guarded by buffersMutex.
+        int users;
+    };
+    struct Connection
+    {
+        int descriptor;
+        // -1 while the request is being read.
+        int buffer;
+        size_t written;
+        // Last four request bytes, the request ends with an empty line.
+        quint32 tail;
+        // CoreSampler::monotonicTime() after which the connection is closed unfinished.
+        qint64 deadline;
+    };
+
+    int listenDescriptor;
+    int wakeDescriptor;
+    int pollDescriptor;
+    QString socketPath;
+    quint16 boundPort;
+    QString error;
+
+    std::vector<Buffer> buffers;
+    // Buffer served to new scrapes, -1 before the first tick.
+    int current;
+    QMutex buffersMutex;
+
+    std::vector<Connection> connections;
+    std::vector<int> freeConnections;
+    std::atomic<quint64> scrapes;
+    std::atomic<quint64> skipped;
+
+    bool listenOn(int descriptor, const void *address, size_t addressSize);
+    void render(Buffer &buffer, const CoreStateStore &store);
+    void acceptConnections();
+    void readRequest(int slot);
+    void writeResponse(int slot);
+    void closeConnection(int slot);
+    void closeExpiredConnections(qint64 now);
+};
+
+#endif // METRICSEXPORTER_H
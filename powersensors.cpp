@@ -0,0 +1,207 @@
+#include "powersensors.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include "trace.h"
+
+namespace
+{
+const char thermalPath[] = "/sys/class/thermal";
+const char powercapPath[] = "/sys/class/powercap";
+const char raplPrefix[] = "intel-rapl:";
+
+bool parseNumber(const char *buffer, ssize_t length, bool allowSign, long long &value)
+{
+    ssize_t position = 0;
+    const bool negative = allowSign && length > 0 && buffer[0] == '-';
+    if(negative)
+        position++;
+    unsigned long long magnitude = 0;
+    const ssize_t digitsStart = position;
+    while(position < length && buffer[position] >= '0' && buffer[position] <= '9')
+        magnitude = magnitude*10 + unsigned(buffer[position++] - '0');
+    if(position == digitsStart)
+        return false;
+    value = negative ? -static_cast<long long>(magnitude) : static_cast<long long>(magnitude);
+    return true;
+}
+
+bool readNumber(const SysfsAttribute &file, bool allowSign, long long &value)
+{
+    char buffer[SysfsAttribute::bufferSize];
+    const ssize_t length = file.read(buffer, sizeof(buffer));
+    return length > 0 && parseNumber(buffer, length, allowSign, value);
+}
+
+QString readText(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return QString();
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+// Numbers after the prefix, "intel-rapl:0:1" gives {0, 1}, so entries sort numerically.
+std::vector<int> nameNumbers(const QString &name, int prefixLength)
+{
+    std::vector<int> numbers;
+    for(const QString &part: name.mid(prefixLength).split(':'))
+        numbers.push_back(part.toInt());
+    return numbers;
+}
+}
+
+PowerSensors::PowerSensors()
+{
+    findZones();
+    findDomains();
+    this->temperatures.assign(this->zones.size(), NAN);
+    this->powers.assign(this->domains.size(), -1);
+}
+
+void PowerSensors::findZones()
+{
+    const QString root = SysfsAttribute::rootPath() + thermalPath;
+    QStringList names = QDir(root).entryList(QStringList() << "thermal_zone*", QDir::Dirs | QDir::NoDotAndDotDot);
+    const int prefixLength = int(strlen("thermal_zone"));
+    std::sort(names.begin(), names.end(), [prefixLength](const QString &first, const QString &second)
+    {
+        return first.mid(prefixLength).toInt() < second.mid(prefixLength).toInt();
+    });
+    for(const QString &name: names)
+    {
+        Zone zone;
+        // Some drivers fail reads while their device is down (e.g. a wireless card),
+        //such zones stay listed with an unknown temperature.
+        if(!zone.temperatureFile.open(root + "/" + name + "/temp"))
+            continue;
+        zone.name = readText(root + "/" + name + "/type");
+        if(zone.name.isEmpty())
+            zone.name = name;
+        this->zones.push_back(std::move(zone));
+    }
+}
+
+void PowerSensors::findDomains()
+{
+    const QString root = SysfsAttribute::rootPath() + powercapPath;
+    const int prefixLength = int(strlen(raplPrefix));
+    QStringList names = QDir(root).entryList(QStringList() << QString(raplPrefix) + "*", QDir::Dirs | QDir::NoDotAndDotDot);
+    // Packages come before their subdomains.
+    std::sort(names.begin(), names.end(), [prefixLength](const QString &first, const QString &second)
+    {
+        return nameNumbers(first, prefixLength) < nameNumbers(second, prefixLength);
+    });
+    QString packageName;
+    for(const QString &name: names)
+    {
+        Domain domain;
+        domain.top = nameNumbers(name, prefixLength).size() == 1;
+        domain.name = readText(root + "/" + name + "/name");
+        if(domain.name.isEmpty())
+            domain.name = name;
+        if(domain.top)
+            packageName = domain.name;
+        else
+            domain.name = packageName + "/" + domain.name;
+        const QString path = root + "/" + name;
+        if(!QFile::exists(path + "/energy_uj"))
+            continue;
+        domain.readable = domain.energyFile.open(path + "/energy_uj");
+        long long range = 0;
+        SysfsAttribute rangeFile;
+        if(rangeFile.open(path + "/max_energy_range_uj") && readNumber(rangeFile, false, range))
+            domain.energyRange = static_cast<unsigned long long>(range);
+        else
+            domain.energyRange = 0;
+        domain.lastEnergy = 0;
+        domain.lastTimestamp = 0;
+        this->domains.push_back(std::move(domain));
+    }
+}
+
+int PowerSensors::zonesTotal() const
+{
+    return int(this->zones.size());
+}
+
+int PowerSensors::domainsTotal() const
+{
+    return int(this->domains.size());
+}
+
+const QString &PowerSensors::zoneName(int zone) const
+{
+    return this->zones[size_t(zone)].name;
+}
+
+const QString &PowerSensors::domainName(int domain) const
+{
+    return this->domains[size_t(domain)].name;
+}
+
+bool PowerSensors::isTopDomain(int domain) const
+{
+    return this->domains[size_t(domain)].top;
+}
+
+bool PowerSensors::isDomainReadable(int domain) const
+{
+    return this->domains[size_t(domain)].readable;
+}
+
+void PowerSensors::update(qint64 timestamp)
+{
+    TRACE_SCOPE("PowerSensors::update");
+    for(size_t i = 0; i < this->zones.size(); i++)
+    {
+        long long millidegrees;
+        this->temperatures[i] = readNumber(this->zones[i].temperatureFile, true, millidegrees) ? float(millidegrees)/1000 : NAN;
+    }
+    for(size_t i = 0; i < this->domains.size(); i++)
+    {
+        Domain &domain = this->domains[i];
+        long long value;
+        if(!domain.readable || !readNumber(domain.energyFile, false, value))
+        {
+            this->powers[i] = -1;
+            domain.lastTimestamp = 0;
+            continue;
+        }
+        const unsigned long long energy = static_cast<unsigned long long>(value);
+        float power = -1;
+        if(domain.lastTimestamp != 0 && timestamp > domain.lastTimestamp)
+        {
+            // Counter restarts from 0 after max_energy_range_uj. It wraps within minutes on big packages,
+            //slower than any sampling interval, so at most one wrap happens between two updates.
+            unsigned long long delta = energy - domain.lastEnergy;
+            bool known = true;
+            if(energy < domain.lastEnergy)
+            {
+                known = domain.energyRange >= domain.lastEnergy;
+                delta = domain.energyRange - domain.lastEnergy + energy;
+            }
+            // Microjoules per nanosecond to watts.
+            if(known)
+                power = float(double(delta)*1000/double(timestamp - domain.lastTimestamp));
+        }
+        this->powers[i] = power;
+        domain.lastEnergy = energy;
+        domain.lastTimestamp = timestamp;
+    }
+}
+
+const float *PowerSensors::temperatureData() const
+{
+    return this->temperatures.data();
+}
+
+const float *PowerSensors::powerData() const
+{
+    return this->powers.data();
+}
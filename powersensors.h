@@ -0,0 +1,67 @@
+#ifndef POWERSENSORS_H
+#define POWERSENSORS_H
+
+#include <vector>
+#include <QString>
+
+#include "sysfsattribute.h"
+
+// Thermal zones (/sys/class/thermal/thermal_zone*/temp) and powercap RAPL energy counters
+//(/sys/class/powercap/intel-rapl:*), found once at start and kept open.
+// Power of a domain is the energy delta between two updates over their time, the counter wraps
+//at max_energy_range_uj. Sensors that are missing or unreadable (energy_uj is root-only on recent
+//kernels) are listed with unknown values, nothing fails because of them.
+class PowerSensors
+{
+public:
+    PowerSensors();
+    PowerSensors(const PowerSensors &) = delete;
+    PowerSensors &operator=(const PowerSensors &) = delete;
+
+    // Names never change after construction, safe from any thread.
+    int zonesTotal() const;
+    int domainsTotal() const;
+    // Zone type, e.g. x86_pkg_temp.
+    const QString &zoneName(int zone) const;
+    // Domain name, subdomains are prefixed by their package, e.g. package-0/dram.
+    const QString &domainName(int domain) const;
+    // Whole package or platform, not a part of one (core, uncore, dram).
+    bool isTopDomain(int domain) const;
+    // False when energy_uj exists but can't be opened.
+    bool isDomainReadable(int domain) const;
+
+    // Sampler thread. Reads every sensor, timestamp is CLOCK_MONOTONIC nanoseconds.
+    void update(qint64 timestamp);
+    // Degrees Celsius, NaN when unknown.
+    const float *temperatureData() const;
+    // Watts since the previous update, negative when unknown (first update, unreadable counter).
+    const float *powerData() const;
+
+private:
+    struct Zone
+    {
+        QString name;
+        SysfsAttribute temperatureFile;
+    };
+    struct Domain
+    {
+        QString name;
+        bool top;
+        bool readable;
+        SysfsAttribute energyFile;
+        // Microjoules, 0 when the range is unknown and a wrap can't be told from a reset.
+        unsigned long long energyRange;
+        unsigned long long lastEnergy;
+        qint64 lastTimestamp;
+    };
+
+    std::vector<Zone> zones;
+    std::vector<Domain> domains;
+    std::vector<float> temperatures;
+    std::vector<float> powers;
+
+    void findZones();
+    void findDomains();
+};
+
+#endif // POWERSENSORS_H
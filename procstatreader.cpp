@@ -0,0 +1,129 @@
+#include "procstatreader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "trace.h"
+
+namespace
+{
+// Enough for a few hundred CPUs, grows when /proc/stat does not fit.
+const size_t initialBufferSize = 64*1024;
+
+inline const char *skipSpaces(const char *position, const char *end)
+{
+    while(position < end && *position == ' ')
+        position++;
+    return position;
+}
+
+inline const char *parseNumber(const char *position, const char *end, unsigned long long &value)
+{
+    value = 0;
+    while(position < end && *position >= '0' && *position <= '9')
+    {
+        value = value*10 + unsigned(*position - '0');
+        position++;
+    }
+    return position;
+}
+}
+
+ProcStatReader::ProcStatReader(int coresTotal):
+    buffer(initialBufferSize),
+    previousBusy(size_t(coresTotal), 0),
+    previousTotal(size_t(coresTotal), 0),
+    loads(size_t(coresTotal), -1.0f),
+    listed(size_t(coresTotal), 0)
+{
+    this->statFile.open(SysfsAttribute::rootPath() + "/proc/stat");
+}
+
+bool ProcStatReader::isOpen() const
+{
+    return this->statFile.isOpen();
+}
+
+ssize_t ProcStatReader::readAll()
+{
+    // A single pread returns the whole file when it fits,
+    //otherwise grow the buffer and read again from the start.
+    while(true)
+    {
+        ssize_t length = this->statFile.read(this->buffer.data(), this->buffer.size());
+        if(length < 0 || size_t(length) < this->buffer.size())
+            return length;
+        this->buffer.resize(this->buffer.size()*2);
+    }
+}
+
+bool ProcStatReader::update()
+{
+    TRACE_SCOPE("ProcStatReader::update");
+    if(!this->statFile.isOpen())
+        return false;
+    const ssize_t length = readAll();
+    if(length <= 0)
+        return false;
+
+    const size_t coresTotal = this->loads.size();
+    std::fill(this->listed.begin(), this->listed.end(), 0);
+
+    const char *position = this->buffer.data();
+    const char *end = position + length;
+    while(position < end)
+    {
+        const char *lineEnd = static_cast<const char*>(memchr(position, '\n', size_t(end - position)));
+        if(lineEnd == nullptr)
+            lineEnd = end;
+        // Per-core lines follow the aggregate "cpu " line and come before everything else.
+        const bool isCpuLine = lineEnd - position > 3 && memcmp(position, "cpu", 3) == 0;
+        if(isCpuLine && position[3] >= '0' && position[3] <= '9')
+        {
+            unsigned long long core;
+            const char *field = parseNumber(position + 3, lineEnd, core);
+            // user nice system idle iowait irq softirq steal, guest time is already in user.
+            unsigned long long values[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            for(int i = 0; i < 8 && field < lineEnd; i++)
+                field = parseNumber(skipSpaces(field, lineEnd), lineEnd, values[i]);
+            if(core < coresTotal)
+            {
+                const unsigned long long idle = values[3] + values[4];
+                const unsigned long long busy = values[0] + values[1] + values[2] + values[5] + values[6] + values[7];
+                const unsigned long long total = busy + idle;
+                this->listed[core] = 1;
+                // Reads faster than USER_HZ often see no new jiffies, the load and baseline stay
+                //until the total advances.
+                if(total != this->previousTotal[core])
+                {
+                    if(this->previousTotal[core] != 0 && total > this->previousTotal[core] && busy >= this->previousBusy[core])
+                        this->loads[core] = 100.0f*float(busy - this->previousBusy[core])/float(total - this->previousTotal[core]);
+                    else
+                        this->loads[core] = -1.0f;
+                    this->previousBusy[core] = busy;
+                    this->previousTotal[core] = total;
+                }
+            }
+        }
+        else if(!isCpuLine)
+            break;
+        position = lineEnd + 1;
+    }
+    // Offline cores have no line.
+    for(size_t core = 0; core < coresTotal; core++)
+    {
+        if(!this->listed[core])
+            this->loads[core] = -1.0f;
+    }
+    return true;
+}
+
+float ProcStatReader::getLoad(int coreNumber) const
+{
+    return this->loads[size_t(coreNumber)];
+}
+
+const float *ProcStatReader::loadData() const
+{
+    return this->loads.data();
+}
@@ -0,0 +1,37 @@
+#ifndef PROCSTATREADER_H
+#define PROCSTATREADER_H
+
+#include <vector>
+
+#include "sysfsattribute.h"
+
+// Per-core utilization from /proc/stat jiffies.
+// The file is kept open and read into a reusable buffer every update(),
+//cpuN lines are parsed in place without allocations.
+class ProcStatReader
+{
+private:
+    SysfsAttribute statFile;
+    std::vector<char> buffer;
+
+    // Previous busy and total jiffies of every core.
+    std::vector<unsigned long long> previousBusy;
+    std::vector<unsigned long long> previousTotal;
+    // Busy time of the last interval in percents, negative when unknown
+    //(core is offline or this is the first read). Kept while reads land in the same jiffy.
+    std::vector<float> loads;
+    // Cores with a cpuN line in the current read.
+    std::vector<char> listed;
+
+    ssize_t readAll();
+
+public:
+    explicit ProcStatReader(int coresTotal);
+
+    bool isOpen() const;
+    bool update();
+    float getLoad(int coreNumber) const;
+    const float *loadData() const;
+};
+
+#endif // PROCSTATREADER_H
@@ -0,0 +1,292 @@
+#include "profilefile.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include "governortable.h"
+
+const int ProfileFile::defaultInterval;
+
+namespace
+{
+const char fileHeader[] = "# LinuxCpuInstruments profiles";
+
+bool sameState(const ProfileRule &first, const ProfileRule &second)
+{
+    return first.fields == second.fields
+            && (!(first.fields & ProfileRule::OnlineField) || first.online == second.online)
+            && (!(first.fields & ProfileRule::MinScalingField) || first.minScalingFrequence == second.minScalingFrequence)
+            && (!(first.fields & ProfileRule::MaxScalingField) || first.maxScalingFrequence == second.maxScalingFrequence)
+            && (!(first.fields & ProfileRule::GovernorField) || first.governor == second.governor);
+}
+}
+
+ProfileRule::ProfileRule():
+    firstCore(0),
+    lastCore(-1),
+    fields(0),
+    online(true),
+    minScalingFrequence(0),
+    maxScalingFrequence(0)
+{
+}
+
+ProfileFile::ProfileFile():
+    interval(defaultInterval)
+{
+}
+
+bool ProfileFile::load(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        this->error = "Cannot open " + path + ": " + file.errorString();
+        return false;
+    }
+    QVector<Profile> loaded;
+    int loadedInterval = defaultInterval;
+    QTextStream fileStream(&file);
+    int lineNumber = 0;
+    while(!fileStream.atEnd())
+    {
+        const QString line = fileStream.readLine().trimmed();
+        lineNumber++;
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        const QString location = "Line " + QString::number(lineNumber) + ": ";
+        if(line.startsWith('['))
+        {
+            if(!line.endsWith(']') || line.size() < 3)
+            {
+                this->error = location + "profile name must be written as [name].";
+                return false;
+            }
+            Profile profile;
+            profile.name = line.mid(1, line.size() - 2).trimmed();
+            loaded.push_back(profile);
+            continue;
+        }
+        if(line.startsWith("interval "))
+        {
+            bool success = false;
+            loadedInterval = line.section(' ', 1).trimmed().toInt(&success);
+            if(!success || loadedInterval < 1)
+            {
+                this->error = location + "interval must be a positive number of milliseconds.";
+                return false;
+            }
+            continue;
+        }
+        if(loaded.isEmpty())
+        {
+            this->error = location + "rule outside of a profile.";
+            return false;
+        }
+        ProfileRule rule;
+        if(!parseRule(line, rule))
+        {
+            this->error = location + this->error;
+            return false;
+        }
+        loaded.back().rules.push_back(rule);
+    }
+    this->profiles = loaded;
+    this->interval = loadedInterval;
+    return true;
+}
+
+bool ProfileFile::parseRule(const QString &line, ProfileRule &rule)
+{
+    // Empty parts of repeated spaces are dropped here, SkipEmptyParts moved between Qt versions.
+    QStringList tokens;
+    for(const QString &token: line.split(' '))
+    {
+        if(!token.isEmpty())
+            tokens.push_back(token);
+    }
+    const QString &range = tokens[0];
+    bool success = true;
+    if(range == "all")
+    {
+        rule.firstCore = 0;
+        rule.lastCore = -1;
+    }
+    else if(range.contains('-'))
+    {
+        bool lastSuccess = true;
+        rule.firstCore = range.section('-', 0, 0).toInt(&success);
+        rule.lastCore = range.section('-', 1, 1).toInt(&lastSuccess);
+        success = success && lastSuccess && rule.firstCore >= 0 && rule.lastCore >= rule.firstCore;
+    }
+    else
+    {
+        rule.firstCore = range.toInt(&success);
+        rule.lastCore = rule.firstCore;
+        success = success && rule.firstCore >= 0;
+    }
+    if(!success)
+    {
+        this->error = "cores must be all, a number or a range like 0-3.";
+        return false;
+    }
+    for(int i = 1; i < tokens.size(); i++)
+    {
+        const QString key = tokens[i].section('=', 0, 0);
+        const QString value = tokens[i].section('=', 1);
+        if(value.isEmpty())
+        {
+            this->error = "attribute " + key + " has no value.";
+            return false;
+        }
+        if(key == "governor")
+        {
+            rule.fields |= ProfileRule::GovernorField;
+            rule.governor = value;
+        }
+        else if(key == "min")
+        {
+            rule.fields |= ProfileRule::MinScalingField;
+            rule.minScalingFrequence = value.toUInt(&success);
+        }
+        else if(key == "max")
+        {
+            rule.fields |= ProfileRule::MaxScalingField;
+            rule.maxScalingFrequence = value.toUInt(&success);
+        }
+        else if(key == "online")
+        {
+            rule.fields |= ProfileRule::OnlineField;
+            rule.online = value == "1";
+            success = value == "1" || value == "0";
+        }
+        else
+        {
+            this->error = "unknown attribute " + key + ", use governor, min, max or online.";
+            return false;
+        }
+        if(!success)
+        {
+            this->error = "wrong value of " + key + ".";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProfileFile::save(const QString &path) const
+{
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        this->error = "Cannot write " + path + ": " + file.errorString();
+        return false;
+    }
+    QTextStream fileStream(&file);
+    fileStream << fileHeader << "\n";
+    fileStream << "interval " << this->interval << "\n";
+    for(const Profile &profile: this->profiles)
+    {
+        fileStream << "\n[" << profile.name << "]\n";
+        for(const ProfileRule &rule: profile.rules)
+        {
+            if(rule.lastCore < 0)
+                fileStream << "all";
+            else if(rule.lastCore == rule.firstCore)
+                fileStream << rule.firstCore;
+            else
+                fileStream << rule.firstCore << "-" << rule.lastCore;
+            if(rule.fields & ProfileRule::GovernorField)
+                fileStream << " governor=" << rule.governor;
+            if(rule.fields & ProfileRule::MinScalingField)
+                fileStream << " min=" << rule.minScalingFrequence;
+            if(rule.fields & ProfileRule::MaxScalingField)
+                fileStream << " max=" << rule.maxScalingFrequence;
+            if(rule.fields & ProfileRule::OnlineField)
+                fileStream << " online=" << (rule.online ? 1 : 0);
+            fileStream << "\n";
+        }
+    }
+    fileStream.flush();
+    if(fileStream.status() != QTextStream::Ok)
+    {
+        this->error = "Cannot write " + path + ".";
+        return false;
+    }
+    return true;
+}
+
+QString ProfileFile::errorString() const
+{
+    return this->error;
+}
+
+const QVector<Profile> &ProfileFile::getProfiles() const
+{
+    return this->profiles;
+}
+
+const Profile *ProfileFile::find(const QString &name) const
+{
+    for(const Profile &profile: this->profiles)
+    {
+        if(profile.name == name)
+            return &profile;
+    }
+    return nullptr;
+}
+
+void ProfileFile::setProfile(const Profile &profile)
+{
+    for(Profile &existing: this->profiles)
+    {
+        if(existing.name == profile.name)
+        {
+            existing = profile;
+            return;
+        }
+    }
+    this->profiles.push_back(profile);
+}
+
+int ProfileFile::getInterval() const
+{
+    return this->interval;
+}
+
+void ProfileFile::setInterval(int interval)
+{
+    this->interval = interval;
+}
+
+Profile ProfileFile::capture(const QString &name, const CoreStateStore &store)
+{
+    Profile profile;
+    profile.name = name;
+    for(int i = 0; i < store.size(); i++)
+    {
+        ProfileRule rule;
+        rule.firstCore = i;
+        rule.lastCore = i;
+        rule.fields = ProfileRule::OnlineField;
+        rule.online = store.online[i] != 0;
+        // cpufreq attributes of an offline core are unknown.
+        if(rule.online)
+        {
+            rule.fields |= ProfileRule::MinScalingField | ProfileRule::MaxScalingField;
+            rule.minScalingFrequence = store.minScalingFrequences[i];
+            rule.maxScalingFrequence = store.maxScalingFrequences[i];
+            if(store.governors[i] != GovernorTable::unknownGovernor)
+            {
+                rule.fields |= ProfileRule::GovernorField;
+                rule.governor = GovernorTable::instance().name(store.governors[i]);
+            }
+        }
+        if(!profile.rules.isEmpty() && profile.rules.back().lastCore == i - 1 && sameState(profile.rules.back(), rule))
+            profile.rules.back().lastCore = i;
+        else
+            profile.rules.push_back(rule);
+    }
+    return profile;
+}
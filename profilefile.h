@@ -0,0 +1,79 @@
+#ifndef PROFILEFILE_H
+#define PROFILEFILE_H
+
+#include <QString>
+#include <QVector>
+
+#include "corestatestore.h"
+
+// Desired state of a range of logic cores, attributes without their field bit are left alone.
+struct ProfileRule
+{
+    enum Field
+    {
+        OnlineField = 1,
+        MinScalingField = 2,
+        MaxScalingField = 4,
+        GovernorField = 8
+    };
+
+    int firstCore;
+    // Inclusive, -1 means up to the last core.
+    int lastCore;
+    quint32 fields;
+    bool online;
+    uint minScalingFrequence;
+    uint maxScalingFrequence;
+    QString governor;
+
+    ProfileRule();
+};
+
+struct Profile
+{
+    QString name;
+    // Later rules override earlier ones for the cores they share.
+    QVector<ProfileRule> rules;
+};
+
+// Named profiles in a text file, written by hand or by "Save configuration":
+//
+//  # Comment
+//  interval 5000
+//  [balanced]
+//  all governor=schedutil
+//  0-3 min=800000 max=2400000
+//  7 online=0
+//
+// Frequences are in kHz like in sysfs, interval is the reconciliation period in milliseconds.
+class ProfileFile
+{
+public:
+    static const int defaultInterval = 5000;
+
+    ProfileFile();
+
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+    QString errorString() const;
+
+    const QVector<Profile> &getProfiles() const;
+    // Nullptr when there is no profile with this name.
+    const Profile *find(const QString &name) const;
+    // Replaces the profile with the same name or appends it.
+    void setProfile(const Profile &profile);
+    int getInterval() const;
+    void setInterval(int interval);
+
+    // Profile with the current state of every core, consecutive cores with equal state share a rule.
+    static Profile capture(const QString &name, const CoreStateStore &store);
+
+private:
+    QVector<Profile> profiles;
+    int interval;
+    mutable QString error;
+
+    bool parseRule(const QString &line, ProfileRule &rule);
+};
+
+#endif // PROFILEFILE_H
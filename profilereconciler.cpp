@@ -0,0 +1,251 @@
+#include "profilereconciler.h"
+
+#include "governortable.h"
+#include "samplingplan.h"
+#include "trace.h"
+
+const int ProfileReconciler::driftLogCapacity;
+
+ProfileReconciler::ProfileReconciler(CoreSampler &coreSampler, BulkApplier &bulkApplier):
+    coreSampler(coreSampler),
+    bulkApplier(bulkApplier),
+    interval(0),
+    settledTimestamp(0),
+    initial(true),
+    checks(0),
+    drifts(0),
+    log(driftLogCapacity),
+    logged(0)
+{
+}
+
+void ProfileReconciler::setProfile(const Profile &profile, int interval)
+{
+    const int coresTotal = this->coreSampler.coresTotal();
+    this->name = profile.name;
+    this->interval = qint64(interval)*1000000;
+    this->settledTimestamp = 0;
+    this->initial = true;
+    this->desired.fill(Desired(), coresTotal);
+    for(Desired &target: this->desired)
+        target.fields = 0;
+    for(const ProfileRule &rule: profile.rules)
+    {
+        const int last = rule.lastCore < 0 || rule.lastCore >= coresTotal ? coresTotal - 1 : rule.lastCore;
+        for(int i = rule.firstCore; i <= last; i++)
+        {
+            Desired &target = this->desired[i];
+            target.fields |= rule.fields;
+            if(rule.fields & ProfileRule::OnlineField)
+                target.online = rule.online;
+            if(rule.fields & ProfileRule::MinScalingField)
+                target.minScalingFrequence = rule.minScalingFrequence;
+            if(rule.fields & ProfileRule::MaxScalingField)
+                target.maxScalingFrequence = rule.maxScalingFrequence;
+            if(rule.fields & ProfileRule::GovernorField)
+                target.governorName = rule.governor;
+        }
+    }
+    const quint32 policyFields = ProfileRule::MinScalingField | ProfileRule::MaxScalingField | ProfileRule::GovernorField;
+    for(int i = 0; i < coresTotal; i++)
+    {
+        // Cores of one policy share its files, different values for them would be rewritten forever,
+        //so the policy leader's values win.
+        Desired &target = this->desired[i];
+        const int leader = int(this->coreSampler.logicCore(i).getPolicyLeaderNumber());
+        if(leader != i && leader < coresTotal)
+        {
+            const Desired &leaderTarget = this->desired[leader];
+            target.fields = (target.fields & ~policyFields) | (leaderTarget.fields & policyFields);
+            target.minScalingFrequence = leaderTarget.minScalingFrequence;
+            target.maxScalingFrequence = leaderTarget.maxScalingFrequence;
+            target.governorName = leaderTarget.governorName;
+        }
+        target.governor = GovernorTable::instance().find(target.governorName);
+    }
+}
+
+void ProfileReconciler::clear()
+{
+    this->name.clear();
+    this->desired.clear();
+}
+
+bool ProfileReconciler::isActive() const
+{
+    return !this->desired.isEmpty();
+}
+
+const QString &ProfileReconciler::profileName() const
+{
+    return this->name;
+}
+
+QVector<int> ProfileReconciler::cores() const
+{
+    QVector<int> managed;
+    for(int i = 0; i < this->desired.size(); i++)
+    {
+        if(this->desired[i].fields != 0)
+            managed.push_back(i);
+    }
+    return managed;
+}
+
+quint32 ProfileReconciler::attributes() const
+{
+    // Online state decides whether cpufreq attributes can be compared at all.
+    quint32 attributes = SamplingPlan::attribute(LogicCore::OnlineAttribute);
+    for(const Desired &target: this->desired)
+    {
+        if(target.fields & ProfileRule::MinScalingField)
+            attributes |= SamplingPlan::attribute(LogicCore::ScalingMinAttribute);
+        if(target.fields & ProfileRule::MaxScalingField)
+            attributes |= SamplingPlan::attribute(LogicCore::ScalingMaxAttribute);
+        if(target.fields & ProfileRule::GovernorField)
+            attributes |= SamplingPlan::attribute(LogicCore::GovernorAttribute);
+    }
+    return attributes;
+}
+
+int ProfileReconciler::reconcile(const CoreStateStore &current)
+{
+    TRACE_SCOPE("ProfileReconciler::reconcile");
+    if(this->desired.isEmpty() || current.timestamp < this->settledTimestamp)
+        return 0;
+    this->checks++;
+    this->applyCores.clear();
+    this->applySettings.clear();
+    QVector<DriftEntry> found;
+    const int coresTotal = qMin(this->desired.size(), current.size());
+    for(int i = 0; i < coresTotal; i++)
+    {
+        Desired &target = this->desired[i];
+        if(target.fields == 0)
+            continue;
+        const bool online = i == 0 || current.online[i] != 0;
+        // Core 0 has no online parameter.
+        const bool targetOnline = i == 0 || (target.fields & ProfileRule::OnlineField ? target.online : online);
+        DriftEntry entry;
+        entry.timestamp = current.timestamp;
+        entry.coreNumber = uint(i);
+        entry.drifted = !this->initial;
+        const int foundBefore = found.size();
+        if(online != targetOnline)
+        {
+            entry.attribute = "online";
+            entry.expected = targetOnline ? "1" : "0";
+            entry.found = online ? "1" : "0";
+            found.push_back(entry);
+        }
+        LogicCore::ApplySettings settings;
+        settings.online = targetOnline;
+        settings.minScalingFrequence = current.minScalingFrequences[i];
+        settings.maxScalingFrequence = current.maxScalingFrequences[i];
+        settings.governor = GovernorTable::unknownGovernor;
+        settings.idleStatesMask = 0;
+        // Attributes of a core going online are compared by the next check, the snapshot has none.
+        if(online && targetOnline)
+        {
+            if(target.fields & ProfileRule::MinScalingField && target.minScalingFrequence != current.minScalingFrequences[i])
+            {
+                entry.attribute = "scaling_min_freq";
+                entry.expected = QString::number(target.minScalingFrequence);
+                entry.found = QString::number(current.minScalingFrequences[i]);
+                found.push_back(entry);
+                settings.minScalingFrequence = target.minScalingFrequence;
+            }
+            if(target.fields & ProfileRule::MaxScalingField && target.maxScalingFrequence != current.maxScalingFrequences[i])
+            {
+                entry.attribute = "scaling_max_freq";
+                entry.expected = QString::number(target.maxScalingFrequence);
+                entry.found = QString::number(current.maxScalingFrequences[i]);
+                found.push_back(entry);
+                settings.maxScalingFrequence = target.maxScalingFrequence;
+            }
+            if(target.fields & ProfileRule::GovernorField && target.governor == GovernorTable::unknownGovernor)
+            {
+                // Name wasn't seen on any core yet, it may show up after a driver is loaded.
+                target.governor = GovernorTable::instance().find(target.governorName);
+            }
+            if(target.fields & ProfileRule::GovernorField && target.governor != current.governors[i])
+            {
+                entry.attribute = "scaling_governor";
+                entry.expected = target.governorName;
+                entry.found = GovernorTable::instance().name(current.governors[i]);
+                if(target.governor == GovernorTable::unknownGovernor)
+                    entry.error = "Governor is not available on this core.";
+                found.push_back(entry);
+                settings.governor = target.governor;
+            }
+        }
+        if(found.size() == foundBefore)
+            continue;
+        this->applyCores.push_back(&this->coreSampler.logicCore(i));
+        this->applySettings.push_back(settings);
+    }
+    if(found.isEmpty())
+    {
+        this->initial = false;
+        return 0;
+    }
+
+    QVector<BulkApplier::Result> results = this->bulkApplier.apply(this->applyCores, this->applySettings, current);
+    this->settledTimestamp = CoreSampler::monotonicTime() + this->interval;
+    int result = 0;
+    for(DriftEntry &entry: found)
+    {
+        while(results[result].coreNumber != entry.coreNumber)
+            result++;
+        if(entry.error.isEmpty())
+            entry.error = results[result].error;
+    }
+    // A failing attribute would fill the log every check, it's logged again only when the error changes.
+    for(const DriftEntry &entry: found)
+    {
+        if(entry.error.isEmpty() || entry.error != this->desired[int(entry.coreNumber)].error)
+            appendLog(entry);
+    }
+    for(const BulkApplier::Result &coreResult: results)
+        this->desired[int(coreResult.coreNumber)].error.clear();
+    for(const DriftEntry &entry: found)
+    {
+        if(!entry.error.isEmpty())
+            this->desired[int(entry.coreNumber)].error = entry.error;
+    }
+    if(!this->initial)
+        this->drifts += quint64(found.size());
+    this->initial = false;
+    return found.size();
+}
+
+void ProfileReconciler::appendLog(const DriftEntry &entry)
+{
+    this->log[int(this->logged % driftLogCapacity)] = entry;
+    this->logged++;
+}
+
+quint64 ProfileReconciler::checksTotal() const
+{
+    return this->checks;
+}
+
+quint64 ProfileReconciler::driftsTotal() const
+{
+    return this->drifts;
+}
+
+quint64 ProfileReconciler::logTotal() const
+{
+    return this->logged;
+}
+
+quint64 ProfileReconciler::oldestLogEntry() const
+{
+    return this->logged > quint64(driftLogCapacity) ? this->logged - driftLogCapacity : 0;
+}
+
+const ProfileReconciler::DriftEntry &ProfileReconciler::logEntry(quint64 index) const
+{
+    return this->log[int(index % driftLogCapacity)];
+}
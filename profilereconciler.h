@@ -0,0 +1,91 @@
+#ifndef PROFILERECONCILER_H
+#define PROFILERECONCILER_H
+
+#include <QString>
+#include <QVector>
+
+#include "profilefile.h"
+#include "coresampler.h"
+#include "bulkapplier.h"
+
+// Keeps logic cores on a profile. Every check compares the desired state with the latest snapshot
+//and writes only attributes that differ, through BulkApplier and LogicCore::apply().
+// When nothing drifted a check is a walk over a few arrays, sysfs isn't touched at all.
+class ProfileReconciler
+{
+public:
+    struct DriftEntry
+    {
+        // CLOCK_MONOTONIC time of the snapshot that showed the difference, nanoseconds.
+        qint64 timestamp;
+        uint coreNumber;
+        // Sysfs name of the attribute.
+        const char *attribute;
+        QString expected;
+        QString found;
+        // False for differences found right after the profile was set.
+        bool drifted;
+        // Empty when the attribute was written.
+        QString error;
+    };
+    static const int driftLogCapacity = 1024;
+
+    ProfileReconciler(CoreSampler &coreSampler, BulkApplier &bulkApplier);
+    ProfileReconciler(const ProfileReconciler &) = delete;
+    ProfileReconciler &operator=(const ProfileReconciler &) = delete;
+
+    // Interval is in milliseconds, the caller checks that often and keeps the profile's attributes
+    //subscribed at it (see cores() and attributes()).
+    void setProfile(const Profile &profile, int interval);
+    void clear();
+    bool isActive() const;
+    const QString &profileName() const;
+    QVector<int> cores() const;
+    quint32 attributes() const;
+
+    // Returns the number of attributes that differed. Snapshots older than the last write plus
+    //the interval are skipped, they may still show values from before it.
+    int reconcile(const CoreStateStore &current);
+
+    quint64 checksTotal() const;
+    quint64 driftsTotal() const;
+    // Entries ever logged, the newest driftLogCapacity of them are kept.
+    quint64 logTotal() const;
+    // Index must be in [logTotal() - kept entries, logTotal()).
+    const DriftEntry &logEntry(quint64 index) const;
+    quint64 oldestLogEntry() const;
+
+private:
+    struct Desired
+    {
+        quint32 fields;
+        bool online;
+        uint minScalingFrequence;
+        uint maxScalingFrequence;
+        // Resolved when the profile is set, unknownGovernor when the name was never seen.
+        quint8 governor;
+        QString governorName;
+        // Last apply error, logged again only when it changes.
+        QString error;
+    };
+
+    CoreSampler &coreSampler;
+    BulkApplier &bulkApplier;
+    QString name;
+    QVector<Desired> desired;
+    qint64 interval;
+    // Checks are skipped until a snapshot taken at this time.
+    qint64 settledTimestamp;
+    bool initial;
+    quint64 checks;
+    quint64 drifts;
+    QVector<DriftEntry> log;
+    quint64 logged;
+    // Reused by every check.
+    QVector<const LogicCore*> applyCores;
+    QVector<LogicCore::ApplySettings> applySettings;
+
+    void appendLog(const DriftEntry &entry);
+};
+
+#endif // PROFILERECONCILER_H
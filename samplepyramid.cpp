@@ -0,0 +1,126 @@
+#include "samplepyramid.h"
+
+SamplePyramid::SamplePyramid(int bucketsPerLevel):
+    bucketsPerLevel(bucketsPerLevel < 1 ? 1 : bucketsPerLevel)
+{
+    this->buckets.resize(levelsTotal*this->bucketsPerLevel);
+    clear();
+}
+
+void SamplePyramid::clear()
+{
+    for(int level = 0; level < levelsTotal; level++)
+    {
+        this->written[level] = 0;
+        this->pending[level].count = 0;
+    }
+}
+
+quint64 SamplePyramid::samplesTotal() const
+{
+    return this->written[0];
+}
+
+size_t SamplePyramid::memoryUsage() const
+{
+    return sizeof(SamplePyramid) + size_t(this->buckets.size())*sizeof(Bucket);
+}
+
+void SamplePyramid::add(quint32 value)
+{
+    Bucket sample;
+    sample.minimum = value;
+    sample.maximum = value;
+    sample.average = value;
+    push(0, sample);
+}
+
+void SamplePyramid::push(int level, Bucket bucket)
+{
+    for(;;)
+    {
+        this->buckets[level*this->bucketsPerLevel + int(this->written[level] % quint64(this->bucketsPerLevel))] = bucket;
+        this->written[level]++;
+        if(level + 1 == levelsTotal)
+            return;
+
+        Accumulator &parent = this->pending[level + 1];
+        if(parent.count == 0)
+        {
+            parent.minimum = bucket.minimum;
+            parent.maximum = bucket.maximum;
+            parent.sum = 0;
+        }
+        else
+        {
+            if(bucket.minimum < parent.minimum)
+                parent.minimum = bucket.minimum;
+            if(bucket.maximum > parent.maximum)
+                parent.maximum = bucket.maximum;
+        }
+        // Merged buckets always hold the same number of samples, so the average of averages is exact.
+        parent.sum += bucket.average;
+        if(++parent.count < fanout)
+            return;
+        bucket.minimum = parent.minimum;
+        bucket.maximum = parent.maximum;
+        bucket.average = quint32(parent.sum/fanout);
+        parent.count = 0;
+        level++;
+    }
+}
+
+quint64 SamplePyramid::query(quint64 span, int maxBuckets, QVector<Bucket> &result, quint64 &newestSamples) const
+{
+    if(maxBuckets > this->bucketsPerLevel)
+        maxBuckets = this->bucketsPerLevel;
+    if(maxBuckets < 1)
+        maxBuckets = 1;
+    int level = 0;
+    quint64 samplesPerBucket = 1;
+    while(level + 1 < levelsTotal && (span + samplesPerBucket - 1)/samplesPerBucket > quint64(maxBuckets))
+    {
+        level++;
+        samplesPerBucket *= fanout;
+    }
+
+    // Samples newer than the last whole bucket of the level wait in accumulators of every level up to it,
+    //pending[N] holds buckets of fanout^(N-1) samples each.
+    Bucket partial;
+    quint64 partialSamples = 0;
+    quint64 partialSum = 0;
+    quint64 weight = 1;
+    for(int below = 1; below <= level; below++, weight *= fanout)
+    {
+        const Accumulator &accumulator = this->pending[below];
+        if(accumulator.count == 0)
+            continue;
+        if(partialSamples == 0 || accumulator.minimum < partial.minimum)
+            partial.minimum = accumulator.minimum;
+        if(partialSamples == 0 || accumulator.maximum > partial.maximum)
+            partial.maximum = accumulator.maximum;
+        partialSamples += quint64(accumulator.count)*weight;
+        partialSum += accumulator.sum*weight;
+    }
+    const quint64 wholeSpan = span > partialSamples ? span - partialSamples : 0;
+    const int partialCount = partialSamples > 0 ? 1 : 0;
+    quint64 count = (wholeSpan + samplesPerBucket - 1)/samplesPerBucket;
+    if(count > quint64(maxBuckets - partialCount))
+        count = quint64(maxBuckets - partialCount);
+    if(count > this->written[level])
+        count = this->written[level];
+
+    // Result keeps its capacity between calls, nothing is allocated once it has grown.
+    result.resize(int(count) + partialCount);
+    const Bucket *levelBuckets = this->buckets.constData() + level*this->bucketsPerLevel;
+    const quint64 first = this->written[level] - count;
+    for(int i = 0; i < int(count); i++)
+        result[i] = levelBuckets[(first + quint64(i)) % quint64(this->bucketsPerLevel)];
+    if(partialCount > 0)
+    {
+        partial.average = quint32(partialSum/partialSamples);
+        result[int(count)] = partial;
+    }
+    newestSamples = partialCount > 0 ? partialSamples : samplesPerBucket;
+    return samplesPerBucket;
+}
@@ -0,0 +1,61 @@
+#ifndef SAMPLEPYRAMID_H
+#define SAMPLEPYRAMID_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Level-of-detail history of one series with min/max/avg per bucket.
+// Level 0 keeps single samples, every next level merges `fanout` buckets of the previous one.
+//Each level is a ring of bucketsPerLevel buckets, so memory is fixed after construction:
+//levelsTotal*bucketsPerLevel*sizeof(Bucket) bytes, 9*512*12 = 54 KiB per series by default.
+// With the defaults the top level spans 512*4^8 = 33.5M samples, 93 hours at 10 ms.
+class SamplePyramid
+{
+public:
+    struct Bucket
+    {
+        quint32 minimum;
+        quint32 maximum;
+        quint32 average;
+    };
+
+    static const int fanout = 4;
+    static const int levelsTotal = 9;
+
+    explicit SamplePyramid(int bucketsPerLevel = 512);
+
+    // Amortized O(1), a merge into level N happens once per fanout^N samples.
+    void add(quint32 value);
+    void clear();
+    quint64 samplesTotal() const;
+    size_t memoryUsage() const;
+
+    // Latest buckets covering up to `span` samples, oldest first, at most maxBuckets of them
+    //(fewer when the history is shorter). The finest level that fits is used,
+    //so the result has between maxBuckets/fanout and maxBuckets entries for long histories.
+    // The newest bucket may be partial, merged from samples that didn't fill a whole bucket of the level yet,
+    //so the result always reaches the latest sample. newestSamples is its size in samples.
+    // Returns samples per bucket.
+    quint64 query(quint64 span, int maxBuckets, QVector<Bucket> &result, quint64 &newestSamples) const;
+
+private:
+    // Buckets of the level below, not yet merged into a whole bucket of this level.
+    struct Accumulator
+    {
+        quint32 minimum;
+        quint32 maximum;
+        quint64 sum;
+        int count;
+    };
+
+    int bucketsPerLevel;
+    // Indexed by level*bucketsPerLevel + slot.
+    QVector<Bucket> buckets;
+    // Buckets ever completed on each level.
+    quint64 written[levelsTotal];
+    Accumulator pending[levelsTotal];
+
+    void push(int level, Bucket bucket);
+};
+
+#endif // SAMPLEPYRAMID_H
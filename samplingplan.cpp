@@ -0,0 +1,169 @@
+#include "samplingplan.h"
+
+const quint32 SamplingPlan::loadAttribute;
+const quint32 SamplingPlan::residencyAttribute;
+const quint32 SamplingPlan::powerAttribute;
+const quint32 SamplingPlan::taskAttribute;
+const quint32 SamplingPlan::idleAttribute;
+const quint32 SamplingPlan::allAttributes;
+
+quint32 SamplingPlan::attribute(LogicCore::SampledAttribute sampledAttribute)
+{
+    return 1u << sampledAttribute;
+}
+
+namespace
+{
+qint64 nextMultiple(qint64 now, qint64 interval)
+{
+    return (now/interval + 1)*interval;
+}
+
+bool isPolicyAttribute(int attribute)
+{
+    return attribute == LogicCore::ScalingMaxAttribute || attribute == LogicCore::ScalingMinAttribute
+            || attribute == LogicCore::GovernorAttribute;
+}
+}
+
+void SamplingPlan::build(const QVector<Subscription> &subscriptions, const QVector<LogicCore*> &logicCores, qint64 now)
+{
+    const int coresTotal = logicCores.size();
+    const int stride = LogicCore::SampledAttributeCount;
+    // Shortest requested interval of every slot, 0 when nobody asks for it.
+    std::vector<qint64> slotIntervals(size_t(coresTotal*stride), 0);
+    std::vector<qint64> residencyIntervals(size_t(coresTotal), 0);
+    std::vector<qint64> idleIntervals(size_t(coresTotal), 0);
+    qint64 loadInterval = 0;
+    qint64 powerInterval = 0;
+    qint64 taskInterval = 0;
+    for(const Subscription &subscription: subscriptions)
+    {
+        if(subscription.interval <= 0)
+            continue;
+        if(subscription.attributes & loadAttribute && (loadInterval == 0 || subscription.interval < loadInterval))
+            loadInterval = subscription.interval;
+        if(subscription.attributes & powerAttribute && (powerInterval == 0 || subscription.interval < powerInterval))
+            powerInterval = subscription.interval;
+        if(subscription.attributes & taskAttribute && (taskInterval == 0 || subscription.interval < taskInterval))
+            taskInterval = subscription.interval;
+        const int coresListed = subscription.cores.isEmpty() ? coresTotal : subscription.cores.size();
+        for(int i = 0; i < coresListed; i++)
+        {
+            const int core = subscription.cores.isEmpty() ? i : subscription.cores[i];
+            if(core < 0 || core >= coresTotal)
+                continue;
+            qint64 &residencyInterval = residencyIntervals[size_t(core)];
+            if(subscription.attributes & residencyAttribute && (residencyInterval == 0 || subscription.interval < residencyInterval))
+                residencyInterval = subscription.interval;
+            qint64 &idleInterval = idleIntervals[size_t(core)];
+            if(subscription.attributes & idleAttribute && (idleInterval == 0 || subscription.interval < idleInterval))
+                idleInterval = subscription.interval;
+            for(int attribute = 0; attribute < stride; attribute++)
+            {
+                if(!(subscription.attributes & (1u << attribute)))
+                    continue;
+                int readingCore = core;
+                if(isPolicyAttribute(attribute))
+                    readingCore = int(logicCores[core]->getSamplingLeaderNumber());
+                qint64 &interval = slotIntervals[size_t(readingCore*stride + attribute)];
+                if(interval == 0 || subscription.interval < interval)
+                    interval = subscription.interval;
+            }
+        }
+    }
+
+    this->groups.clear();
+    for(size_t slot = 0; slot < slotIntervals.size(); slot++)
+    {
+        if(slotIntervals[slot] == 0)
+            continue;
+        Group &group = groupFor(slotIntervals[slot], now);
+        group.readSlots.push_back(uint(slot));
+        const int core = int(slot)/stride;
+        if(group.cores.empty() || group.cores.back() != core)
+            group.cores.push_back(core);
+    }
+    for(int core = 0; core < coresTotal; core++)
+    {
+        if(residencyIntervals[size_t(core)] != 0)
+            groupFor(residencyIntervals[size_t(core)], now).residencyCores.push_back(core);
+        if(idleIntervals[size_t(core)] != 0)
+            groupFor(idleIntervals[size_t(core)], now).idleCores.push_back(core);
+    }
+    if(loadInterval != 0)
+        groupFor(loadInterval, now).load = true;
+    if(powerInterval != 0)
+        groupFor(powerInterval, now).power = true;
+    if(taskInterval != 0)
+        groupFor(taskInterval, now).tasks = true;
+    this->coreCollected.assign(size_t(coresTotal), 0);
+}
+
+SamplingPlan::Group &SamplingPlan::groupFor(qint64 interval, qint64 now)
+{
+    for(Group &group: this->groups)
+    {
+        if(group.interval == interval)
+            return group;
+    }
+    Group created;
+    created.interval = interval;
+    created.deadline = nextMultiple(now, interval);
+    created.load = false;
+    created.power = false;
+    created.tasks = false;
+    this->groups.push_back(created);
+    return this->groups.back();
+}
+
+bool SamplingPlan::isEmpty() const
+{
+    return this->groups.empty();
+}
+
+qint64 SamplingPlan::nextDeadline() const
+{
+    qint64 deadline = 0;
+    for(const Group &group: this->groups)
+    {
+        if(deadline == 0 || group.deadline < deadline)
+            deadline = group.deadline;
+    }
+    return deadline;
+}
+
+void SamplingPlan::collectDue(qint64 now, std::vector<uint> &readSlots, std::vector<int> &cores, bool &load,
+                              std::vector<int> &residencyCores, bool &power, bool &tasks, std::vector<int> &idleCores)
+{
+    readSlots.clear();
+    cores.clear();
+    load = false;
+    residencyCores.clear();
+    power = false;
+    tasks = false;
+    idleCores.clear();
+    for(Group &group: this->groups)
+    {
+        if(group.deadline > now)
+            continue;
+        readSlots.insert(readSlots.end(), group.readSlots.begin(), group.readSlots.end());
+        for(int core: group.cores)
+        {
+            if(this->coreCollected[size_t(core)])
+                continue;
+            this->coreCollected[size_t(core)] = 1;
+            cores.push_back(core);
+        }
+        load = load || group.load;
+        power = power || group.power;
+        tasks = tasks || group.tasks;
+        residencyCores.insert(residencyCores.end(), group.residencyCores.begin(), group.residencyCores.end());
+        idleCores.insert(idleCores.end(), group.idleCores.begin(), group.idleCores.end());
+        group.deadline += group.interval;
+        if(group.deadline <= now)
+            group.deadline = nextMultiple(now, group.interval);
+    }
+    for(int core: cores)
+        this->coreCollected[size_t(core)] = 0;
+}
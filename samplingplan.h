@@ -0,0 +1,69 @@
+#ifndef SAMPLINGPLAN_H
+#define SAMPLINGPLAN_H
+
+#include <vector>
+#include <QVector>
+
+#include "logiccore.h"
+
+// Coalesces view subscriptions into groups of sysfs reads with a common interval.
+// Every (core, attribute) pair is read at the shortest interval any subscription asks for,
+//deadlines are aligned to multiples of the interval so commensurate groups fire together.
+class SamplingPlan
+{
+public:
+    // Bit N is LogicCore::SampledAttribute N, loadAttribute stands for /proc/stat,
+    //residencyAttribute for cpufreq/stats of the core's policy (see FrequenceResidency),
+    //powerAttribute for thermal zones and RAPL counters, which like load don't depend on cores,
+    //taskAttribute for the /proc scan of TaskScanner. A scan costs more than the rest of a tick,
+    //so allAttributes leaves it out and only views showing tasks ask for it. idleAttribute reads
+    //cpuidle states of the core (see IdleStates), three files per state, it's left out the same way.
+    static const quint32 loadAttribute = 1u << LogicCore::SampledAttributeCount;
+    static const quint32 residencyAttribute = loadAttribute << 1;
+    static const quint32 powerAttribute = residencyAttribute << 1;
+    static const quint32 allAttributes = (powerAttribute << 1) - 1;
+    static const quint32 taskAttribute = powerAttribute << 1;
+    static const quint32 idleAttribute = taskAttribute << 1;
+    static quint32 attribute(LogicCore::SampledAttribute sampledAttribute);
+
+    struct Subscription
+    {
+        int id;
+        // Empty means every core.
+        QVector<int> cores;
+        quint32 attributes;
+        // Nanoseconds.
+        qint64 interval;
+    };
+
+    // Policy attributes of follower cores are read through their policy leader.
+    void build(const QVector<Subscription> &subscriptions, const QVector<LogicCore*> &logicCores, qint64 now);
+    bool isEmpty() const;
+    qint64 nextDeadline() const;
+    // Slots (core*SampledAttributeCount + attribute) and distinct cores of every group due at `now`.
+    //Deadlines of those groups move to their next future multiple, missed ticks are skipped.
+    void collectDue(qint64 now, std::vector<uint> &readSlots, std::vector<int> &cores, bool &load,
+                    std::vector<int> &residencyCores, bool &power, bool &tasks, std::vector<int> &idleCores);
+
+private:
+    struct Group
+    {
+        qint64 interval;
+        qint64 deadline;
+        std::vector<uint> readSlots;
+        std::vector<int> cores;
+        bool load;
+        std::vector<int> residencyCores;
+        bool power;
+        bool tasks;
+        std::vector<int> idleCores;
+    };
+
+    std::vector<Group> groups;
+    // Marks cores already collected in this collectDue() call.
+    std::vector<char> coreCollected;
+
+    Group &groupFor(qint64 interval, qint64 now);
+};
+
+#endif // SAMPLINGPLAN_H
@@ -0,0 +1,179 @@
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+/*
+ * Live core state published by LinuxCpuInstruments in a POSIX shared memory segment, native byte order.
+ * Plain C, usable from C and C++ readers without Qt; link with -lrt on old glibc.
+ *
+ * SharedStateHeader, then SharedStateCore for every core.
+ *
+ * The publisher rewrites everything after the header's `sequence` once per tick under a seqlock:
+ * odd sequence means a write is in progress. sharedStateRead() copies a consistent snapshot
+ * without syscalls or locks, retrying while a write overlaps the copy.
+ *
+ *  SharedStateReader reader;
+ *  if(sharedStateOpen(&reader, SHARED_STATE_DEFAULT_NAME) == 0)
+ *  {
+ *      SharedStateCore cores[256];
+ *      SharedStateTick tick;
+ *      int coresRead = sharedStateRead(&reader, &tick, cores, 256);
+ *      sharedStateClose(&reader);
+ *  }
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHARED_STATE_DEFAULT_NAME "/LinuxCpuInstruments"
+#define SHARED_STATE_MAGIC "LCISHM"
+#define SHARED_STATE_VERSION 1
+#define SHARED_STATE_GOVERNORS_CAPACITY 32
+#define SHARED_STATE_GOVERNOR_NAME_SIZE 32
+/* Readers give up after this many overlapped copies and return SHARED_STATE_BUSY. */
+#define SHARED_STATE_READ_ATTEMPTS 1000
+
+#define SHARED_STATE_BUSY (-2)
+#define SHARED_STATE_STALE (-3)
+
+typedef struct SharedStateCore
+{
+    /* kHz, like sysfs. */
+    uint32_t currentFrequence;
+    uint32_t minScalingFrequence;
+    uint32_t maxScalingFrequence;
+    uint32_t minCoreFrequence;
+    uint32_t maxCoreFrequence;
+    uint8_t online;
+    /* Index in SharedStateHeader::governorNames. */
+    uint8_t governor;
+    uint16_t reserved;
+    /* Busy time since the previous tick in percents, negative when unknown. */
+    float load;
+    uint32_t reserved2;
+} SharedStateCore;
+
+typedef struct SharedStateTick
+{
+    uint64_t tick;
+    /* CLOCK_MONOTONIC time of the tick start, nanoseconds. */
+    int64_t timestamp;
+    uint32_t governorsTotal;
+    uint32_t reserved;
+    /* NUL-terminated names, index is SharedStateCore::governor. */
+    char governorNames[SHARED_STATE_GOVERNORS_CAPACITY][SHARED_STATE_GOVERNOR_NAME_SIZE];
+} SharedStateTick;
+
+typedef struct SharedStateHeader
+{
+    /* Written once before the segment is published, never change. */
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t coresTotal;
+    uint32_t coreSize;
+    /* Cleared when the publisher exits; a new publisher creates a new segment under the same name. */
+    uint32_t alive;
+    uint32_t reserved;
+    /* Seqlock, on its own cache line. */
+    char sequencePadding[64 - 32];
+    uint64_t sequence;
+    char tickPadding[64 - 8];
+    SharedStateTick tick;
+} SharedStateHeader;
+
+typedef struct SharedStateReader
+{
+    const SharedStateHeader *header;
+    const SharedStateCore *cores;
+    size_t size;
+} SharedStateReader;
+
+/* Returns 0 or -1 with errno set (EPROTO for a segment of another layout version). */
+static inline int sharedStateOpen(SharedStateReader *reader, const char *name)
+{
+    struct stat status;
+    void *mapping;
+    const SharedStateHeader *header;
+    int descriptor = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    reader->header = NULL;
+    if(descriptor < 0)
+        return -1;
+    if(fstat(descriptor, &status) != 0 || (size_t)status.st_size < sizeof(SharedStateHeader))
+    {
+        close(descriptor);
+        return -1;
+    }
+    mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if(mapping == MAP_FAILED)
+        return -1;
+    header = (const SharedStateHeader *)mapping;
+    if(memcmp(header->magic, SHARED_STATE_MAGIC, sizeof(SHARED_STATE_MAGIC)) != 0 || header->version != SHARED_STATE_VERSION
+            || header->coreSize != sizeof(SharedStateCore)
+            || (size_t)status.st_size < header->headerSize + (size_t)header->coresTotal*header->coreSize)
+    {
+        munmap(mapping, (size_t)status.st_size);
+        errno = EPROTO;
+        return -1;
+    }
+    reader->header = header;
+    reader->cores = (const SharedStateCore *)((const char *)mapping + header->headerSize);
+    reader->size = (size_t)status.st_size;
+    return 0;
+}
+
+static inline void sharedStateClose(SharedStateReader *reader)
+{
+    if(reader->header != NULL)
+        munmap((void *)reader->header, reader->size);
+    reader->header = NULL;
+}
+
+static inline uint32_t sharedStateCoresTotal(const SharedStateReader *reader)
+{
+    return reader->header->coresTotal;
+}
+
+/*
+ * Copies the tick and up to `capacity` cores. Returns the number of cores copied,
+ * SHARED_STATE_BUSY when every attempt overlapped a write or SHARED_STATE_STALE when the publisher exited
+ * (close and open again to follow a new one). Either output may be NULL.
+ */
+static inline int sharedStateRead(const SharedStateReader *reader, SharedStateTick *tick, SharedStateCore *cores, uint32_t capacity)
+{
+    const SharedStateHeader *header = reader->header;
+    const uint32_t coresTotal = header->coresTotal < capacity ? header->coresTotal : capacity;
+    int attempt;
+    for(attempt = 0; attempt < SHARED_STATE_READ_ATTEMPTS; attempt++)
+    {
+        const uint64_t before = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+        if(before & 1)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        if(tick != NULL)
+            memcpy(tick, &header->tick, sizeof(*tick));
+        if(cores != NULL)
+            memcpy(cores, reader->cores, coresTotal*sizeof(SharedStateCore));
+        /* Orders the copies before the second load of the sequence. */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&header->sequence, __ATOMIC_RELAXED) == before)
+        {
+            if(!__atomic_load_n(&header->alive, __ATOMIC_RELAXED))
+                return SHARED_STATE_STALE;
+            return (int)(cores != NULL ? coresTotal : 0);
+        }
+    }
+    return SHARED_STATE_BUSY;
+}
+
+#endif /* SHAREDSTATE_H */
@@ -0,0 +1,123 @@
+#include "sharedstatepublisher.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "governortable.h"
+#include "trace.h"
+
+SharedStatePublisher::SharedStatePublisher():
+    mapping(nullptr),
+    mappingSize(0),
+    header(nullptr),
+    cores(nullptr)
+{
+}
+
+SharedStatePublisher::~SharedStatePublisher()
+{
+    close();
+}
+
+bool SharedStatePublisher::open(const QString &name, const CoreStateStore &store)
+{
+    close();
+    const QByteArray rawName = name.toLocal8Bit();
+    // Readers mapping an older segment keep it until they see it stale, the new one gets a fresh inode.
+    shm_unlink(rawName.constData());
+    const int descriptor = shm_open(rawName.constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if(descriptor < 0)
+    {
+        this->error = QString("Cannot create shared memory ") + name + ": " + strerror(errno);
+        return false;
+    }
+    const int coresTotal = store.size();
+    const size_t size = sizeof(SharedStateHeader) + size_t(coresTotal)*sizeof(SharedStateCore);
+    void *map = MAP_FAILED;
+    if(ftruncate(descriptor, off_t(size)) == 0)
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    const int mapError = errno;
+    ::close(descriptor);
+    if(map == MAP_FAILED)
+    {
+        this->error = QString("Cannot map shared memory: ") + strerror(mapError);
+        shm_unlink(rawName.constData());
+        return false;
+    }
+    this->name = name;
+    this->mapping = static_cast<char*>(map);
+    this->mappingSize = size;
+    this->header = reinterpret_cast<SharedStateHeader*>(this->mapping);
+    this->cores = reinterpret_cast<SharedStateCore*>(this->mapping + sizeof(SharedStateHeader));
+
+    // ftruncate() zero-fills, so the sequence starts at 0.
+    memcpy(this->header->magic, SHARED_STATE_MAGIC, sizeof(SHARED_STATE_MAGIC));
+    this->header->version = SHARED_STATE_VERSION;
+    this->header->headerSize = sizeof(SharedStateHeader);
+    this->header->coresTotal = quint32(coresTotal);
+    this->header->coreSize = sizeof(SharedStateCore);
+    this->header->alive = 1;
+    for(int core = 0; core < coresTotal; core++)
+    {
+        this->cores[core].minCoreFrequence = store.minCoreFrequences[core];
+        this->cores[core].maxCoreFrequence = store.maxCoreFrequences[core];
+    }
+    consume(store);
+    return true;
+}
+
+void SharedStatePublisher::close()
+{
+    if(this->mapping == nullptr)
+        return;
+    __atomic_store_n(&this->header->alive, 0, __ATOMIC_RELEASE);
+    munmap(this->mapping, this->mappingSize);
+    shm_unlink(this->name.toLocal8Bit().constData());
+    this->mapping = nullptr;
+    this->header = nullptr;
+    this->cores = nullptr;
+    this->mappingSize = 0;
+}
+
+bool SharedStatePublisher::isOpen() const
+{
+    return this->mapping != nullptr;
+}
+
+QString SharedStatePublisher::errorString() const
+{
+    return this->error;
+}
+
+void SharedStatePublisher::consume(const CoreStateStore &store)
+{
+    TRACE_SCOPE("SharedStatePublisher::consume");
+    const quint64 sequence = this->header->sequence;
+    // Odd sequence tells readers a write is in progress, the fence keeps the data stores after it.
+    __atomic_store_n(&this->header->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    SharedStateTick &tick = this->header->tick;
+    tick.tick = store.sequence;
+    tick.timestamp = store.timestamp;
+    const GovernorTable &governorTable = GovernorTable::instance();
+    int governorsTotal = governorTable.size();
+    if(governorsTotal > SHARED_STATE_GOVERNORS_CAPACITY)
+        governorsTotal = SHARED_STATE_GOVERNORS_CAPACITY;
+    for(int id = int(tick.governorsTotal); id < governorsTotal; id++)
+        strncpy(tick.governorNames[id], governorTable.latin1Name(quint8(id)), SHARED_STATE_GOVERNOR_NAME_SIZE - 1);
+    tick.governorsTotal = quint32(governorsTotal);
+    const int coresTotal = int(this->header->coresTotal);
+    for(int core = 0; core < coresTotal; core++)
+    {
+        SharedStateCore &shared = this->cores[core];
+        shared.currentFrequence = store.currentFrequences[core];
+        shared.minScalingFrequence = store.minScalingFrequences[core];
+        shared.maxScalingFrequence = store.maxScalingFrequences[core];
+        shared.online = store.online[core];
+        shared.governor = store.governors[core];
+        shared.load = store.loads[core];
+    }
+
+    __atomic_store_n(&this->header->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,37 @@
+#ifndef SHAREDSTATEPUBLISHER_H
+#define SHAREDSTATEPUBLISHER_H
+
+#include <QString>
+
+#include "snapshotsink.h"
+#include "sharedstate.h"
+
+// Publishes every tick into a POSIX shared memory segment (see sharedstate.h) for other local processes.
+// The tick is copied under a seqlock, readers never block the sampler and the sampler never waits for them.
+class SharedStatePublisher : public SnapshotSink
+{
+public:
+    SharedStatePublisher();
+    ~SharedStatePublisher();
+    SharedStatePublisher(const SharedStatePublisher &) = delete;
+    SharedStatePublisher &operator=(const SharedStatePublisher &) = delete;
+
+    // Replaces a segment left under `name` by an earlier publisher, static attributes are taken from `store`.
+    bool open(const QString &name, const CoreStateStore &store);
+    // Marks the segment stale for readers still mapping it and removes the name.
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    void consume(const CoreStateStore &store) override;
+
+private:
+    QString name;
+    char *mapping;
+    size_t mappingSize;
+    SharedStateHeader *header;
+    SharedStateCore *cores;
+    QString error;
+};
+
+#endif // SHAREDSTATEPUBLISHER_H
@@ -0,0 +1,100 @@
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single producer / single consumer ring of preallocated snapshots.
+// Producer fills the slot from beginWrite() and hands it over with publish(),
+//consumer keeps the slot returned by acquire*() until its next acquire*() call.
+// When the consumer falls behind the producer drops new snapshots instead of waiting.
+template<typename T, size_t Capacity>
+class SnapshotRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+private:
+    T entries[Capacity];
+    // Producer and consumer indexes live on separate cache lines.
+    char headPadding[64];
+    // Index of the next slot producer will write.
+    std::atomic<size_t> head;
+    char tailPadding[64];
+    // Oldest slot not yet released by consumer.
+    std::atomic<size_t> tail;
+    bool holding;
+    std::atomic<size_t> dropped;
+
+    const T *acquire(size_t index)
+    {
+        this->tail.store(index, std::memory_order_release);
+        this->holding = true;
+        return &this->entries[index & (Capacity - 1)];
+    }
+
+public:
+    SnapshotRing():
+        head(0),
+        tail(0),
+        holding(false),
+        dropped(0)
+    {
+    }
+
+    // Direct slot access, only for preallocation before producer and consumer start.
+    T &slotAt(size_t index)
+    {
+        return this->entries[index];
+    }
+
+    static size_t capacity()
+    {
+        return Capacity;
+    }
+
+    // Producer side.
+    T *beginWrite()
+    {
+        const size_t writeIndex = this->head.load(std::memory_order_relaxed);
+        if(writeIndex - this->tail.load(std::memory_order_acquire) == Capacity)
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &this->entries[writeIndex & (Capacity - 1)];
+    }
+
+    void publish()
+    {
+        this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Snapshots thrown away because the ring was full, safe from any thread.
+    size_t droppedCount() const
+    {
+        return this->dropped.load(std::memory_order_relaxed);
+    }
+
+    // Consumer side. Newest published snapshot, skipping older ones,
+    //or nullptr when nothing new was published since the last call.
+    const T *acquireLatest()
+    {
+        const size_t published = this->head.load(std::memory_order_acquire);
+        const size_t next = this->tail.load(std::memory_order_relaxed) + (this->holding ? 1 : 0);
+        if(published == next)
+            return nullptr;
+        return acquire(published - 1);
+    }
+
+    // Consumer side. Oldest unread snapshot or nullptr.
+    const T *acquireNext()
+    {
+        const size_t published = this->head.load(std::memory_order_acquire);
+        const size_t next = this->tail.load(std::memory_order_relaxed) + (this->holding ? 1 : 0);
+        if(published == next)
+            return nullptr;
+        return acquire(next);
+    }
+};
+
+#endif // SNAPSHOTRING_H
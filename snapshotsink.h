@@ -0,0 +1,15 @@
+#ifndef SNAPSHOTSINK_H
+#define SNAPSHOTSINK_H
+
+#include "corestatestore.h"
+
+// Receives every sampled tick on the sampler thread, before it is handed to the GUI.
+// Implementations must not block, they delay the next tick.
+class SnapshotSink
+{
+public:
+    virtual ~SnapshotSink() {}
+    virtual void consume(const CoreStateStore &store) = 0;
+};
+
+#endif // SNAPSHOTSINK_H
@@ -0,0 +1,64 @@
+#ifndef STREAMFORMAT_H
+#define STREAMFORMAT_H
+
+#include <QtGlobal>
+
+// Binary stream layout written by StreamWriter, native (little-endian) byte order.
+//
+// StreamFileHeader
+// { StreamRecordHeader, payload } repeated:
+//   StreamGovernorRecord: payload is StreamGovernorName followed by `length` name bytes,
+//                         written before the first tick that uses the governor id.
+//   StreamTickRecord: payload is qint64 CLOCK_MONOTONIC timestamp in nanoseconds
+//                     followed by StreamCoreRecord for every core.
+
+const char streamMagic[4] = {'L', 'C', 'I', 'S'};
+const quint16 streamVersion = 1;
+
+enum StreamRecordType
+{
+    StreamGovernorRecord = 1,
+    StreamTickRecord = 2
+};
+
+struct StreamFileHeader
+{
+    char magic[4];
+    quint16 version;
+    quint16 headerSize;
+    quint32 coresTotal;
+    quint32 reserved;
+};
+
+struct StreamRecordHeader
+{
+    quint32 type;
+    // Payload size in bytes, without this header.
+    quint32 size;
+};
+
+struct StreamGovernorName
+{
+    quint8 id;
+    quint8 length;
+};
+
+// Frequences are in kHz as reported by cpufreq.
+struct StreamCoreRecord
+{
+    quint32 currentFrequence;
+    quint32 minScalingFrequence;
+    quint32 maxScalingFrequence;
+    // Hundredths of percent, streamUnknownLoad when unknown.
+    quint16 load;
+    quint8 online;
+    quint8 governor;
+};
+
+const quint16 streamUnknownLoad = 0xFFFF;
+
+static_assert(sizeof(StreamFileHeader) == 16, "StreamFileHeader layout changed.");
+static_assert(sizeof(StreamRecordHeader) == 8, "StreamRecordHeader layout changed.");
+static_assert(sizeof(StreamCoreRecord) == 16, "StreamCoreRecord layout changed.");
+
+#endif // STREAMFORMAT_H
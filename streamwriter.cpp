@@ -0,0 +1,141 @@
+#include "streamwriter.h"
+
+#include <cstring>
+
+#include "governortable.h"
+
+namespace
+{
+// Widest CSV row without the governor name: timestamp, core, online, three frequences and a load
+//of up to 100.0 with their separators. Longer loads or names grow the buffer while writing.
+const size_t csvNumbersWidth = 20 + 1 + 11 + 1 + 1 + 1 + 3*(10 + 1) + 1 + 5 + 1;
+}
+
+StreamWriter::StreamWriter(FILE *output, Format format, int coresTotal, quint64 samplesLimit):
+    output(output),
+    format(format),
+    coresTotal(coresTotal),
+    samplesLimit(samplesLimit),
+    samplesWritten(0),
+    governorsWritten(1)
+{
+    const size_t csvRowWidth = csvNumbersWidth + SysfsAttribute::bufferSize;
+    this->buffer.resize(sizeof(StreamRecordHeader) + sizeof(qint64) + size_t(coresTotal)*qMax(csvRowWidth, sizeof(StreamCoreRecord)));
+    writeHeader();
+}
+
+void StreamWriter::setFinishedCallback(const std::function<void()> &callback)
+{
+    this->finished = callback;
+}
+
+void StreamWriter::writeHeader()
+{
+    if(this->format == CsvFormat)
+    {
+        fputs("timestamp_ns,core,online,cur_freq_khz,min_scaling_freq_khz,max_scaling_freq_khz,governor,load\n", this->output);
+        return;
+    }
+    StreamFileHeader header;
+    memcpy(header.magic, streamMagic, sizeof(header.magic));
+    header.version = streamVersion;
+    header.headerSize = sizeof(StreamFileHeader);
+    header.coresTotal = quint32(this->coresTotal);
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, this->output);
+}
+
+void StreamWriter::consume(const CoreStateStore &store)
+{
+    if(this->samplesLimit != 0 && this->samplesWritten >= this->samplesLimit)
+        return;
+    if(this->format == CsvFormat)
+        writeCsv(store);
+    else
+        writeBinary(store);
+    this->samplesWritten++;
+    if(this->samplesWritten == this->samplesLimit)
+    {
+        fflush(this->output);
+        if(this->finished)
+            this->finished();
+    }
+}
+
+void StreamWriter::writeCsv(const CoreStateStore &store)
+{
+    const GovernorTable &governorTable = GovernorTable::instance();
+    size_t used = 0;
+    for(int core = 0; core < this->coresTotal;)
+    {
+        char *position = this->buffer.data() + used;
+        const size_t available = this->buffer.size() - used;
+        const float load = store.loads[core];
+        int length;
+        if(load < 0)
+            length = snprintf(position, available, "%lld,%d,%d,%u,%u,%u,%s,\n",
+                              static_cast<long long>(store.timestamp), core, int(store.online[core]),
+                              store.currentFrequences[core], store.minScalingFrequences[core],
+                              store.maxScalingFrequences[core], governorTable.latin1Name(store.governors[core]));
+        else
+            length = snprintf(position, available, "%lld,%d,%d,%u,%u,%u,%s,%.1f\n",
+                              static_cast<long long>(store.timestamp), core, int(store.online[core]),
+                              store.currentFrequences[core], store.minScalingFrequences[core],
+                              store.maxScalingFrequences[core], governorTable.latin1Name(store.governors[core]),
+                              double(load));
+        if(length < 0)
+            break;
+        // A row that didn't fit is formatted again into a larger buffer, rows are never cut off.
+        if(size_t(length) >= available)
+        {
+            this->buffer.resize(qMax(this->buffer.size()*2, used + size_t(length) + 1));
+            continue;
+        }
+        used += size_t(length);
+        core++;
+    }
+    fwrite(this->buffer.data(), 1, used, this->output);
+}
+
+void StreamWriter::writeBinary(const CoreStateStore &store)
+{
+    // Describe governors interned since the previous tick.
+    const GovernorTable &governorTable = GovernorTable::instance();
+    const int governorsTotal = governorTable.size();
+    for(; this->governorsWritten < governorsTotal; this->governorsWritten++)
+    {
+        const char *name = governorTable.latin1Name(quint8(this->governorsWritten));
+        StreamGovernorName governor;
+        governor.id = quint8(this->governorsWritten);
+        governor.length = quint8(strlen(name));
+        StreamRecordHeader header;
+        header.type = StreamGovernorRecord;
+        header.size = quint32(sizeof(governor) + governor.length);
+        fwrite(&header, sizeof(header), 1, this->output);
+        fwrite(&governor, sizeof(governor), 1, this->output);
+        fwrite(name, 1, governor.length, this->output);
+    }
+
+    char *position = this->buffer.data();
+    StreamRecordHeader header;
+    header.type = StreamTickRecord;
+    header.size = quint32(sizeof(qint64) + size_t(this->coresTotal)*sizeof(StreamCoreRecord));
+    memcpy(position, &header, sizeof(header));
+    position += sizeof(header);
+    memcpy(position, &store.timestamp, sizeof(store.timestamp));
+    position += sizeof(store.timestamp);
+    for(int core = 0; core < this->coresTotal; core++)
+    {
+        StreamCoreRecord record;
+        const float load = store.loads[core];
+        record.currentFrequence = store.currentFrequences[core];
+        record.minScalingFrequence = store.minScalingFrequences[core];
+        record.maxScalingFrequence = store.maxScalingFrequences[core];
+        record.load = load < 0 ? streamUnknownLoad : quint16(load*100.0f + 0.5f);
+        record.online = store.online[core];
+        record.governor = store.governors[core];
+        memcpy(position, &record, sizeof(record));
+        position += sizeof(record);
+    }
+    fwrite(this->buffer.data(), 1, size_t(position - this->buffer.data()), this->output);
+}
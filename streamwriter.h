@@ -0,0 +1,45 @@
+#ifndef STREAMWRITER_H
+#define STREAMWRITER_H
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "snapshotsink.h"
+#include "streamformat.h"
+
+// Writes every sampled tick to a stdio stream as CSV or as the binary format from streamformat.h.
+// Records are formatted into a reusable buffer, no allocations per tick.
+class StreamWriter : public SnapshotSink
+{
+public:
+    enum Format
+    {
+        CsvFormat,
+        BinaryFormat
+    };
+
+    // Stops writing after samplesLimit ticks when it's not 0.
+    StreamWriter(FILE *output, Format format, int coresTotal, quint64 samplesLimit = 0);
+
+    // Called once on the sampler thread when the limit is reached.
+    void setFinishedCallback(const std::function<void()> &callback);
+    void consume(const CoreStateStore &store) override;
+
+private:
+    FILE *output;
+    const Format format;
+    const int coresTotal;
+    const quint64 samplesLimit;
+    quint64 samplesWritten;
+    std::function<void()> finished;
+    // Governor ids already described in the binary stream.
+    int governorsWritten;
+    std::vector<char> buffer;
+
+    void writeHeader();
+    void writeCsv(const CoreStateStore &store);
+    void writeBinary(const CoreStateStore &store);
+};
+
+#endif // STREAMWRITER_H
@@ -0,0 +1,137 @@
+#include "sysfsattribute.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+QString SysfsAttribute::root;
+
+SysfsAttribute::SysfsAttribute():
+    fileDescriptor(-1)
+{
+}
+
+SysfsAttribute::~SysfsAttribute()
+{
+    close();
+}
+
+SysfsAttribute::SysfsAttribute(SysfsAttribute &&other):
+    fileDescriptor(other.fileDescriptor)
+{
+    other.fileDescriptor = -1;
+}
+
+SysfsAttribute &SysfsAttribute::operator=(SysfsAttribute &&other)
+{
+    if(this != &other)
+    {
+        close();
+        this->fileDescriptor = other.fileDescriptor;
+        other.fileDescriptor = -1;
+    }
+    return *this;
+}
+
+bool SysfsAttribute::open(const QString &path)
+{
+    close();
+    this->fileDescriptor = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    return this->fileDescriptor >= 0;
+}
+
+void SysfsAttribute::close()
+{
+    if(this->fileDescriptor < 0)
+        return;
+    ::close(this->fileDescriptor);
+    this->fileDescriptor = -1;
+}
+
+bool SysfsAttribute::isOpen() const
+{
+    return this->fileDescriptor >= 0;
+}
+
+int SysfsAttribute::descriptor() const
+{
+    return this->fileDescriptor;
+}
+
+ssize_t SysfsAttribute::read(char *buffer, size_t size) const
+{
+    ssize_t length;
+    do
+    {
+        length = ::pread(this->fileDescriptor, buffer, size, 0);
+    } while(length < 0 && errno == EINTR);
+    return length;
+}
+
+bool SysfsAttribute::readUInt(uint &value) const
+{
+    char buffer[SysfsAttribute::bufferSize];
+    ssize_t length = read(buffer, sizeof(buffer));
+    return parseUInt(buffer, length, value);
+}
+
+bool SysfsAttribute::writeFile(const QString &path, const char *buffer, size_t size)
+{
+    int descriptor = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_CLOEXEC);
+    if(descriptor < 0)
+        return false;
+    ssize_t written;
+    do
+    {
+        written = ::write(descriptor, buffer, size);
+    } while(written < 0 && errno == EINTR);
+    const int writeError = errno;
+    ::close(descriptor);
+    if(written != ssize_t(size))
+    {
+        errno = written < 0 ? writeError : EIO;
+        return false;
+    }
+    return true;
+}
+
+void SysfsAttribute::setRootPath(const QString &path)
+{
+    SysfsAttribute::root = path;
+}
+
+QString SysfsAttribute::rootPath()
+{
+    return SysfsAttribute::root;
+}
+
+bool SysfsAttribute::parseUInt(const char *buffer, ssize_t length, uint &value)
+{
+    length = trimmedLength(buffer, length);
+    if(length <= 0)
+        return false;
+    unsigned long long result = 0;
+    for(ssize_t i = 0; i < length; i++)
+    {
+        const char digit = buffer[i];
+        if(digit < '0' || digit > '9')
+            return false;
+        result = result*10 + uint(digit - '0');
+        if(result > 0xFFFFFFFFull)
+            return false;
+    }
+    value = uint(result);
+    return true;
+}
+
+ssize_t SysfsAttribute::trimmedLength(const char *buffer, ssize_t length)
+{
+    while(length > 0)
+    {
+        const char last = buffer[length - 1];
+        if(last != '\n' && last != ' ' && last != '\t' && last != '\0')
+            break;
+        length--;
+    }
+    return length;
+}
@@ -0,0 +1,54 @@
+#ifndef SYSFSATTRIBUTE_H
+#define SYSFSATTRIBUTE_H
+
+#include <sys/types.h>
+
+#include <QString>
+
+// Read-only handle to a single sysfs or procfs pseudo file.
+// The file is opened once and re-read with pread() at offset 0,
+// the kernel regenerates the content on every read from the beginning.
+class SysfsAttribute
+{
+private:
+    int fileDescriptor;
+    static QString root;
+
+public:
+    // Longest value we expect from a cpufreq attribute
+    // (frequences, governor names, online flag).
+    static const int bufferSize = 64;
+
+    SysfsAttribute();
+    ~SysfsAttribute();
+
+    SysfsAttribute(const SysfsAttribute &) = delete;
+    SysfsAttribute &operator=(const SysfsAttribute &) = delete;
+    SysfsAttribute(SysfsAttribute &&other);
+    SysfsAttribute &operator=(SysfsAttribute &&other);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    int descriptor() const;
+
+    // Returns number of bytes read or -1 on error. Trailing newline is kept.
+    ssize_t read(char *buffer, size_t size) const;
+    bool readUInt(uint &value) const;
+
+    // Opens, writes the value with a single write() and closes the file.
+    //Returns false with errno set on failure, sysfs reports rejected values from write().
+    static bool writeFile(const QString &path, const char *buffer, size_t size);
+
+    // Prefix for every /sys and /proc path, empty by default. Benchmarks point it to a fake tree,
+    //it must be set before any core or reader is created.
+    static void setRootPath(const QString &path);
+    static QString rootPath();
+
+    // Parse decimal integer from raw sysfs content, trailing whitespace is allowed.
+    static bool parseUInt(const char *buffer, ssize_t length, uint &value);
+    // Length of content without trailing whitespace.
+    static ssize_t trimmedLength(const char *buffer, ssize_t length);
+};
+
+#endif // SYSFSATTRIBUTE_H
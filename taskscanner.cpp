@@ -0,0 +1,407 @@
+#include "taskscanner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "sysfsattribute.h"
+#include "trace.h"
+
+namespace
+{
+// A stat line is about 300 bytes, the name is at most 64.
+const size_t statBufferSize = 1024;
+// Entries of a few hundred tasks per getdents64() call.
+const size_t entriesBufferSize = 32*1024;
+
+struct StatFields
+{
+    const char *name;
+    size_t nameLength;
+    unsigned long long cpuTime;
+    unsigned long long startTime;
+    unsigned long long threads;
+    unsigned long long processor;
+};
+
+inline const char *parseNumber(const char *position, const char *end, unsigned long long &value)
+{
+    value = 0;
+    while(position < end && *position >= '0' && *position <= '9')
+    {
+        value = value*10 + unsigned(*position - '0');
+        position++;
+    }
+    return position;
+}
+
+// "pid (comm) state ppid ...", comm may contain spaces and parentheses, so fields are counted
+//from the last ')'. Token 0 after it is field 3 of proc(5).
+bool parseStat(const char *buffer, ssize_t length, StatFields &fields)
+{
+    const char *end = buffer + length;
+    const char *nameStart = static_cast<const char*>(memchr(buffer, '(', size_t(length)));
+    const char *nameEnd = static_cast<const char*>(memrchr(buffer, ')', size_t(length)));
+    if(nameStart == nullptr || nameEnd == nullptr || nameEnd < nameStart)
+        return false;
+    fields.name = nameStart + 1;
+    fields.nameLength = size_t(nameEnd - fields.name);
+    unsigned long long utime = 0;
+    const char *position = nameEnd + 1;
+    for(int token = 0; position < end; token++)
+    {
+        while(position < end && *position == ' ')
+            position++;
+        unsigned long long value;
+        const char *tokenEnd = parseNumber(position, end, value);
+        switch(token)
+        {
+        case 11:
+            utime = value;
+            break;
+        case 12:
+            fields.cpuTime = utime + value;
+            break;
+        case 17:
+            fields.threads = value;
+            break;
+        case 19:
+            fields.startTime = value;
+            break;
+        case 36:
+            fields.processor = value;
+            return true;
+        }
+        // Skips fields that aren't plain numbers, like the state or a negative nice.
+        while(tokenEnd < end && *tokenEnd != ' ')
+            tokenEnd++;
+        position = tokenEnd;
+    }
+    return false;
+}
+
+// Positive id from a directory name, -1 for everything else in /proc.
+int parseId(const char *name)
+{
+    int id = 0;
+    if(*name == '\0')
+        return -1;
+    for(; *name != '\0'; name++)
+    {
+        if(*name < '0' || *name > '9')
+            return -1;
+        id = id*10 + (*name - '0');
+    }
+    return id;
+}
+
+// Calls `visit` with every numeric entry of an open directory, listing it with getdents64()
+//into `entries`. glibc's dirent64 has the kernel's layout.
+template<typename Visit>
+void forEachId(int directory, std::vector<char> &entries, Visit visit)
+{
+    while(true)
+    {
+        const long length = syscall(SYS_getdents64, directory, entries.data(), entries.size());
+        if(length <= 0)
+            return;
+        for(long offset = 0; offset < length;)
+        {
+            const dirent64 *entry = reinterpret_cast<const dirent64*>(entries.data() + offset);
+            offset += entry->d_reclen;
+            const int id = parseId(entry->d_name);
+            if(id > 0)
+                visit(id);
+        }
+    }
+}
+
+qint64 threadCpuTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return qint64(now.tv_sec)*1000000000 + now.tv_nsec;
+}
+}
+
+const int TaskScanner::nameSize;
+
+TaskScanner::TaskScanner(int coresTotal):
+    coresTotal(coresTotal),
+    procDescriptor(-1),
+    procEntries(entriesBufferSize),
+    taskEntries(entriesBufferSize),
+    buffer(statBufferSize),
+    generation(0),
+    lastTimestamp(0),
+    elapsed(0),
+    read(0),
+    descriptorsOpen(0),
+    descriptorBudget(0),
+    clockTicksPerSecond(double(sysconf(_SC_CLK_TCK))),
+    offsets(size_t(coresTotal + 1), 0),
+    revisionNumber(0),
+    readTotal(0),
+    knownTotal(0),
+    cpuTime(0)
+{
+    const QByteArray path = (SysfsAttribute::rootPath() + "/proc").toLocal8Bit();
+    this->procDescriptor = open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    // The other half is left to the rest of the tool.
+    rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+        this->descriptorBudget = int(std::min(limit.rlim_cur/2, rlim_t(1 << 20)));
+}
+
+TaskScanner::~TaskScanner()
+{
+    for(auto &process: this->processes)
+        closeEntry(process.second);
+    for(auto &thread: this->threads)
+        closeEntry(thread.second);
+    if(this->procDescriptor >= 0)
+        close(this->procDescriptor);
+}
+
+bool TaskScanner::isOpen() const
+{
+    return this->procDescriptor >= 0;
+}
+
+TaskScanner::Entry *TaskScanner::readTask(int directory, const char *path, int id, int processId,
+                                          std::unordered_map<int, Entry> &entries, int &processor, int &threadsTotal,
+                                          unsigned long long &delta)
+{
+    const auto inserted = entries.emplace(id, Entry());
+    Entry &entry = inserted.first->second;
+    if(inserted.second)
+        entry.descriptor = -1;
+    // A descriptor of an exited task fails with ESRCH, the PID may belong to a new one by now.
+    ssize_t length = -1;
+    if(entry.descriptor >= 0)
+    {
+        length = pread(entry.descriptor, this->buffer.data(), this->buffer.size(), 0);
+        if(length <= 0)
+            closeEntry(entry);
+    }
+    if(length <= 0)
+    {
+        const int descriptor = openat(directory, path, O_RDONLY | O_CLOEXEC);
+        if(descriptor < 0)
+            return nullptr;
+        length = ::read(descriptor, this->buffer.data(), this->buffer.size());
+        if(this->descriptorsOpen < this->descriptorBudget)
+        {
+            entry.descriptor = descriptor;
+            this->descriptorsOpen++;
+        }
+        else
+        {
+            close(descriptor);
+        }
+    }
+    // Entries that aren't read again are dropped by sweep().
+    StatFields fields;
+    if(length <= 0 || !parseStat(this->buffer.data(), length, fields))
+        return nullptr;
+    this->read++;
+    const bool known = entry.generation != 0 && entry.startTime == fields.startTime;
+    delta = known && fields.cpuTime > entry.cpuTime ? fields.cpuTime - entry.cpuTime : 0;
+    if(!known)
+    {
+        entry.processId = processId;
+        entry.startTime = fields.startTime;
+        entry.threadsGeneration = 0;
+    }
+    entry.cpuTime = fields.cpuTime;
+    entry.generation = this->generation;
+    // Name changes with exec() and prctl(), it's copied every time.
+    const size_t nameLength = std::min(fields.nameLength, size_t(nameSize - 1));
+    memcpy(entry.name, fields.name, nameLength);
+    entry.name[nameLength] = '\0';
+    processor = int(fields.processor);
+    threadsTotal = int(fields.threads);
+    return &entry;
+}
+
+void TaskScanner::update(qint64 timestamp)
+{
+    TRACE_SCOPE("TaskScanner::update");
+    if(this->procDescriptor < 0)
+        return;
+    const qint64 cpuStart = threadCpuTime();
+    this->elapsed = this->lastTimestamp != 0 ? timestamp - this->lastTimestamp : 0;
+    this->lastTimestamp = timestamp;
+    this->generation++;
+    this->read = 0;
+    this->samples.clear();
+    lseek(this->procDescriptor, 0, SEEK_SET);
+    forEachId(this->procDescriptor, this->procEntries, [this](int processId)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), "%d/stat", processId);
+        int processor, threadsTotal;
+        unsigned long long delta;
+        Entry *process = readTask(this->procDescriptor, path, processId, processId, this->processes,
+                                  processor, threadsTotal, delta);
+        if(process == nullptr || delta == 0 || this->elapsed <= 0)
+            return;
+        if(threadsTotal > 1)
+            scanThreads(processId, *process, processor, delta);
+        else
+            addSample(processId, processId, processor, delta, process->name);
+    });
+    sweep();
+    publish(threadCpuTime() - cpuStart);
+}
+
+void TaskScanner::scanThreads(int processId, Entry &process, int processor, unsigned long long delta)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "%d/task", processId);
+    const int taskDescriptor = openat(this->procDescriptor, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(taskDescriptor < 0)
+        return;
+    process.threadsGeneration = this->generation;
+    unsigned long long attributed = 0;
+    forEachId(taskDescriptor, this->taskEntries, [this, taskDescriptor, processId, &attributed](int threadId)
+    {
+        char threadPath[32];
+        snprintf(threadPath, sizeof(threadPath), "%d/stat", threadId);
+        int processor, threadsTotal;
+        unsigned long long delta;
+        const Entry *thread = readTask(taskDescriptor, threadPath, threadId, processId, this->threads,
+                                       processor, threadsTotal, delta);
+        if(thread != nullptr && delta > 0)
+        {
+            addSample(threadId, processId, processor, delta, thread->name);
+            attributed += delta;
+        }
+    });
+    close(taskDescriptor);
+    // Threads seen for the first time or gone since the last scan, the process gets their time.
+    if(delta > attributed)
+        addSample(processId, processId, processor, delta - attributed, process.name);
+}
+
+void TaskScanner::addSample(int id, int processId, int processor, unsigned long long delta, const char *name)
+{
+    if(processor < 0 || processor >= this->coresTotal)
+        return;
+    Sample sample;
+    sample.id = id;
+    sample.processId = processId;
+    sample.processor = processor;
+    sample.load = float(100.0*double(delta)/this->clockTicksPerSecond*1e9/double(this->elapsed));
+    memcpy(sample.name, name, nameSize);
+    this->samples.push_back(sample);
+}
+
+void TaskScanner::closeEntry(Entry &entry)
+{
+    if(entry.descriptor < 0)
+        return;
+    close(entry.descriptor);
+    entry.descriptor = -1;
+    this->descriptorsOpen--;
+}
+
+void TaskScanner::sweep()
+{
+    for(auto process = this->processes.begin(); process != this->processes.end();)
+    {
+        if(process->second.generation != this->generation)
+        {
+            closeEntry(process->second);
+            process = this->processes.erase(process);
+        }
+        else
+        {
+            ++process;
+        }
+    }
+    // Threads of idle processes weren't listed, they stay until their process goes
+    //or a listing of its threads misses them.
+    for(auto thread = this->threads.begin(); thread != this->threads.end();)
+    {
+        const auto process = this->processes.find(thread->second.processId);
+        if(process == this->processes.end() || thread->second.generation < process->second.threadsGeneration)
+        {
+            closeEntry(thread->second);
+            thread = this->threads.erase(thread);
+        }
+        else
+        {
+            ++thread;
+        }
+    }
+}
+
+void TaskScanner::publish(qint64 scanCpuTime)
+{
+    std::sort(this->samples.begin(), this->samples.end(), [](const Sample &first, const Sample &second)
+    {
+        return first.processor != second.processor ? first.processor < second.processor : first.load > second.load;
+    });
+    QMutexLocker locker(&this->mutex);
+    this->published.swap(this->samples);
+    std::fill(this->offsets.begin(), this->offsets.end(), 0);
+    for(const Sample &sample: this->published)
+        this->offsets[size_t(sample.processor + 1)]++;
+    for(int core = 0; core < this->coresTotal; core++)
+        this->offsets[size_t(core + 1)] += this->offsets[size_t(core)];
+    this->revisionNumber++;
+    this->readTotal = this->read;
+    this->knownTotal = int(this->processes.size() + this->threads.size());
+    this->cpuTime = scanCpuTime;
+}
+
+void TaskScanner::query(int coreNumber, int count, QVector<Task> &tasks) const
+{
+    tasks.clear();
+    if(coreNumber < 0 || coreNumber >= this->coresTotal)
+        return;
+    QMutexLocker locker(&this->mutex);
+    const int first = this->offsets[size_t(coreNumber)];
+    const int last = std::min(this->offsets[size_t(coreNumber + 1)], first + count);
+    for(int i = first; i < last; i++)
+    {
+        const Sample &sample = this->published[size_t(i)];
+        Task task;
+        task.id = sample.id;
+        task.processId = sample.processId;
+        task.name = QString::fromLocal8Bit(sample.name);
+        task.load = sample.load;
+        tasks.push_back(task);
+    }
+}
+
+quint64 TaskScanner::revision() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->revisionNumber;
+}
+
+int TaskScanner::tasksRead() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->readTotal;
+}
+
+int TaskScanner::tasksKnown() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->knownTotal;
+}
+
+qint64 TaskScanner::scanCpuTime() const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->cpuTime;
+}
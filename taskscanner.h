@@ -0,0 +1,120 @@
+#ifndef TASKSCANNER_H
+#define TASKSCANNER_H
+
+#include <unordered_map>
+#include <vector>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Tasks running on every logic core, from the processor field and utime/stime deltas of /proc/[pid]/stat.
+// /proc is listed through a directory handle kept open, stat files stay open between scans while
+//the descriptor budget (half of RLIMIT_NOFILE) lasts, are re-read with pread() into one reusable buffer
+//and only the fields below are parsed. State of every PID is cached between scans, PIDs that didn't
+//show up in a listing are dropped. Threads are read only for processes that used CPU
+//since the previous scan, an idle process costs one read however many threads it has;
+//as its threads didn't run either, their deltas still cover just the last interval.
+class TaskScanner
+{
+public:
+    struct Task
+    {
+        // Thread id, the same as processId for single-threaded processes.
+        int id;
+        int processId;
+        QString name;
+        // Percents of one core since the previous scan.
+        float load;
+    };
+
+    explicit TaskScanner(int coresTotal);
+    ~TaskScanner();
+    TaskScanner(const TaskScanner &) = delete;
+    TaskScanner &operator=(const TaskScanner &) = delete;
+
+    bool isOpen() const;
+    // Sampler thread, timestamp is CLOCK_MONOTONIC nanoseconds. The first scan only fills the cache.
+    void update(qint64 timestamp);
+
+    // Any thread. Up to `count` busiest tasks the last scan found on the core, busiest first.
+    void query(int coreNumber, int count, QVector<Task> &tasks) const;
+    // Grows with every update(), so views can skip unchanged tables.
+    quint64 revision() const;
+    // Stat files read by the last scan, processes and threads.
+    int tasksRead() const;
+    // Processes and threads cached between scans.
+    int tasksKnown() const;
+    // Thread CPU time of the last scan, nanoseconds.
+    qint64 scanCpuTime() const;
+
+private:
+    // Fixed size like the kernel's comm, no allocations while scanning.
+    static const int nameSize = 16;
+
+    struct Entry
+    {
+        int processId;
+        // Clock ticks since boot, a different value means the PID was reused.
+        unsigned long long startTime;
+        // utime + stime, clock ticks.
+        unsigned long long cpuTime;
+        // Scan that last read the entry, 0 for new ones.
+        quint64 generation;
+        // Processes only, scan that last listed its threads.
+        quint64 threadsGeneration;
+        // Open stat file, -1 when the budget was used up.
+        int descriptor;
+        char name[nameSize];
+    };
+
+    struct Sample
+    {
+        int id;
+        int processId;
+        int processor;
+        float load;
+        char name[nameSize];
+    };
+
+    const int coresTotal;
+    // /proc, rewound for every scan.
+    int procDescriptor;
+    // Separate buffers, threads are listed while /proc entries are still being walked.
+    std::vector<char> procEntries;
+    std::vector<char> taskEntries;
+    std::vector<char> buffer;
+    std::unordered_map<int, Entry> processes;
+    std::unordered_map<int, Entry> threads;
+    // Busy tasks of the scan in progress.
+    std::vector<Sample> samples;
+    quint64 generation;
+    qint64 lastTimestamp;
+    qint64 elapsed;
+    int read;
+    int descriptorsOpen;
+    int descriptorBudget;
+    const double clockTicksPerSecond;
+
+    // Swapped in under the mutex, ordered by processor and then by load.
+    mutable QMutex mutex;
+    std::vector<Sample> published;
+    // Index of the first sample of every core, coresTotal + 1 entries.
+    std::vector<int> offsets;
+    quint64 revisionNumber;
+    int readTotal;
+    int knownTotal;
+    qint64 cpuTime;
+
+    // Reads the stat file at `path` below `directory` into the cached entry of `id`, `delta` is its CPU time
+    //since the previous read. Returns nullptr when the task is gone or its stat can't be parsed.
+    Entry *readTask(int directory, const char *path, int id, int processId, std::unordered_map<int, Entry> &entries,
+                    int &processor, int &threadsTotal, unsigned long long &delta);
+    // Time of threads that can't be attributed (new or exited ones) stays with the process.
+    void scanThreads(int processId, Entry &process, int processor, unsigned long long delta);
+    void addSample(int id, int processId, int processor, unsigned long long delta, const char *name);
+    void closeEntry(Entry &entry);
+    void sweep();
+    void publish(qint64 scanCpuTime);
+};
+
+#endif // TASKSCANNER_H
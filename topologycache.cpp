@@ -0,0 +1,151 @@
+#include "topologycache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <sys/utsname.h>
+
+#include "sysfsattribute.h"
+
+namespace
+{
+const char cacheHeader[] = "LinuxCpuInstruments topology 1";
+const int fieldsTotal = 9;
+
+// Whole file on one line, empty when it can't be read.
+QString readLine(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return QString();
+    return QString::fromLatin1(file.readAll()).simplified();
+}
+}
+
+CoreTopology::CoreTopology():
+    known(false),
+    minCoreFrequence(0),
+    maxCoreFrequence(0),
+    policyLeader(0),
+    policySize(1),
+    packageId(-1),
+    coreId(-1)
+{
+}
+
+TopologyCache::TopologyCache(int coresTotal, const QString &path):
+    path(path),
+    key(systemKey(coresTotal)),
+    cores(coresTotal),
+    modified(false)
+{
+}
+
+QString TopologyCache::defaultPath()
+{
+    // Fake trees keep their own cache, it would be dropped by the next real run anyway.
+    if(!SysfsAttribute::rootPath().isEmpty())
+        return SysfsAttribute::rootPath() + "/topology";
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/LinuxCpuInstruments/topology";
+}
+
+QString TopologyCache::systemKey(int coresTotal)
+{
+    // Hardware limits and policies also change with the cpufreq driver, which can be switched at runtime,
+    //and with the kernel command line (intel_pstate=passive, maxcpus=, isolcpus=).
+    QString key = QString::number(coresTotal);
+    utsname system;
+    if(uname(&system) == 0)
+        key = QString(system.release) + " " + QString(system.version) + " " + key;
+    key += " " + readLine(SysfsAttribute::rootPath() + "/sys/devices/system/cpu/cpu0/cpufreq/scaling_driver");
+    key += " " + readLine(SysfsAttribute::rootPath() + "/proc/cmdline");
+    return key;
+}
+
+bool TopologyCache::load()
+{
+    QFile file(this->path);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    QTextStream fileStream(&file);
+    if(fileStream.readLine() != cacheHeader || fileStream.readLine() != this->key)
+        return false;
+    // Tab separated: core, min, max, policy leader, policy size, package, core id, siblings, governors.
+    QVector<CoreTopology> loaded(this->cores.size());
+    while(!fileStream.atEnd())
+    {
+        QStringList fields = fileStream.readLine().split('\t');
+        if(fields.size() != fieldsTotal)
+            return false;
+        bool success = true;
+        int coreNumber = fields[0].toInt(&success);
+        if(!success || coreNumber < 0 || coreNumber >= loaded.size())
+            return false;
+        CoreTopology &topology = loaded[coreNumber];
+        topology.minCoreFrequence = fields[1].toUInt();
+        topology.maxCoreFrequence = fields[2].toUInt();
+        topology.policyLeader = fields[3].toUInt();
+        topology.policySize = fields[4].toInt();
+        topology.packageId = fields[5].toInt();
+        topology.coreId = fields[6].toInt();
+        topology.threadSiblings = fields[7];
+        topology.availableGovernors = fields[8].split(',');
+        topology.known = topology.maxCoreFrequence != 0;
+    }
+    this->cores = loaded;
+    this->modified = false;
+    return true;
+}
+
+bool TopologyCache::save()
+{
+    QDir().mkpath(QFileInfo(this->path).absolutePath());
+    // Written next to the cache and renamed over it, a crash or another instance never leaves half a cache.
+    QSaveFile file(this->path);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    QTextStream fileStream(&file);
+    fileStream << cacheHeader << "\n" << this->key << "\n";
+    for(int coreNumber = 0; coreNumber < this->cores.size(); coreNumber++)
+    {
+        const CoreTopology &topology = this->cores[coreNumber];
+        if(!topology.known)
+            continue;
+        fileStream << coreNumber << "\t" << topology.minCoreFrequence << "\t" << topology.maxCoreFrequence
+                   << "\t" << topology.policyLeader << "\t" << topology.policySize
+                   << "\t" << topology.packageId << "\t" << topology.coreId
+                   << "\t" << topology.threadSiblings << "\t" << topology.availableGovernors.join(",") << "\n";
+    }
+    fileStream.flush();
+    this->modified = false;
+    return fileStream.status() == QTextStream::Ok && file.commit();
+}
+
+bool TopologyCache::isModified() const
+{
+    return this->modified;
+}
+
+const CoreTopology *TopologyCache::find(int coreNumber) const
+{
+    if(coreNumber < 0 || coreNumber >= this->cores.size() || !this->cores[coreNumber].known)
+        return nullptr;
+    return &this->cores[coreNumber];
+}
+
+void TopologyCache::store(int coreNumber, const CoreTopology &topology)
+{
+    if(coreNumber < 0 || coreNumber >= this->cores.size() || !topology.known)
+        return;
+    CoreTopology &cached = this->cores[coreNumber];
+    if(cached.known && cached.minCoreFrequence == topology.minCoreFrequence && cached.maxCoreFrequence == topology.maxCoreFrequence
+            && cached.policyLeader == topology.policyLeader && cached.policySize == topology.policySize
+            && cached.packageId == topology.packageId && cached.coreId == topology.coreId
+            && cached.threadSiblings == topology.threadSiblings && cached.availableGovernors == topology.availableGovernors)
+        return;
+    cached = topology;
+    this->modified = true;
+}
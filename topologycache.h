@@ -0,0 +1,54 @@
+#ifndef TOPOLOGYCACHE_H
+#define TOPOLOGYCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Static attributes of one core, they change only with the kernel or hardware.
+struct CoreTopology
+{
+    // False until the attributes were read while the core was online.
+    bool known;
+    uint minCoreFrequence;
+    uint maxCoreFrequence;
+    QStringList availableGovernors;
+    uint policyLeader;
+    int policySize;
+    int packageId;
+    int coreId;
+    QString threadSiblings;
+
+    CoreTopology();
+};
+
+// Static attributes of all cores persisted between runs, so a warm start doesn't read them from sysfs.
+// The cache is dropped when the kernel, its command line, the cpufreq driver or the number of cores changes.
+// Available governors are not trusted from it, modules may add governors between runs.
+class TopologyCache
+{
+public:
+    explicit TopologyCache(int coresTotal, const QString &path = defaultPath());
+
+    // True when a cache for this kernel, driver and core count was read.
+    bool load();
+    bool save();
+    bool isModified() const;
+
+    // Nullptr when the core is not known yet.
+    const CoreTopology *find(int coreNumber) const;
+    void store(int coreNumber, const CoreTopology &topology);
+
+    // $XDG_CACHE_HOME/LinuxCpuInstruments/topology, or next to the tree given by SysfsAttribute::setRootPath().
+    static QString defaultPath();
+
+private:
+    const QString path;
+    const QString key;
+    QVector<CoreTopology> cores;
+    bool modified;
+
+    static QString systemKey(int coresTotal);
+};
+
+#endif // TOPOLOGYCACHE_H
@@ -0,0 +1,126 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <ctime>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <QMutex>
+
+std::atomic<bool> Trace::enabled(false);
+const size_t Trace::bufferCapacity;
+
+namespace
+{
+struct ThreadBuffer
+{
+    int threadId;
+    char threadName[16];
+    // Written only by its thread, exporter reads up to the published count.
+    std::atomic<quint64> written;
+    std::vector<Trace::Event> events;
+};
+
+// Buffers live until exit, a thread that finished keeps its events for the export.
+QMutex buffersMutex;
+std::vector<ThreadBuffer*> buffers;
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer *createThreadBuffer()
+{
+    ThreadBuffer *buffer = new ThreadBuffer;
+    buffer->threadId = int(syscall(SYS_gettid));
+    buffer->threadName[0] = '\0';
+    pthread_getname_np(pthread_self(), buffer->threadName, sizeof(buffer->threadName));
+    buffer->written = 0;
+    buffer->events.resize(Trace::bufferCapacity);
+    QMutexLocker locker(&buffersMutex);
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+void writeEscaped(FILE *file, const char *text)
+{
+    for(; *text != '\0'; text++)
+    {
+        if(*text == '"' || *text == '\\')
+            fputc('\\', file);
+        if(*text >= ' ')
+            fputc(*text, file);
+    }
+}
+}
+
+void Trace::setEnabled(bool value)
+{
+    Trace::enabled.store(value, std::memory_order_relaxed);
+}
+
+qint64 Trace::now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return qint64(time.tv_sec)*1000000000 + time.tv_nsec;
+}
+
+void Trace::record(const char *name, qint64 start, qint64 end)
+{
+    // First event of a thread allocates its buffer, later ones only store three words.
+    if(threadBuffer == nullptr)
+        threadBuffer = createThreadBuffer();
+    const quint64 index = threadBuffer->written.load(std::memory_order_relaxed);
+    Event &event = threadBuffer->events[index % bufferCapacity];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    threadBuffer->written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::clear()
+{
+    // Only moves the exported window, a concurrent writer just continues after it.
+    QMutexLocker locker(&buffersMutex);
+    for(ThreadBuffer *buffer: buffers)
+        buffer->written.store(0, std::memory_order_relaxed);
+}
+
+bool Trace::exportChromeTrace(const QString &path, QString &error)
+{
+    FILE *file = fopen(path.toLocal8Bit().constData(), "w");
+    if(file == nullptr)
+    {
+        error = "Cannot open " + path;
+        return false;
+    }
+    const int processId = int(getpid());
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    QMutexLocker locker(&buffersMutex);
+    for(ThreadBuffer *buffer: buffers)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+                first ? "" : ",\n", processId, buffer->threadId);
+        writeEscaped(file, buffer->threadName);
+        fprintf(file, "\"}}");
+        first = false;
+        const quint64 written = buffer->written.load(std::memory_order_acquire);
+        const quint64 begin = written > bufferCapacity ? written - bufferCapacity : 0;
+        for(quint64 index = begin; index < written; index++)
+        {
+            const Event &event = buffer->events[index % bufferCapacity];
+            fprintf(file, ",\n{\"name\":\"");
+            writeEscaped(file, event.name);
+            // Chrome trace timestamps are microseconds.
+            fprintf(file, "\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    processId, buffer->threadId, double(event.start)/1000.0, double(event.duration)/1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    if(fclose(file) != 0)
+    {
+        error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
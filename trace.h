@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <QString>
+
+// Scoped trace points of the tool itself, recorded into a ring buffer per thread
+//and exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+// Disabled tracing costs one test of a relaxed atomic flag per scope, no clock is read.
+class Trace
+{
+public:
+    struct Event
+    {
+        // String literal of the TRACE_SCOPE.
+        const char *name;
+        // CLOCK_MONOTONIC, nanoseconds.
+        qint64 start;
+        qint64 duration;
+    };
+    // Events kept per thread, older ones are overwritten.
+    static const size_t bufferCapacity = 65536;
+
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool value);
+    static qint64 now();
+    static void record(const char *name, qint64 start, qint64 end);
+    // Writes events of every thread, safe while tracing runs. An event overwritten during
+    //the export may show up with mixed fields, so stop tracing first for an exact trace.
+    static bool exportChromeTrace(const QString &path, QString &error);
+    // Drops recorded events, buffers stay allocated.
+    static void clear();
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name):
+        name(name),
+        start(__builtin_expect(Trace::isEnabled(), 0) ? Trace::now() : 0)
+    {
+    }
+    ~TraceScope()
+    {
+        if(__builtin_expect(this->start != 0, 0))
+            Trace::record(this->name, this->start, Trace::now());
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    const qint64 start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing block, `name` must be a string literal.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
@@ -0,0 +1,350 @@
+#include "transitionprofiler.h"
+
+#include <cerrno>
+#include <sched.h>
+#include <stdexcept>
+#include <time.h>
+
+#include "governortable.h"
+#include "trace.h"
+
+namespace
+{
+const qint64 NSEC_PER_USEC = 1000;
+const qint64 NSEC_PER_MSEC = 1000000;
+const qint64 NSEC_PER_SEC = 1000000000;
+
+void sleepUntil(qint64 deadline)
+{
+    timespec time;
+    time.tv_sec = time_t(deadline/NSEC_PER_SEC);
+    time.tv_nsec = long(deadline%NSEC_PER_SEC);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR)
+        ;
+}
+}
+
+TransitionProfiler::Settings TransitionProfiler::defaultSettings()
+{
+    Settings settings;
+    settings.governor = GovernorTable::unknownGovernor;
+    settings.maxScalingFrequence = 0;
+    settings.trials = 20;
+    settings.samplePeriod = 100;
+    settings.settleWindow = 20;
+    settings.timeout = 1000;
+    settings.tolerance = 100000;
+    return settings;
+}
+
+TransitionProfiler::TransitionProfiler(CoreSampler &coreSampler, QObject *parent):
+    QThread(parent),
+    coreSampler(coreSampler),
+    current(defaultSettings()),
+    trials(0),
+    samples(0),
+    samplingTime(0),
+    rounds(0)
+{
+}
+
+bool TransitionProfiler::prepare(const Settings &settings, const CoreStateStore &current)
+{
+    if(settings.trials < 1 || settings.samplePeriod < 1 || settings.settleWindow < 1 || settings.timeout <= settings.settleWindow)
+    {
+        this->error = "Transition profiler needs trials, a sample period and a timeout longer than the settle window.";
+        return false;
+    }
+    if(settings.governor == GovernorTable::unknownGovernor && settings.maxScalingFrequence == 0)
+    {
+        this->error = "Nothing to change, give a governor or a scaling max frequence.";
+        return false;
+    }
+    this->current = settings;
+    this->measuredCores.clear();
+    this->policies.clear();
+    this->corePolicies.clear();
+    this->frequenceFiles.clear();
+    this->written = current;
+    const int coresTotal = qMin(this->coreSampler.coresTotal(), current.size());
+    for(int i = 0; i < coresTotal; i++)
+    {
+        if((!settings.cores.isEmpty() && !settings.cores.contains(i)) || (i != 0 && !current.online[i]))
+            continue;
+        const LogicCore &logicCore = this->coreSampler.logicCore(i);
+        const uint leader = logicCore.getPolicyLeaderNumber();
+        int policyIndex = -1;
+        for(int j = 0; j < this->policies.size(); j++)
+        {
+            if(this->policies[j].leader == leader)
+                policyIndex = j;
+        }
+        if(policyIndex < 0)
+        {
+            const QString core = QString::number(i);
+            if(settings.governor != GovernorTable::unknownGovernor
+                    && !(logicCore.getAvailableGovernorMask() & (quint32(1) << settings.governor)))
+            {
+                this->error = "Governor is not available on core " + core + ".";
+                return false;
+            }
+            if(settings.maxScalingFrequence != 0 && (settings.maxScalingFrequence < current.minScalingFrequences[i]
+                                                     || settings.maxScalingFrequence > logicCore.getMaxCoreFrequence()))
+            {
+                this->error = "Scaling max frequence must be between scaling min and max hardware frequence of core " + core + ".";
+                return false;
+            }
+            Policy policy;
+            policy.leader = leader;
+            policy.writer = i;
+            policy.minScalingFrequence = current.minScalingFrequences[i];
+            policy.maxScalingFrequence = current.maxScalingFrequences[i];
+            policy.governor = current.governors[i];
+            this->policies.push_back(policy);
+            policyIndex = this->policies.size() - 1;
+        }
+        SysfsAttribute file;
+        if(!file.open(logicCore.corePath("/cpufreq/scaling_cur_freq")))
+        {
+            this->error = "Cannot open scaling_cur_freq of core " + QString::number(i) + ".";
+            return false;
+        }
+        this->measuredCores.push_back(i);
+        this->corePolicies.push_back(policyIndex);
+        this->frequenceFiles.push_back(std::move(file));
+    }
+    if(this->measuredCores.isEmpty())
+    {
+        this->error = "No online core to measure.";
+        return false;
+    }
+    this->tracking.resize(size_t(this->measuredCores.size()));
+    for(QVector<Measurement> &measurements: this->measurements)
+        measurements.resize(settings.trials*this->measuredCores.size());
+    this->trials = 0;
+    this->samples = 0;
+    this->samplingTime = 0;
+    this->rounds = 0;
+    this->error.clear();
+    return true;
+}
+
+void TransitionProfiler::run()
+{
+    pinAwayFromMeasuredCores();
+    try
+    {
+        // requestInterruption() cuts the polling short, the state from before is written back
+        //either way and the interrupted trial isn't counted.
+        for(int trial = 0; trial < this->current.trials && !isInterruptionRequested(); trial++)
+        {
+            transition(ChangeDirection, trial);
+            transition(RestoreDirection, trial);
+            if(isInterruptionRequested())
+                break;
+            this->trials++;
+        }
+    }
+    catch(const std::logic_error &exception)
+    {
+        this->error = QString("Cannot write the transition: ") + exception.what();
+        // Change may have been written for some policies only.
+        try
+        {
+            write(RestoreDirection);
+        }
+        catch(const std::logic_error &)
+        {
+        }
+    }
+}
+
+void TransitionProfiler::pinAwayFromMeasuredCores() const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool found = false;
+    const int coresTotal = qMin(this->written.size(), int(CPU_SETSIZE));
+    for(int i = 0; i < coresTotal; i++)
+    {
+        if(!this->measuredCores.contains(i) && (i == 0 || this->written.online[i]))
+        {
+            CPU_SET(i, &set);
+            found = true;
+        }
+    }
+    // Every core is measured, the scheduler keeps choosing.
+    if(found)
+        sched_setaffinity(0, sizeof(set), &set);
+}
+
+void TransitionProfiler::write(Direction direction)
+{
+    for(int i = 0; i < this->policies.size(); i++)
+    {
+        const Policy &policy = this->policies[i];
+        LogicCore::ApplySettings settings;
+        settings.online = true;
+        settings.minScalingFrequence = policy.minScalingFrequence;
+        settings.maxScalingFrequence = direction == ChangeDirection && this->current.maxScalingFrequence != 0
+                ? this->current.maxScalingFrequence : policy.maxScalingFrequence;
+        settings.governor = GovernorTable::unknownGovernor;
+        settings.idleStatesMask = 0;
+        if(this->current.governor != GovernorTable::unknownGovernor)
+            settings.governor = direction == ChangeDirection ? this->current.governor : policy.governor;
+        const qint64 writeTime = CoreSampler::monotonicTime();
+        this->coreSampler.logicCore(policy.writer).apply(settings, this->written);
+        if(settings.governor != GovernorTable::unknownGovernor)
+            this->written.governors[policy.writer] = settings.governor;
+        this->written.maxScalingFrequences[policy.writer] = settings.maxScalingFrequence;
+        for(int j = 0; j < this->corePolicies.size(); j++)
+        {
+            if(this->corePolicies[j] == i)
+                this->tracking[size_t(j)].writeTime = writeTime;
+        }
+    }
+}
+
+void TransitionProfiler::transition(Direction direction, int trial)
+{
+    TRACE_SCOPE("TransitionProfiler::transition");
+    const int coresTotal = this->measuredCores.size();
+    Measurement *measurements = this->measurements[direction].data() + trial*coresTotal;
+    for(int i = 0; i < coresTotal; i++)
+    {
+        Tracking &tracking = this->tracking[size_t(i)];
+        tracking.runStart = -1;
+        tracking.runFrequence = 0;
+        tracking.departed = false;
+        tracking.settled = false;
+        measurements[i].outcome = UnchangedOutcome;
+        measurements[i].settleTime = -1;
+        measurements[i].overshoot = 0;
+        measurements[i].fromFrequence = 0;
+        measurements[i].settledFrequence = 0;
+        this->frequenceFiles[size_t(i)].readUInt(measurements[i].fromFrequence);
+    }
+    write(direction);
+
+    const qint64 period = qint64(this->current.samplePeriod)*NSEC_PER_USEC;
+    const qint64 window = qint64(this->current.settleWindow)*NSEC_PER_MSEC;
+    const qint64 timeout = qint64(this->current.timeout)*NSEC_PER_MSEC;
+    const bool governorChange = this->current.governor != GovernorTable::unknownGovernor;
+    const bool limitChange = this->current.maxScalingFrequence != 0;
+    int pending = coresTotal;
+    qint64 previousRound = 0;
+    qint64 deadline = CoreSampler::monotonicTime();
+    while(pending > 0 && !isInterruptionRequested())
+    {
+        const qint64 now = CoreSampler::monotonicTime();
+        if(previousRound != 0)
+        {
+            this->samplingTime += now - previousRound;
+            this->rounds++;
+        }
+        previousRound = now;
+        for(int i = 0; i < coresTotal; i++)
+        {
+            Tracking &tracking = this->tracking[size_t(i)];
+            if(tracking.settled)
+                continue;
+            Measurement &measurement = measurements[i];
+            uint frequence;
+            if(this->frequenceFiles[size_t(i)].readUInt(frequence))
+            {
+                this->samples++;
+                const uint deviation = frequence > tracking.runFrequence ? frequence - tracking.runFrequence
+                                                                          : tracking.runFrequence - frequence;
+                if(tracking.runStart < 0)
+                {
+                    tracking.lowest = frequence;
+                    tracking.highest = frequence;
+                }
+                tracking.lowest = qMin(tracking.lowest, frequence);
+                tracking.highest = qMax(tracking.highest, frequence);
+                const uint departure = frequence > measurement.fromFrequence ? frequence - measurement.fromFrequence
+                                                                             : measurement.fromFrequence - frequence;
+                if(departure > this->current.tolerance)
+                    tracking.departed = true;
+                // A run is every sample within tolerance of its first one.
+                if(tracking.runStart < 0 || deviation > this->current.tolerance)
+                {
+                    tracking.runStart = now;
+                    tracking.runFrequence = frequence;
+                }
+                else if(now - tracking.runStart >= window)
+                {
+                    const Policy &policy = this->policies[this->corePolicies[i]];
+                    const uint limit = direction == ChangeDirection ? this->current.maxScalingFrequence : policy.maxScalingFrequence;
+                    const bool allowed = !limitChange || tracking.runFrequence <= limit;
+                    // A governor change that didn't move the frequence yet may still move it until the timeout.
+                    if(allowed && (tracking.departed || !governorChange))
+                    {
+                        const uint settled = tracking.runFrequence;
+                        measurement.settledFrequence = settled;
+                        if(tracking.departed)
+                        {
+                            measurement.outcome = SettledOutcome;
+                            measurement.settleTime = qMax(tracking.runStart - tracking.writeTime, qint64(0));
+                            if(settled >= measurement.fromFrequence)
+                                measurement.overshoot = tracking.highest > settled ? tracking.highest - settled : 0;
+                            else
+                                measurement.overshoot = tracking.lowest < settled ? settled - tracking.lowest : 0;
+                        }
+                        tracking.settled = true;
+                        pending--;
+                        continue;
+                    }
+                }
+            }
+            if(now - tracking.writeTime >= timeout)
+            {
+                measurement.outcome = tracking.departed ? TimeoutOutcome : UnchangedOutcome;
+                measurement.settledFrequence = tracking.runStart < 0 ? 0 : tracking.runFrequence;
+                tracking.settled = true;
+                pending--;
+            }
+        }
+        // Rounds missed while reading are skipped, not caught up.
+        deadline += period;
+        if(deadline < now)
+            deadline = now + period;
+        if(pending > 0)
+            sleepUntil(deadline);
+    }
+}
+
+QString TransitionProfiler::errorString() const
+{
+    return this->error;
+}
+
+const TransitionProfiler::Settings &TransitionProfiler::settings() const
+{
+    return this->current;
+}
+
+const QVector<int> &TransitionProfiler::cores() const
+{
+    return this->measuredCores;
+}
+
+int TransitionProfiler::trialsDone() const
+{
+    return this->trials;
+}
+
+const TransitionProfiler::Measurement &TransitionProfiler::measurement(Direction direction, int trial, int coreIndex) const
+{
+    return this->measurements[direction][trial*this->measuredCores.size() + coreIndex];
+}
+
+quint64 TransitionProfiler::samplesTotal() const
+{
+    return this->samples;
+}
+
+qint64 TransitionProfiler::meanSamplePeriod() const
+{
+    return this->rounds > 0 ? this->samplingTime/qint64(this->rounds) : 0;
+}
@@ -0,0 +1,146 @@
+#ifndef TRANSITIONPROFILER_H
+#define TRANSITIONPROFILER_H
+
+#include <QThread>
+#include <QString>
+#include <QVector>
+
+#include "coresampler.h"
+
+// Measures how long cores take to reach a new frequence after a governor or scaling_max_freq change.
+// Every trial writes the change through LogicCore::apply(), polls scaling_cur_freq of the affected cores
+//on its own thread every samplePeriod until each of them settles or the timeout passes, then writes
+//the state from before back and measures the return the same way.
+// A run of samples counts as settled only at or below the scaling max in force, and after a governor change
+//only once the frequence left where it started, so the old frequence read before the change took effect
+//is never reported as a settle time.
+// The sampler thread must not run meanwhile. Polling is pinned to online cores outside the measured
+//ones when there are any, its own load would otherwise make governors ramp up.
+class TransitionProfiler : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        // Cores whose policies are changed and sampled, empty means all online cores.
+        QVector<int> cores;
+        // GovernorTable id, unknownGovernor keeps the current one.
+        quint8 governor;
+        // kHz, 0 keeps the current limit.
+        uint maxScalingFrequence;
+        int trials;
+        // Microseconds between reads of scaling_cur_freq.
+        int samplePeriod;
+        // Milliseconds the frequence must stay within tolerance to count as settled.
+        int settleWindow;
+        // Milliseconds after which cores that didn't settle are given up for the trial.
+        int timeout;
+        // kHz.
+        uint tolerance;
+    };
+    static Settings defaultSettings();
+
+    enum Direction
+    {
+        ChangeDirection,
+        RestoreDirection,
+        DirectionCount
+    };
+
+    enum Outcome
+    {
+        // Frequence left where it started and settled where the change allows it.
+        SettledOutcome,
+        // Frequence moved but didn't settle where the change allows it before the timeout.
+        TimeoutOutcome,
+        // Frequence never left tolerance of where it started, nothing to time.
+        UnchangedOutcome
+    };
+
+    // One core in one trial and direction, frequences are in kHz.
+    struct Measurement
+    {
+        Outcome outcome;
+        // Nanoseconds from the write to the first sample of the settled run, -1 unless it settled.
+        qint64 settleTime;
+        // How far the frequence went past the settled one, away from where it started.
+        uint overshoot;
+        uint fromFrequence;
+        uint settledFrequence;
+    };
+
+    explicit TransitionProfiler(CoreSampler &coreSampler, QObject *parent = nullptr);
+    TransitionProfiler(const TransitionProfiler &) = delete;
+    TransitionProfiler &operator=(const TransitionProfiler &) = delete;
+
+    // Checks the change against every affected policy and opens scaling_cur_freq files.
+    //Returns false when nothing can be measured (see errorString()), call start() after it.
+    //requestInterruption() stops the run after the current trial wrote the state from before back.
+    bool prepare(const Settings &settings, const CoreStateStore &current);
+    // Valid after the thread finished. Empty when every trial ran,
+    //otherwise the failed write; trialsDone() tells how many completed before it.
+    QString errorString() const;
+
+    const Settings &settings() const;
+    // Measured cores in ascending order.
+    const QVector<int> &cores() const;
+    int trialsDone() const;
+    const Measurement &measurement(Direction direction, int trial, int coreIndex) const;
+    quint64 samplesTotal() const;
+    // Mean time between sampling rounds, nanoseconds.
+    qint64 meanSamplePeriod() const;
+
+protected:
+    void run() override;
+
+private:
+    struct Policy
+    {
+        uint leader;
+        // First measured core of the policy, it's online so policy files are written through it.
+        int writer;
+        // Scaling state from prepare(), written back after every trial.
+        uint minScalingFrequence;
+        uint maxScalingFrequence;
+        quint8 governor;
+    };
+
+    // State of one core while a trial waits for it.
+    struct Tracking
+    {
+        qint64 writeTime;
+        qint64 runStart;
+        uint runFrequence;
+        uint lowest;
+        uint highest;
+        // Some sample was out of tolerance of the frequence before the write.
+        bool departed;
+        bool settled;
+    };
+
+    CoreSampler &coreSampler;
+    Settings current;
+    QVector<int> measuredCores;
+    QVector<Policy> policies;
+    // Policy of each measured core, index into policies.
+    QVector<int> corePolicies;
+    std::vector<SysfsAttribute> frequenceFiles;
+    std::vector<Tracking> tracking;
+    // Scaling state of policy writers as the profiler left it, apply() compares against it.
+    CoreStateStore written;
+    QVector<Measurement> measurements[DirectionCount];
+    int trials;
+    quint64 samples;
+    qint64 samplingTime;
+    quint64 rounds;
+    QString error;
+
+    // Reads the starting frequences, writes and polls until every core settled or timed out.
+    void transition(Direction direction, int trial);
+    // Writes the change or the original state of every policy and fills writeTime of its cores.
+    void write(Direction direction);
+    void pinAwayFromMeasuredCores() const;
+};
+
+#endif // TRANSITIONPROFILER_H